@@ -0,0 +1,110 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "rtweekend.h"
+
+#include <algorithm>
+
+// Caixa delimitadora alinhada aos eixos (axis-aligned bounding box).
+class aabb {
+public:
+    // A caixa padrão é vazia: qualquer união com ela resulta na outra caixa.
+    aabb() : minimum(infinity, infinity, infinity), maximum(-infinity, -infinity, -infinity) {}
+    aabb(const point3& a, const point3& b) : minimum(a), maximum(b) {}
+
+    point3 min() const { return minimum; }
+    point3 max() const { return maximum; }
+
+    point3 centroid() const { return 0.5 * (minimum + maximum); }
+
+    // Área da superfície da caixa, usada pela heurística de área de superfície (SAH).
+    double surface_area() const {
+        auto d = maximum - minimum;
+        if (d.x() < 0 || d.y() < 0 || d.z() < 0) return 0;
+        return 2.0 * (d.x()*d.y() + d.y()*d.z() + d.z()*d.x());
+    }
+
+    // Eixo em que a caixa é mais longa (0 = x, 1 = y, 2 = z).
+    int longest_axis() const {
+        auto d = maximum - minimum;
+        if (d.x() > d.y() && d.x() > d.z()) return 0;
+        return d.y() > d.z() ? 1 : 2;
+    }
+
+    // Teste de interseção pelo método das placas (slabs).
+    bool hit(const ray& r, real t_min, real t_max) const {
+        for (int a = 0; a < 3; a++) {
+            auto invD = real(1) / r.direction()[a];
+            auto t0 = (minimum[a] - r.origin()[a]) * invD;
+            auto t1 = (maximum[a] - r.origin()[a]) * invD;
+            if (invD < 0.0)
+                std::swap(t0, t1);
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max <= t_min)
+                return false;
+        }
+        return true;
+    }
+
+    // Versão para travessias: recebe a origem e o inverso da direção já calculados e
+    // devolve em t_entry a distância de entrada na caixa.
+    bool hit(const point3& origin, const vec3& inv_dir, real t_min, real t_max,
+             real& t_entry) const {
+        for (int a = 0; a < 3; a++) {
+            auto t0 = (minimum[a] - origin[a]) * inv_dir[a];
+            auto t1 = (maximum[a] - origin[a]) * inv_dir[a];
+            if (inv_dir[a] < 0.0)
+                std::swap(t0, t1);
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max < t_min)
+                return false;
+        }
+        t_entry = t_min;
+        return true;
+    }
+
+    // Igual à anterior, mas conservadora (Ize, "Robust BVH Ray Traversal", 2013): a
+    // saída de cada placa é aumentada pelo erro máximo de arredondamento das três
+    // operações, 1 + 2*gamma(3), para que um raio que passa rente a um canto nunca seja
+    // descartado pela caixa de um triângulo que ele atinge. Usada sob o teste estanque
+    // das malhas, que só é estanque se a travessia também for.
+    bool robust_hit(const point3& origin, const vec3& inv_dir, real t_min, real t_max,
+                    real& t_entry) const {
+        constexpr real eps = std::numeric_limits<real>::epsilon() / 2;
+        constexpr real scale = 1 + 2 * (3 * eps / (1 - 3 * eps));
+        for (int a = 0; a < 3; a++) {
+            auto t0 = (minimum[a] - origin[a]) * inv_dir[a];
+            auto t1 = (maximum[a] - origin[a]) * inv_dir[a];
+            if (inv_dir[a] < 0.0)
+                std::swap(t0, t1);
+            t1 *= scale;
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if (t_max < t_min)
+                return false;
+        }
+        t_entry = t_min;
+        return true;
+    }
+
+public:
+    point3 minimum;  // Canto mínimo
+    point3 maximum;  // Canto máximo
+};
+
+// Menor caixa que contém as duas caixas.
+inline aabb surrounding_box(const aabb& box0, const aabb& box1) {
+    point3 small(fmin(box0.min().x(), box1.min().x()),
+                 fmin(box0.min().y(), box1.min().y()),
+                 fmin(box0.min().z(), box1.min().z()));
+
+    point3 big(fmax(box0.max().x(), box1.max().x()),
+               fmax(box0.max().y(), box1.max().y()),
+               fmax(box0.max().z(), box1.max().z()));
+
+    return aabb(small, big);
+}
+
+#endif
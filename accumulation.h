@@ -0,0 +1,96 @@
+#ifndef ACCUMULATION_H
+#define ACCUMULATION_H
+
+#include "rtweekend.h"
+
+#include "framebuffer.h"
+
+#include <cstdint>
+#include <vector>
+
+// Luminância (Rec. 709) de uma cor linear
+inline double luminance(const color& c) {
+    return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+}
+
+// Buffer de acumulação: para cada pixel guarda a soma das amostras, quantas amostras
+// já foram somadas e a média e a soma dos quadrados dos desvios (M2) da luminância,
+// atualizadas pelo algoritmo de Welford. A partir daí sai a variância de cada pixel,
+// usada para decidir onde ainda vale a pena gastar amostras.
+class accumulation_buffer {
+public:
+    accumulation_buffer() {}
+    accumulation_buffer(int w, int h) { resize(w, h); }
+
+    // Redimensiona e zera o buffer
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        const size_t n = pixel_count();
+        sum.assign(n * 3, 0.0);
+        count.assign(n, 0);
+        lum_mean.assign(n, 0.0);
+        lum_m2.assign(n, 0.0);
+    }
+
+    size_t pixel_count() const { return static_cast<size_t>(width) * height; }
+
+    // Soma uma amostra ao pixel
+    void add_sample(size_t pixel, const color& c) {
+        double* s = &sum[pixel * 3];
+        s[0] += c.x();
+        s[1] += c.y();
+        s[2] += c.z();
+
+        // Welford: atualiza média e M2 sem guardar as amostras
+        const double y = luminance(c);
+        const auto n = ++count[pixel];
+        const double delta = y - lum_mean[pixel];
+        lum_mean[pixel] += delta / n;
+        lum_m2[pixel] += delta * (y - lum_mean[pixel]);
+    }
+
+    color mean(size_t pixel) const {
+        if (count[pixel] == 0) return color(0,0,0);
+        const double* s = &sum[pixel * 3];
+        return color(s[0], s[1], s[2]) / count[pixel];
+    }
+
+    // Variância amostral da luminância do pixel
+    double variance(size_t pixel) const {
+        return count[pixel] > 1 ? lum_m2[pixel] / (count[pixel] - 1) : 0.0;
+    }
+
+    // Meia largura do intervalo de confiança de 95% da média, convertida para a escala em
+    // que a imagem é vista: com correção gama 2, um erro dm na média vira dm/(2*sqrt(m)).
+    // O piso em m evita que pixels quase pretos exijam precisão infinita.
+    double display_error(size_t pixel) const {
+        if (count[pixel] < 2) return infinity;
+        const double half_width = 1.96 * sqrt(variance(pixel) / count[pixel]);
+        return half_width / (2.0 * sqrt(fmax(lum_mean[pixel], 1e-3)));
+    }
+
+    // Total de amostras em todos os pixels
+    std::uint64_t total_samples() const {
+        std::uint64_t total = 0;
+        for (auto n : count) total += n;
+        return total;
+    }
+
+    // Grava a média de cada pixel no framebuffer (que deve então ser gravado com escala 1).
+    void resolve(framebuffer& fb) const {
+        fb.resize(width, height);
+        for (size_t k = 0; k < pixel_count(); ++k)
+            fb.set(k, mean(k));
+    }
+
+public:
+    int width = 0;
+    int height = 0;
+    std::vector<double> sum;             // Soma R, G, B das amostras
+    std::vector<std::uint32_t> count;    // Amostras por pixel
+    std::vector<double> lum_mean;        // Média da luminância
+    std::vector<double> lum_m2;          // Soma dos quadrados dos desvios da luminância
+};
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "rtweekend.h"
+
+#include "bvh.h"
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "image_io.h"
+#include "lights.h"
+#include "material.h"
+#include "moving_sphere.h"
+#include "renderer.h"
+#include "scene.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Animação "toca-discos" (turntable): a cena inteira gira em torno do eixo vertical que
+// passa pelo ponto para onde a câmera olha, 'degrees_per_frame' graus por quadro. O
+// quadro f cobre os tempos [f, f + shutter]; cada esfera vira uma moving_sphere que vai
+// em linha reta da posição no início à posição no fim do obturador, o que produz o
+// borrão de movimento. Os objetos são criados uma única vez e set_frame só muda as
+// posições deles, sem alocar nada. As malhas de triângulos ficam paradas.
+class turntable {
+public:
+    turntable(const scene_data& scene, material_arena& materials, double degrees_per_frame,
+              double shutter);
+
+    // Posiciona as esferas para o quadro 'frame'
+    void set_frame(int frame);
+
+    const hittable_list& objects() const { return list; }
+    const scene_camera& camera_params() const { return cam; }
+    double time0() const { return frame_time0; }
+    double time1() const { return frame_time1; }
+
+private:
+    // Posição no instante 'time' de um ponto que está em 'p' no instante 0
+    point3 rotate(const point3& p, double time) const;
+
+private:
+    scene_camera cam;
+    double degrees_per_frame;
+    double shutter;                                 // Fração do quadro com o obturador aberto
+    double frame_time0 = 0, frame_time1 = 0;
+    std::vector<point3> rest_centers;               // Centros no instante 0
+    std::vector<shared_ptr<moving_sphere>> spheres;
+    hittable_list list;                             // As mesmas esferas, como hittable
+};
+
+
+inline turntable::turntable(const scene_data& scene, material_arena& materials, double degrees_per_frame,
+                            double shutter)
+    : cam(scene.cam), degrees_per_frame(degrees_per_frame), shutter(shutter)
+{
+    const auto base = build_materials(scene, materials);
+    rest_centers.reserve(scene.sphere_count());
+    spheres.reserve(scene.sphere_count());
+    list.objects.reserve(scene.sphere_count());
+    for (size_t k = 0; k < scene.sphere_count(); ++k) {
+        const scene_sphere& s = scene.spheres()[k];
+        const point3 center(s.center[0], s.center[1], s.center[2]);
+        rest_centers.push_back(center);
+        spheres.push_back(make_shared<moving_sphere>(center, center, 0, 0, s.radius, base + s.material));
+        list.add(spheres.back());
+    }
+    add_scene_meshes(scene, base, list);  // As malhas não giram
+    set_frame(0);
+}
+
+inline void turntable::set_frame(int frame) {
+    frame_time0 = frame;
+    frame_time1 = frame + shutter;
+    for (size_t k = 0; k < spheres.size(); ++k) {
+        moving_sphere& s = *spheres[k];
+        s.center0 = rotate(rest_centers[k], frame_time0);
+        s.center1 = rotate(rest_centers[k], frame_time1);
+        s.time0 = frame_time0;
+        s.time1 = frame_time1;
+    }
+}
+
+inline point3 turntable::rotate(const point3& p, double time) const {
+    const double angle = degrees_to_radians(degrees_per_frame * time);
+    const double c = std::cos(angle), s = std::sin(angle);
+    const double x = p.x() - cam.lookat[0], z = p.z() - cam.lookat[2];
+    return point3(cam.lookat[0] + c * x + s * z, p.y(), cam.lookat[2] - s * x + c * z);
+}
+
+// Parâmetros de uma sequência de quadros
+struct sequence_settings {
+    int frames = 1;
+    bool use_bvh = true;
+    bool always_rebuild = false;     // Reconstrói a BVH em todos os quadros (para comparação)
+    double rebuild_threshold = 1.5;  // Reconstrói quando o custo SAH passa deste múltiplo do da última construção
+    bool sample_lights = true;       // Amostragem direta das luzes emissoras (ver lights.h)
+};
+
+// Tempos e estado de um quadro renderizado por render_sequence
+struct frame_timing {
+    double update_seconds = 0;  // Posicionar os objetos e reajustar ou reconstruir a BVH
+    double render_seconds = 0;
+    bool rebuilt = false;       // A BVH foi reconstruída neste quadro
+    double sah_cost = 0;        // Custo SAH da BVH usada (ver bvh::sah_cost)
+};
+
+// Renderiza os quadros da animação em sequência, chamando after_frame(quadro, fb, tempos)
+// ao fim de cada um. A BVH é construída no primeiro quadro e depois só reajustada
+// (bvh::refit); como o reajuste não muda a topologia, a árvore é reconstruída quando
+// o custo SAH cresce além de rebuild_threshold. Objetos, materiais, BVH e framebuffer
+// são os mesmos em todos os quadros. Com seq.sample_lights as luzes são recolhidas de
+// novo em cada quadro, já nas posições do quadro.
+template <typename AfterFrame>
+void render_sequence(turntable& anim, const material_arena& materials, const render_settings& settings,
+                     const sequence_settings& seq, framebuffer& fb, AfterFrame after_frame) {
+    bvh tree;
+    double built_cost = 0;
+    render_settings frame_settings = settings;
+    light_list lights;
+    for (int f = 0; f < seq.frames; ++f) {
+        frame_timing timing;
+        auto start = std::chrono::steady_clock::now();
+        anim.set_frame(f);
+        frame_settings.frame = static_cast<std::uint64_t>(f);
+        if (seq.use_bvh) {
+            if (f > 0 && !seq.always_rebuild) {
+                tree.refit(anim.time0(), anim.time1());
+                timing.sah_cost = tree.sah_cost();
+            }
+            if (f == 0 || seq.always_rebuild || timing.sah_cost > built_cost * seq.rebuild_threshold) {
+                tree = bvh(anim.objects(), anim.time0(), anim.time1(), settings.dispatch);
+                timing.sah_cost = built_cost = tree.sah_cost();
+                timing.rebuilt = true;
+            }
+        }
+        if (seq.sample_lights) {
+            lights = light_list(anim.objects(), materials);
+            frame_settings.lights = lights.empty() ? nullptr : &lights;
+        }
+        auto updated = std::chrono::steady_clock::now();
+        timing.update_seconds = std::chrono::duration<double>(updated - start).count();
+
+        const hittable& world = seq.use_bvh ? static_cast<const hittable&>(tree) : anim.objects();
+        const camera cam = make_camera(anim.camera_params(), anim.time0(), anim.time1());
+        render(world, materials, cam, frame_settings, fb);
+        timing.render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - updated).count();
+
+        after_frame(f, static_cast<const framebuffer&>(fb), timing);
+    }
+}
+
+// Nome do arquivo do quadro: "saida/imagem.png" vira "saida/imagem_0042.png"
+inline std::string frame_path(const std::string& path, int frame) {
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%04d", frame);
+    const auto slash = path.find_last_of('/');
+    const auto dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + number;
+    return path.substr(0, dot) + number + path.substr(dot);
+}
+
+// Renderiza os quadros da turntable e grava cada um com o número do quadro no nome do
+// arquivo (ver frame_path). No fim mostra quanto tempo foi gasto preparando os quadros,
+// para comparar o reajuste da BVH com a reconstrução (sequence_settings::always_rebuild).
+// Retorna false se algum quadro não pôde ser gravado.
+inline bool write_animation(const scene_data& description, render_settings settings, const sequence_settings& seq,
+                            double degrees_per_frame, double shutter, const std::string& output_path) {
+    material_arena materials;
+    turntable anim(description, materials, degrees_per_frame, shutter);
+    settings.progress = false;
+
+    framebuffer fb;
+    double update_seconds = 0, render_seconds = 0;
+    int rebuilds = 0;
+    bool written = true;
+    render_sequence(anim, materials, settings, seq, fb, [&](int frame, const framebuffer& image, const frame_timing& timing) {
+        const std::string path = frame_path(output_path, frame);
+        if (!write_image(path, image, 1.0 / settings.samples_per_pixel)) {
+            std::cerr << "Não foi possível gravar " << path << '\n';
+            written = false;
+        }
+        update_seconds += timing.update_seconds;
+        render_seconds += timing.render_seconds;
+        rebuilds += timing.rebuilt;
+        std::cerr << "\rQuadro " << frame + 1 << " de " << seq.frames << ": preparação "
+                  << timing.update_seconds * 1000 << " ms" << (timing.rebuilt ? " (reconstrução)" : "")
+                  << ", custo SAH " << timing.sah_cost << ", renderização " << timing.render_seconds << " s   "
+                  << std::flush;
+    });
+
+    std::cerr << "\nPreparação: " << update_seconds * 1000 << " ms no total, "
+              << update_seconds * 1000 / seq.frames << " ms por quadro, " << rebuilds
+              << " construções da BVH\nRenderização: " << render_seconds << " s\n";
+    return written;
+}
+
+#endif
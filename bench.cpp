@@ -0,0 +1,1201 @@
+// Benchmarks do ray tracer: medições isoladas dos kernels (interseção, dispersão dos
+// materiais, câmera, sorteios de vec3.h e write_color) e renderizações completas de cenas
+// de vários tamanhos, com o resultado em JSON para comparar versões.
+//
+//     g++ -O2 -std=c++17 -pthread bench.cpp -o output/bench
+//     ./output/bench --output output/bench.json
+//     ./output/bench --baseline output/bench.json     (compara com uma medição anterior)
+//
+// Com --compare nome, roda em vez disso uma das comparações de técnicas (BVH, sphere_set,
+// wavefront, roleta russa, denoiser, amostragem...) na cena escolhida:
+//
+//     ./output/bench --compare denoise --width 200 --spp 10
+
+#include "rtweekend.h"
+
+#include "animation.h"
+#include "bvh.h"
+#include "camera.h"
+#include "color.h"
+#include "denoise.h"
+#include "hittable_list.h"
+#include "instanced_scene.h"
+#include "material.h"
+#include "mesh_io.h"
+#include "random_scene.h"
+#include "render_queue.h"
+#include "renderer.h"
+#include "scene.h"
+#include "sphere.h"
+#include "sphere_set.h"
+#include "texture_cache.h"
+#include "triangle_mesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+// Opções da linha de comando
+struct bench_options {
+    double min_time = 0.05;      // Duração mínima de cada repetição de um kernel, em segundos
+    int repeats = 7;             // Repetições de cada medição (vale a mediana)
+    int width = 200;             // Largura das imagens dos benchmarks de quadro inteiro
+    int spp = 4;                 // Amostras por pixel nesses quadros
+    int threads = default_thread_count();
+    bool kernels = true;
+    bool frames = true;
+    std::string filter;          // Só roda os benchmarks cujo nome contém este texto
+};
+
+// Uma medição. ns_per_op é a mediana das repetições; nos quadros inteiros a operação é
+// um raio (primário ou secundário) intersectado com a cena.
+struct bench_result {
+    std::string name;
+    double ns_per_op = 0;
+    double min_ns = 0;
+    double max_ns = 0;
+    std::uint64_t ops = 0;       // Operações por repetição
+    std::vector<std::pair<std::string, double>> extra;  // Campos próprios de cada benchmark
+};
+
+// Envolve um hittable contando quantos raios são intersectados com ele.
+class counting_hittable : public hittable {
+public:
+    explicit counting_hittable(const hittable& inner) : inner(inner) {}
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override {
+        count.fetch_add(1, std::memory_order_relaxed);
+        return inner.hit(r, t_min, t_max, rec);
+    }
+
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override {
+        count.fetch_add(1, std::memory_order_relaxed);
+        return inner.occluded(r, t_min, t_max);
+    }
+
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override {
+        return inner.bounding_box(time0, time1, output_box);
+    }
+
+    const hittable& inner;
+    mutable std::atomic<std::uint64_t> count{0};
+};
+
+// Acumula os resultados dos kernels para que o compilador não descarte as chamadas.
+static volatile double bench_sink;
+
+// Mediana, mínimo e máximo dos tempos por operação das repetições.
+void summarize(std::vector<double> ns, bench_result& result) {
+    std::sort(ns.begin(), ns.end());
+    result.ns_per_op = ns[ns.size() / 2];
+    result.min_ns = ns.front();
+    result.max_ns = ns.back();
+}
+
+// Mede um kernel. f(n) executa n operações e devolve um valor que depende delas. O número
+// de operações por repetição dobra até uma repetição durar min_time (o que também serve
+// de aquecimento); depois são feitas 'repeats' repetições com esse número.
+template <typename F>
+bench_result measure_kernel(const std::string& name, const bench_options& opt, F&& f) {
+    auto run = [&](std::uint64_t n) {
+        auto start = bench_clock::now();
+        bench_sink = bench_sink + f(n);
+        return std::chrono::duration<double>(bench_clock::now() - start).count();
+    };
+
+    std::uint64_t n = 16;
+    while (run(n) < opt.min_time && n < (std::uint64_t(1) << 40)) n *= 2;
+
+    std::vector<double> ns;
+    for (int k = 0; k < opt.repeats; ++k)
+        ns.push_back(run(n) * 1e9 / n);
+
+    bench_result result;
+    result.name = name;
+    result.ops = n;
+    summarize(ns, result);
+    return result;
+}
+
+// Raios primários de uma grade 160x90 da câmera, sempre os mesmos.
+std::vector<ray> camera_rays(const camera& cam) {
+    const int rays_x = 160, rays_y = 90;
+    std::vector<ray> rays;
+    for (int j = 0; j < rays_y; ++j)
+        for (int i = 0; i < rays_x; ++i) {
+            begin_sample(static_cast<std::uint64_t>(j) * rays_x + i, 0);
+            rays.push_back(cam.get_ray((i + random_double()) / (rays_x-1),
+                                       (j + random_double()) / (rays_y-1)));
+        }
+    return rays;
+}
+
+// Interseção de uma lista de raios com um objeto; devolve a soma dos t encontrados.
+double trace_rays(const hittable& object, const std::vector<ray>& rays, std::uint64_t n) {
+    double sum = 0;
+    size_t k = 0;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        hit_record rec;
+        if (object.hit(rays[k], 0.001, infinity, rec)) sum += rec.t;
+        if (++k == rays.size()) k = 0;
+    }
+    return sum;
+}
+
+void run_kernel_benchmarks(const bench_options& opt, std::vector<bench_result>& results) {
+    auto wanted = [&](const std::string& name) {
+        return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+    };
+    auto add = [&](const std::string& name, auto&& f) {
+        if (!wanted(name)) return;
+        results.push_back(measure_kernel(name, opt, f));
+        std::cerr << name << ": " << results.back().ns_per_op << " ns\n";
+    };
+
+    thread_rng() = pcg32();
+    material_arena materials;
+    const scene_data description = make_random_scene();
+    const hittable_list list = build_world(description, materials);
+    const camera cam = make_camera(description.cam);
+    const std::vector<ray> rays = camera_rays(cam);
+
+    // Esfera unitária na origem, atingida por metade dos raios: as origens ficam em uma
+    // esfera de raio 10 e os raios miram em pontos de um cubo de lado 4 em volta dela.
+    const sphere unit_sphere(point3(0,0,0), 1, 0);
+    std::vector<ray> sphere_rays, hit_rays, miss_rays;
+    begin_sample(0, 0);
+    while (hit_rays.size() < 1024 || miss_rays.size() < 1024) {
+        point3 origin = 10 * random_unit_vector();
+        ray r(origin, point3(random_double(-2,2), random_double(-2,2), random_double(-2,2)) - origin);
+        hit_record rec;
+        auto& bucket = unit_sphere.hit(r, 0.001, infinity, rec) ? hit_rays : miss_rays;
+        if (bucket.size() < 1024) bucket.push_back(r);
+    }
+    for (size_t k = 0; k < 1024; ++k) {
+        sphere_rays.push_back(hit_rays[k]);
+        sphere_rays.push_back(miss_rays[k]);
+    }
+
+    add("sphere::hit/acerto", [&](std::uint64_t n) { return trace_rays(unit_sphere, hit_rays, n); });
+    add("sphere::hit/erro", [&](std::uint64_t n) { return trace_rays(unit_sphere, miss_rays, n); });
+    add("sphere::hit/misto", [&](std::uint64_t n) { return trace_rays(unit_sphere, sphere_rays, n); });
+    add("hittable_list::hit", [&](std::uint64_t n) { return trace_rays(list, rays, n); });
+    if (wanted("bvh::hit")) {
+        const bvh tree(list);
+        add("bvh::hit", [&](std::uint64_t n) { return trace_rays(tree, rays, n); });
+    }
+
+    // A mesma esfera unitária como malha de 256 x 128 quadriláteros, com os mesmos raios,
+    // em cada nível de SIMD disponível
+    if (wanted("triangle_mesh::hit")) {
+        auto geometry = make_shared<mesh_data>();
+        const int slices = 256, stacks = 128;
+        for (int j = 0; j <= stacks; ++j)
+            for (int i = 0; i < slices; ++i) {
+                const double theta = pi * j / stacks, phi = 2 * pi * i / slices;
+                for (double x : {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)})
+                    geometry->positions.push_back(static_cast<real>(x));
+            }
+        for (int j = 0; j < stacks; ++j)
+            for (int i = 0; i < slices; ++i) {
+                const std::uint32_t a = j * slices + i, b = j * slices + (i + 1) % slices;
+                const std::uint32_t c = b + slices, d = a + slices;
+                for (std::uint32_t v : {a, b, c, a, c, d}) geometry->indices.push_back(v);
+            }
+        const simd_level best = detect_simd_level();
+        for (auto level : {simd_level::scalar, simd_level::avx2, simd_level::avx512}) {
+            if (level > best) continue;
+            triangle_mesh::kernel() = level;
+            const triangle_mesh mesh(geometry, 0);
+            add(std::string("triangle_mesh::hit/") + simd_level_name(level),
+                [&](std::uint64_t n) { return trace_rays(mesh, sphere_rays, n); });
+        }
+        triangle_mesh::kernel() = best;
+    }
+
+    // Dispersão: um raio atinge o alto de uma esfera unitária, vindo de fora
+    hit_record rec;
+    const ray incoming(point3(0.3, 3, 0.2), vec3(-0.1, -1, -0.05));
+    unit_sphere.hit(incoming, 0.001, infinity, rec);
+
+    auto scatter_kernel = [&](const material& mat) {
+        return [&](std::uint64_t n) {
+            begin_sample(0, 0);
+            double sum = 0;
+            color attenuation;
+            ray scattered;
+            for (std::uint64_t i = 0; i < n; ++i)
+                if (mat.scatter(incoming, rec, attenuation, scattered))
+                    sum += scattered.direction().x();
+            return sum;
+        };
+    };
+    const lambertian diffuse(color(0.5, 0.5, 0.5));
+    const metal mirror(color(0.7, 0.6, 0.5), 0.3);
+    const dielectric glass(1.5);
+    add("lambertian::scatter", scatter_kernel(diffuse));
+    add("metal::scatter", scatter_kernel(mirror));
+    add("dielectric::scatter", scatter_kernel(glass));
+
+    add("camera::get_ray", [&](std::uint64_t n) {
+        begin_sample(0, 0);
+        double sum = 0;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            const double u = (i & 1023) / 1023.0, v = ((i >> 10) & 1023) / 1023.0;
+            sum += cam.get_ray(u, v).direction().y();
+        }
+        return sum;
+    });
+
+    // Sorteios de vec3.h
+    auto sampling_kernel = [](auto&& sample) {
+        return [sample](std::uint64_t n) {
+            begin_sample(0, 0);
+            double sum = 0;
+            for (std::uint64_t i = 0; i < n; ++i) sum += sample().x();
+            return sum;
+        };
+    };
+    const vec3 normal = unit_vector(vec3(0.2, 1, -0.3));
+    add("random_in_unit_disk", sampling_kernel([] { return random_in_unit_disk(); }));
+    add("random_in_unit_sphere", sampling_kernel([] { return random_in_unit_sphere(); }));
+    add("random_unit_vector", sampling_kernel([] { return random_unit_vector(); }));
+    add("random_in_hemisphere", sampling_kernel([normal] { return random_in_hemisphere(normal); }));
+
+    // Os mesmos sorteios pelas sequências de sampler.h: mapeamentos analíticos de
+    // pontos Sobol embaralhados, um índice de amostra novo a cada oito dimensões
+    auto sequence_kernel = [](sampler_mode mode, auto&& sample) {
+        return [mode, sample](std::uint64_t n) {
+            double sum = 0;
+            for (std::uint64_t i = 0; i < n; ++i) {
+                if ((i & 3) == 0) begin_sample(mode, 0, 0, 1, static_cast<std::uint32_t>(i >> 2));
+                sum += sample().x();
+            }
+            return sum;
+        };
+    };
+    blue_noise_mask();  // Gerada uma vez, fora das medidas
+    add("sample_in_unit_disk/sobol", sequence_kernel(sampler_mode::sobol, [] { return sample_in_unit_disk(); }));
+    add("sample_unit_vector/sobol", sequence_kernel(sampler_mode::sobol, [] { return sample_unit_vector(); }));
+    add("sample_unit_vector/blue_noise", sequence_kernel(sampler_mode::blue_noise, [] { return sample_unit_vector(); }));
+
+    add("write_color", [&](std::uint64_t n) {
+        std::ostringstream out;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            const double x = (i & 255) * (10.0 / 255);
+            write_color(out, color(x, 0.5 * x, 0.25 * x), 10);
+        }
+        return static_cast<double>(out.tellp());
+    });
+}
+
+// Renderiza cenas aleatórias de vários tamanhos com 1, 2, 4, ... threads. Os raios
+// intersectados são contados em uma passada à parte, já que a imagem (e portanto o
+// número de raios) é a mesma em todas as repetições e com qualquer número de threads.
+void run_frame_benchmarks(const bench_options& opt, std::vector<bench_result>& results) {
+    struct frame_scene { const char* name; int grid_min, grid_max; };
+    const frame_scene scenes[] = {{"padrao", -2, 8}, {"grade30", -15, 15}, {"grade100", -50, 50}};
+
+    auto wanted = [&](const std::string& name) {
+        return opt.filter.empty() || name.find(opt.filter) != std::string::npos;
+    };
+
+    for (const auto& s : scenes) {
+        std::vector<int> thread_counts;
+        for (int n = 1; n <= opt.threads; n = n < opt.threads && n * 2 > opt.threads ? opt.threads : n * 2)
+            if (wanted(std::string("quadro/") + s.name + "/t" + std::to_string(n)))
+                thread_counts.push_back(n);
+        if (thread_counts.empty()) continue;
+
+        thread_rng() = pcg32();
+        material_arena materials;
+        const scene_data description = make_random_scene(s.grid_min, s.grid_max);
+        const hittable_list list = build_world(description, materials);
+        const bvh world(list);
+        const camera cam = make_camera(description.cam);
+
+        render_settings settings;
+        settings.progress = false;
+        settings.image_width = opt.width;
+        settings.image_height = static_cast<int>(opt.width / description.cam.aspect_ratio);
+        settings.samples_per_pixel = opt.spp;
+        settings.threads = opt.threads;
+
+        framebuffer fb;
+        counting_hittable counter(world);
+        render(counter, materials, cam, settings, fb);
+        const std::uint64_t rays = counter.count.load();
+        const double primary = static_cast<double>(settings.image_width) * settings.image_height * opt.spp;
+
+        double base_time = 0;
+        for (int threads : thread_counts) {
+            const std::string name = std::string("quadro/") + s.name + "/t" + std::to_string(threads);
+            settings.threads = threads;
+            std::vector<double> ns, seconds;
+            for (int k = 0; k < opt.repeats; ++k) {
+                auto start = bench_clock::now();
+                render(world, materials, cam, settings, fb);
+                seconds.push_back(std::chrono::duration<double>(bench_clock::now() - start).count());
+                ns.push_back(seconds.back() * 1e9 / rays);
+            }
+            std::sort(seconds.begin(), seconds.end());
+            const double median = seconds[seconds.size() / 2];
+            if (threads == 1) base_time = median;
+
+            bench_result result;
+            result.name = name;
+            result.ops = rays;
+            summarize(ns, result);
+            result.extra = {
+                {"objects", static_cast<double>(list.objects.size())},
+                {"width", static_cast<double>(settings.image_width)},
+                {"height", static_cast<double>(settings.image_height)},
+                {"spp", static_cast<double>(opt.spp)},
+                {"threads", static_cast<double>(threads)},
+                {"seconds", median},
+                {"rays_per_s", rays / median},
+                {"primary_rays_per_s", primary / median},
+                {"speedup", base_time > 0 ? base_time / median : 1.0},
+            };
+            results.push_back(result);
+            std::cerr << name << ": " << rays / median / 1e6 << " Mrays/s, "
+                      << result.ns_per_op << " ns/raio\n";
+        }
+    }
+}
+
+// Comparações (--compare nome): em vez de medir kernels, cada uma renderiza a cena
+// escolhida de duas ou mais formas e mostra uma tabela no stderr, sem JSON.
+struct compare_options {
+    std::string name;
+    std::string mesh_path;       // --compare mesh arquivo
+    std::string scene_path;      // Vazio: a cena aleatória padrão, ou a sala com 'room'
+    bool room = false;
+    bool bvh = true;
+    bool sphere_sets = false;
+    bool sample_lights = true;
+    render_settings settings;    // Largura, amostras e threads vêm de bench_options
+};
+
+// Cena aleatória já convertida em objetos (ver random_scene.h)
+hittable_list random_scene(material_arena& materials, int grid_min = -2, int grid_max = 8) {
+    return build_world(make_random_scene(grid_min, grid_max), materials);
+}
+
+// Renderiza a mesma cena com 1..N threads e mostra a vazão em milhões de raios
+// primários por segundo, conferindo que todas as imagens são idênticas.
+void run_scaling_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                           render_settings settings) {
+    const int max_threads = settings.threads;
+    const double primary_rays = static_cast<double>(settings.image_width)
+                              * settings.image_height * settings.samples_per_pixel;
+    settings.progress = false;
+
+    framebuffer reference, fb;
+    double base_time = 0;
+
+    std::cerr << "threads  tempo(s)  Mrays/s  speedup  idêntico\n";
+    for (int n = 1; n <= max_threads; ++n) {
+        settings.threads = n;
+        auto start = std::chrono::steady_clock::now();
+        render(world, materials, cam, settings, fb);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (n == 1) {
+            reference = fb;
+            base_time = elapsed.count();
+        }
+        bool identical = reference.rgb == fb.rgb;
+
+        std::cerr << n << "  " << elapsed.count()
+                  << "  " << primary_rays / elapsed.count() / 1e6
+                  << "  " << base_time / elapsed.count()
+                  << "  " << (identical ? "sim" : "NAO") << '\n';
+    }
+}
+
+// Compara a lista linear com a BVH: tempo de construção e tempo para traçar o mesmo
+// conjunto de raios primários, conferindo que as duas encontram as mesmas interseções.
+void run_bvh_benchmark(const camera& cam) {
+    const int rays_x = 160, rays_y = 90;
+    std::vector<ray> rays;
+    for (int j = 0; j < rays_y; ++j)
+        for (int i = 0; i < rays_x; ++i) {
+            begin_sample(static_cast<std::uint64_t>(j) * rays_x + i, 0);
+            rays.push_back(cam.get_ray((i + random_double()) / (rays_x-1),
+                                       (j + random_double()) / (rays_y-1)));
+        }
+
+    auto trace = [&](const hittable& world, std::vector<double>& ts) {
+        ts.clear();
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& r : rays) {
+            hit_record rec;
+            ts.push_back(world.hit(r, 0.001, infinity, rec) ? rec.t : infinity);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+
+    std::cerr << "objetos  nós  construção(ms)  linear(Mrays/s)  bvh(Mrays/s)  iguais\n";
+    for (int grid : {8, 30, 100, 300}) {
+        thread_rng() = pcg32();
+        material_arena materials;
+        auto list = random_scene(materials, -grid / 2, grid / 2);
+
+        auto start = std::chrono::steady_clock::now();
+        bvh tree(list);
+        std::chrono::duration<double> build_time = std::chrono::steady_clock::now() - start;
+
+        std::vector<double> t_linear, t_bvh;
+        double linear_time = trace(list, t_linear);
+        double bvh_time = trace(tree, t_bvh);
+
+        std::cerr << list.objects.size() << "  " << tree.node_count()
+                  << "  " << build_time.count() * 1e3
+                  << "  " << rays.size() / linear_time / 1e6
+                  << "  " << rays.size() / bvh_time / 1e6
+                  << "  " << (t_linear == t_bvh ? "sim" : "NAO") << '\n';
+    }
+}
+
+// Compara uma hittable_list de esferas com um sphere_set das mesmas esferas, em cada
+// conjunto de instruções suportado, conferindo que os registros de interseção coincidem.
+void run_sphere_set_benchmark(const camera& cam) {
+    const int rays_x = 160, rays_y = 90;
+    std::vector<ray> rays;
+    for (int j = 0; j < rays_y; ++j)
+        for (int i = 0; i < rays_x; ++i) {
+            begin_sample(static_cast<std::uint64_t>(j) * rays_x + i, 0);
+            rays.push_back(cam.get_ray((i + random_double()) / (rays_x-1),
+                                       (j + random_double()) / (rays_y-1)));
+        }
+
+    auto trace = [&](const hittable& world, std::vector<double>& ts) {
+        ts.clear();
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& r : rays) {
+            hit_record rec;
+            if (world.hit(r, 0.001, infinity, rec)) {
+                ts.push_back(rec.t);
+                ts.push_back(rec.normal.x() + rec.normal.y() + rec.normal.z());
+            } else {
+                ts.push_back(infinity);
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return rays.size() / elapsed.count() / 1e6;
+    };
+
+    const simd_level best = detect_simd_level();
+    std::cerr << "esferas  lista(Mrays/s)";
+    for (auto level : {simd_level::scalar, simd_level::avx2, simd_level::avx512})
+        if (level <= best) std::cerr << "  " << simd_level_name(level) << "(Mrays/s)";
+    std::cerr << "  iguais\n";
+
+    for (int grid : {10, 30, 60}) {
+        thread_rng() = pcg32();
+        material_arena materials;
+        auto list = random_scene(materials, -grid / 2, grid / 2);
+        sphere_set set;
+        for (const auto& object : list.objects) {
+            auto s = std::dynamic_pointer_cast<sphere>(object);
+            set.add(s->center, s->radius, s->mat_id);
+        }
+
+        std::vector<double> reference, result;
+        std::cerr << set.size() << "  " << trace(list, reference);
+        bool identical = true;
+        for (auto level : {simd_level::scalar, simd_level::avx2, simd_level::avx512}) {
+            if (level > best) continue;
+            sphere_set::kernel() = level;
+            std::cerr << "  " << trace(set, result);
+            identical = identical && result == reference;
+        }
+        sphere_set::kernel() = best;
+        std::cerr << "  " << (identical ? "sim" : "NAO") << '\n';
+    }
+}
+
+// Mede a leitura de uma malha com 1, 2, 4, ... threads e o teste de triângulos em cada
+// nível de SIMD disponível, com raios que partem de uma esfera em volta da malha na
+// direção de pontos sorteados dentro da caixa dela. Os resultados precisam ser idênticos.
+void run_mesh_benchmark(const std::string& path) {
+    auto geometry = make_shared<mesh_data>();
+    std::string error;
+    const int cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cerr << "threads  leitura(ms)\n";
+    for (int threads = 1; ; threads *= 2) {
+        threads = std::min(threads, cores);
+        double best = infinity;
+        for (int run = 0; run < 3; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            if (!load_mesh(path, *geometry, error, threads)) {
+                std::cerr << "Erro ao ler a malha: " << error << '\n';
+                return;
+            }
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::cerr << threads << "  " << best * 1000 << '\n';
+        if (threads == cores) break;
+    }
+    std::cerr << path << ": " << geometry->vertex_count() << " vértices, "
+              << geometry->triangle_count() << " triângulos\n";
+    if (geometry->triangle_count() == 0) return;
+
+    const simd_level best_level = detect_simd_level();
+    triangle_mesh::kernel() = simd_level::scalar;
+    aabb box;
+    triangle_mesh(geometry, 0).bounding_box(0, 0, box);
+    const vec3 size = box.max() - box.min();
+    const point3 center = box.centroid();
+    const double radius = size.length();
+    std::vector<ray> rays;
+    thread_rng() = pcg32();
+    for (int k = 0; k < 1 << 18; ++k) {
+        const point3 target(box.min().x() + random_double() * size.x(),
+                            box.min().y() + random_double() * size.y(),
+                            box.min().z() + random_double() * size.z());
+        const point3 origin = center + radius * random_unit_vector();
+        rays.push_back(ray(origin, target - origin));
+    }
+
+    std::cerr << "nível  construção(ms)  Mrays/s  acertos  iguais\n";
+    std::vector<double> reference, result;
+    for (auto level : {simd_level::scalar, simd_level::avx2, simd_level::avx512}) {
+        if (level > best_level) continue;
+        triangle_mesh::kernel() = level;
+        auto start = std::chrono::steady_clock::now();
+        const triangle_mesh mesh(geometry, 0);
+        const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.clear();
+        size_t hits = 0;
+        start = std::chrono::steady_clock::now();
+        for (const auto& r : rays) {
+            hit_record rec;
+            if (mesh.hit(r, 0.001, infinity, rec)) {
+                ++hits;
+                result.push_back(rec.t);
+            } else {
+                result.push_back(infinity);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (reference.empty()) reference = result;
+        std::cerr << simd_level_name(level) << "  " << build_seconds * 1000 << "  "
+                  << rays.size() / seconds / 1e6 << "  " << hits << "  "
+                  << (result == reference ? "sim" : "NAO") << '\n';
+    }
+    triangle_mesh::kernel() = best_level;
+}
+
+// Compara o integrador recursivo com o wavefront em várias profundidades máximas:
+// tempo de renderização e diferença RMS entre as duas imagens.
+void run_wavefront_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                             render_settings settings) {
+    settings.progress = false;
+    framebuffer recursive_fb, wavefront_fb;
+
+    std::cerr << "max_depth  recursivo(s)  wavefront(s)  speedup  rms\n";
+    for (int depth : {5, 50, 200}) {
+        settings.max_depth = depth;
+
+        settings.wavefront = false;
+        auto start = std::chrono::steady_clock::now();
+        render(world, materials, cam, settings, recursive_fb);
+        std::chrono::duration<double> recursive_time = std::chrono::steady_clock::now() - start;
+
+        settings.wavefront = true;
+        start = std::chrono::steady_clock::now();
+        render(world, materials, cam, settings, wavefront_fb);
+        std::chrono::duration<double> wavefront_time = std::chrono::steady_clock::now() - start;
+
+        double err = 0;
+        for (size_t k = 0; k < recursive_fb.pixel_count(); ++k)
+            err += ((recursive_fb.get(k) - wavefront_fb.get(k)) / settings.samples_per_pixel).length_squared();
+        err = sqrt(err / (3.0 * recursive_fb.pixel_count()));
+
+        std::cerr << depth << "  " << recursive_time.count() << "  " << wavefront_time.count()
+                  << "  " << recursive_time.count() / wavefront_time.count()
+                  << "  " << err << '\n';
+    }
+}
+
+// Compara ray_color com e sem roleta russa: raios traçados, tempo e brilho médio da
+// imagem (que deve ser o mesmo, a menos de ruído, já que a roleta não tem viés).
+void run_roulette_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                            render_settings settings) {
+    settings.progress = false;
+    const int primary = settings.image_width * settings.image_height * settings.samples_per_pixel;
+    framebuffer fb;
+
+    std::cerr << "roleta  raios  reflexões  reflexões/amostra  tempo(s)  média\n";
+    for (bool enabled : {false, true}) {
+        settings.rr.enabled = enabled;
+        counting_hittable counter(world);
+
+        auto start = std::chrono::steady_clock::now();
+        render(counter, materials, cam, settings, fb);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        color sum(0,0,0);
+        for (size_t k = 0; k < fb.pixel_count(); ++k) sum += fb.get(k);
+        const double mean = (sum.x() + sum.y() + sum.z()) / (3.0 * primary);
+        const std::uint64_t rays = counter.count.load();
+
+        std::cerr << (enabled ? "sim" : "não") << "  " << rays << "  " << rays - primary
+                  << "  " << static_cast<double>(rays - primary) / primary
+                  << "  " << elapsed.count() << "  " << mean << '\n';
+    }
+}
+
+// Compara a amostragem adaptativa com a uniforme. Uma referência com muitas amostras
+// serve de imagem "exata"; a amostragem uniforme usa o mesmo total de amostras da
+// adaptativa, e como o erro cai com 1/sqrt(amostras), dá para estimar quantas amostras
+// uniformes seriam necessárias para igualar o erro da adaptativa.
+void run_adaptive_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                            render_settings settings) {
+    settings.progress = false;
+    const size_t pixels = static_cast<size_t>(settings.image_width) * settings.image_height;
+    const int reference_spp = 512;
+
+    framebuffer reference, uniform_fb, adaptive_fb;
+    render_settings ref_settings = settings;
+    ref_settings.samples_per_pixel = reference_spp;
+    render(world, materials, cam, ref_settings, reference);
+    for (auto& v : reference.rgb) v /= reference_spp;
+
+    std::cerr << "limiar  amostras/pixel  rms adaptativa  rms uniforme  amostras uniformes p/ mesmo erro  economia\n";
+    for (double threshold : {0.04, 0.02, 0.01}) {
+        settings.noise_threshold = threshold;
+        accumulation_buffer acc;
+        render_adaptive(world, materials, cam, settings, acc);
+        acc.resolve(adaptive_fb);
+        const double adaptive_spp = static_cast<double>(acc.total_samples()) / pixels;
+        const double adaptive_err = display_rmse(adaptive_fb, reference);
+
+        render_settings uni = settings;
+        uni.samples_per_pixel = std::max(1, static_cast<int>(adaptive_spp + 0.5));
+        render(world, materials, cam, uni, uniform_fb);
+        for (auto& v : uniform_fb.rgb) v /= uni.samples_per_pixel;
+        const double uniform_err = display_rmse(uniform_fb, reference);
+
+        const double equal_spp = uni.samples_per_pixel * (uniform_err / adaptive_err) * (uniform_err / adaptive_err);
+        std::cerr << threshold << "  " << adaptive_spp << "  " << adaptive_err << "  " << uniform_err
+                  << "  " << equal_spp << "  " << 100.0 * (1.0 - adaptive_spp / equal_spp) << "%\n";
+    }
+}
+
+// Curvas de qualidade por amostras por pixel, com e sem o denoiser: compara imagens
+// com 1, 2, 4, ... amostras a uma referência de 1024 amostras e mostra o erro RMS da
+// imagem crua e da filtrada, com o tempo de cada etapa. No fim indica quantas amostras
+// a imagem filtrada precisa para ficar com erro menor que o da crua com
+// samples_per_pixel amostras.
+void run_denoise_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                           render_settings settings) {
+    settings.progress = false;
+    const int target_spp = settings.samples_per_pixel;
+    constexpr int reference_spp = 1024;
+
+    framebuffer reference, fb, denoised;
+    settings.samples_per_pixel = reference_spp;
+    render(world, materials, cam, settings, reference);
+    for (auto& v : reference.rgb) v /= reference_spp;
+
+    feature_buffer features;
+    settings.features = &features;
+    double render_seconds = 0, denoise_seconds = 0;
+    auto measure = [&](int spp, double& raw_err, double& denoised_err) {
+        settings.samples_per_pixel = spp;
+        auto start = std::chrono::steady_clock::now();
+        render(world, materials, cam, settings, fb);
+        auto rendered = std::chrono::steady_clock::now();
+        features.normalize(1.0 / spp);
+        denoise(fb, 1.0 / spp, features, denoise_settings(), settings.threads, denoised);
+        render_seconds = std::chrono::duration<double>(rendered - start).count();
+        denoise_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - rendered).count();
+        for (auto& v : fb.rgb) v /= spp;
+        raw_err = display_rmse(fb, reference);
+        denoised_err = display_rmse(denoised, reference);
+    };
+
+    double target_raw, target_denoised;
+    measure(target_spp, target_raw, target_denoised);
+
+    std::cerr << "amostras  rms cru  rms filtrado  renderização(s)  denoiser(ms)\n";
+    int enough_spp = 0;
+    double enough_err = 0;
+    for (int spp = 1; spp < reference_spp / 4; spp *= 2) {
+        double raw_err, denoised_err;
+        measure(spp, raw_err, denoised_err);
+        std::cerr << spp << "  " << raw_err << "  " << denoised_err << "  " << render_seconds
+                  << "  " << denoise_seconds * 1000 << '\n';
+        if (!enough_spp && denoised_err <= target_raw) {
+            enough_spp = spp;
+            enough_err = denoised_err;
+        }
+    }
+
+    std::cerr << "Sem o denoiser, " << target_spp << " amostras por pixel: rms " << target_raw
+              << " (filtrada: " << target_denoised << ")\n";
+    if (enough_spp)
+        std::cerr << "Com o denoiser, " << enough_spp << " amostras por pixel já dão rms " << enough_err
+                  << " (" << static_cast<double>(target_spp) / enough_spp << "x menos amostras)\n";
+    else
+        std::cerr << "Nenhuma contagem testada alcança esse erro com o denoiser\n";
+}
+
+// Compara as sequências de amostras (ver sampler.h) pelo erro RMS em relação a uma
+// referência de 1024 amostras por pixel, com o mesmo número de amostras em cada modo.
+// A referência usa o modo random, o único cujos erros de amostras diferentes são
+// independentes, então o seu próprio ruído entra igualmente em todas as medidas.
+void run_sampler_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                           render_settings settings) {
+    settings.progress = false;
+    constexpr int reference_spp = 1024;
+    const sampler_mode modes[3] = {sampler_mode::random, sampler_mode::sobol, sampler_mode::blue_noise};
+
+    framebuffer reference, fb;
+    settings.sampler = sampler_mode::random;
+    settings.samples_per_pixel = reference_spp;
+    render(world, materials, cam, settings, reference);
+    for (auto& v : reference.rgb) v /= reference_spp;
+
+    blue_noise_mask();  // Gera a máscara fora das medidas de tempo
+    std::cerr << "amostras  rms random  rms sobol  rms blue-noise  tempo random/sobol/blue-noise (s)\n";
+    for (int spp = 1; spp <= 64; spp *= 2) {
+        double err[3], seconds[3];
+        for (int m = 0; m < 3; ++m) {
+            settings.sampler = modes[m];
+            settings.samples_per_pixel = spp;
+            auto start = std::chrono::steady_clock::now();
+            render(world, materials, cam, settings, fb);
+            seconds[m] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (auto& v : fb.rgb) v /= spp;
+            err[m] = display_rmse(fb, reference);
+        }
+        std::cerr << spp << "  " << err[0] << "  " << err[1] << "  " << err[2] << "  "
+                  << seconds[0] << '/' << seconds[1] << '/' << seconds[2] << '\n';
+    }
+}
+
+// Compara os caminhos com e sem a amostragem direta das luzes (ver lights.h) pelo erro
+// RMS em relação a uma referência de 1024 amostras por pixel com NEE, e mede o custo do
+// raio de sombra com a consulta de oclusão e com a busca da interseção mais próxima.
+void run_nee_benchmark(const hittable& world, const material_arena& materials, const camera& cam,
+                       render_settings settings, const light_list& lights) {
+    if (lights.empty()) {
+        std::cerr << "A cena não tem luzes (use --room ou uma cena com 'light')\n";
+        return;
+    }
+    settings.progress = false;
+    constexpr int reference_spp = 1024;
+
+    framebuffer reference, fb;
+    settings.lights = &lights;
+    settings.samples_per_pixel = reference_spp;
+    render(world, materials, cam, settings, reference);
+    for (auto& v : reference.rgb) v /= reference_spp;
+
+    std::cerr << "amostras  rms sem NEE  rms com NEE  tempo sem/com (s)\n";
+    for (int spp = 1; spp <= 64; spp *= 2) {
+        double err[2], seconds[2];
+        for (int m = 0; m < 2; ++m) {
+            settings.lights = m == 0 ? nullptr : &lights;
+            settings.samples_per_pixel = spp;
+            auto start = std::chrono::steady_clock::now();
+            render(world, materials, cam, settings, fb);
+            seconds[m] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            for (auto& v : fb.rgb) v /= spp;
+            err[m] = display_rmse(fb, reference);
+        }
+        std::cerr << spp << "  " << err[0] << "  " << err[1] << "  "
+                  << seconds[0] << '/' << seconds[1] << '\n';
+    }
+
+    // Raios de sombra a partir dos pontos difusos vistos pela câmera, os mesmos nas duas consultas
+    std::vector<hit_record> points;
+    const int w = settings.image_width, h = settings.image_height;
+    for (int j = 0; j < h; ++j)
+        for (int i = 0; i < w; ++i) {
+            begin_sample(static_cast<std::uint64_t>(j) * w + i, 0);
+            const ray r = cam.get_ray((i + random_double()) / (w-1), (j + random_double()) / (h-1));
+            hit_record rec;
+            if (world.hit(r, 0.001, infinity, rec) && materials.kind(rec.mat_id) == material_kind::lambertian)
+                points.push_back(rec);
+        }
+    if (points.empty()) return;
+
+    constexpr int rounds = 16;
+    auto shadow_queries = [&](const light_list& queries, double& visible) {
+        visible = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round)
+            for (size_t k = 0; k < points.size(); ++k) {
+                begin_sample(k, round);
+                visible += luminance(queries.sample_direct(world, materials, points[k], 0));
+            }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    light_list closest = lights;
+    closest.any_hit = false;
+    double visible_any, visible_closest;
+    const double any_seconds = shadow_queries(lights, visible_any);
+    const double closest_seconds = shadow_queries(closest, visible_closest);
+    const double queries = static_cast<double>(points.size()) * rounds;
+    std::cerr << "raios de sombra: " << queries << ", oclusão " << any_seconds * 1e9 / queries
+              << " ns, interseção mais próxima " << closest_seconds * 1e9 / queries << " ns ("
+              << closest_seconds / any_seconds << "x), mesmo resultado: "
+              << (visible_any == visible_closest ? "sim" : "NAO") << '\n';
+}
+
+// Memória residente do processo em bytes, lida de /proc (zero fora do Linux)
+std::uint64_t resident_bytes() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmRSS:") == 0) return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+    return 0;
+}
+
+// Compara o campo de bolinhas instanciado (ver instanced_scene.h) com o mesmo campo
+// criado esfera a esfera: tempo de construção, memória acrescentada ao processo e
+// vazão da renderização. Os campos instanciados vêm primeiro, para que a memória que
+// eles liberam não esconda a do campo plano. As imagens do campo de 10 x 10 blocos
+// instanciado e plano precisam ser praticamente iguais.
+void run_instance_benchmark(render_settings settings) {
+    settings.progress = false;
+    const scene_data description = make_field_scene();
+    settings.image_height = static_cast<int>(settings.image_width / description.cam.aspect_ratio);
+    const camera cam = make_camera(description.cam);
+
+    framebuffer images[2];
+    std::cerr << "blocos  esferas  modo  construção(s)  memória(MB)  renderização(s)  Mrays/s\n";
+    auto measure = [&](int blocks, bool flatten, framebuffer& fb) {
+        thread_rng() = pcg32();
+        const std::uint64_t memory_before = resident_bytes();
+        auto start = std::chrono::steady_clock::now();
+        material_arena materials;
+        hittable_list list = build_world(description, materials);
+        for (const auto& object : make_sphere_field(materials, blocks, flatten).objects)
+            list.add(object);
+        const bvh world(list, 0, 0, settings.dispatch);
+        const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const double memory = static_cast<double>(resident_bytes() - memory_before);
+
+        counting_hittable counter(world);
+        start = std::chrono::steady_clock::now();
+        render(counter, materials, cam, settings, fb);
+        const double render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (auto& v : fb.rgb) v /= settings.samples_per_pixel;
+        std::cerr << blocks << "x" << blocks << "  " << 1e4 * blocks * blocks << "  "
+                  << (flatten ? "plano" : "instâncias") << "  " << build_seconds << "  " << memory / 1e6
+                  << "  " << render_seconds << "  " << counter.count.load() / render_seconds / 1e6 << '\n';
+    };
+    framebuffer discard;
+    measure(10, false, images[0]);
+    measure(100, false, discard);
+    measure(316, false, discard);
+    measure(10, true, images[1]);
+    std::cerr << "Diferença RMS entre o campo instanciado e o plano (10x10 blocos): "
+              << display_rmse(images[0], images[1]) << '\n';
+}
+
+// Compara o despacho virtual com o estático (std::variant) na mesma cena: a BVH e os
+// materiais são chamados pela vtable em um caso e pelo conjunto fechado de tipos no
+// outro. As rodadas dos dois modos se alternam e vale o melhor tempo de cada um, para
+// que variações da máquina afetem os dois igualmente. As imagens precisam ser idênticas.
+void run_dispatch_benchmark(const hittable_list& scene, const material_arena& materials,
+                            const camera& cam, render_settings settings) {
+    settings.progress = false;
+    const double primary_rays = static_cast<double>(settings.image_width)
+                              * settings.image_height * settings.samples_per_pixel;
+    const dispatch_mode modes[2] = {dispatch_mode::virtual_calls, dispatch_mode::static_variant};
+    const bvh worlds[2] = {bvh(scene, 0, 0, modes[0]), bvh(scene, 0, 0, modes[1])};
+    framebuffer images[2];
+    double best[2] = {infinity, infinity};
+
+    for (int run = 0; run < 5; ++run) {
+        for (int m = 0; m < 2; ++m) {
+            settings.dispatch = modes[m];
+            auto start = std::chrono::steady_clock::now();
+            render(worlds[m], materials, cam, settings, images[m]);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best[m] = std::min(best[m], elapsed.count());
+        }
+    }
+
+    std::cerr << "despacho  tempo(s)  Mrays/s  speedup\n";
+    for (int m = 0; m < 2; ++m)
+        std::cerr << (m == 0 ? "virtual" : "variant") << "  " << best[m]
+                  << "  " << primary_rays / best[m] / 1e6 << "  " << best[0] / best[m] << '\n';
+    std::cerr << "idêntico: " << (images[0].rgb == images[1].rgb ? "sim" : "NAO") << '\n';
+}
+
+
+// Renderiza dois quadros de uma turntable parada (0 graus por quadro, obturador fechado),
+// pelo integrador recursivo e pelo wavefront. A cena é a mesma nos dois quadros, então a
+// diferença entre eles vem só das sementes das amostras, que incluem o número do quadro:
+// os quadros precisam diferir, os dois integradores precisam concordar em cada quadro e o
+// quadro 0 precisa ser igual à renderização de uma imagem só.
+void run_frames_benchmark(const scene_data& description, render_settings settings) {
+    settings.progress = false;
+    settings.lights = nullptr;
+    sequence_settings seq;
+    seq.frames = 2;
+    seq.sample_lights = false;
+    framebuffer images[2][2];  // [integrador][quadro]
+    for (int w = 0; w < 2; ++w) {
+        settings.wavefront = w == 1;
+        material_arena materials;
+        turntable anim(description, materials, 0, 0);
+        framebuffer fb;
+        render_sequence(anim, materials, settings, seq, fb,
+                        [&](int f, const framebuffer& image, const frame_timing&) { images[w][f] = image; });
+    }
+
+    material_arena materials;
+    turntable still(description, materials, 0, 0);
+    still.set_frame(0);
+    const bvh world(still.objects(), still.time0(), still.time1(), settings.dispatch);
+    settings.wavefront = false;
+    framebuffer single;
+    render(world, materials, make_camera(still.camera_params(), still.time0(), still.time1()), settings, single);
+
+    std::cerr << "Diferença RMS entre os quadros 0 e 1: " << display_rmse(images[0][0], images[0][1]) << '\n'
+              << "quadros diferentes: " << (images[0][0].rgb != images[0][1].rgb ? "sim" : "NAO") << '\n'
+              << "wavefront idêntico: "
+              << (images[0][0].rgb == images[1][0].rgb && images[0][1].rgb == images[1][1].rgb ? "sim" : "NAO") << '\n'
+              << "quadro 0 idêntico à imagem única: " << (images[0][0].rgb == single.rgb ? "sim" : "NAO") << '\n';
+}
+
+
+// Prepara a cena pedida e roda a comparação 'name'; retorna o código de saída
+int run_comparison(compare_options opt) {
+    render_settings& settings = opt.settings;
+    if (opt.name == "mesh") {
+        run_mesh_benchmark(opt.mesh_path);
+        return 0;
+    }
+    if (opt.name == "instance") {
+        run_instance_benchmark(settings);
+        return 0;
+    }
+
+    scene_data description;
+    shared_ptr<texture_cache> textures;
+    if (!opt.scene_path.empty()) {
+        std::string error;
+        if (!load_scene(opt.scene_path, description, error)) {
+            std::cerr << "Erro ao ler a cena: " << error << '\n';
+            return 1;
+        }
+        if (description.texture_count() > 0) {
+            textures = make_shared<texture_cache>(std::uint64_t(256) << 20);
+            if (!description.open_textures(opt.scene_path, textures, error)) {
+                std::cerr << "Erro ao abrir as texturas: " << error << '\n';
+                return 1;
+            }
+        }
+    } else {
+        description = opt.room ? make_room_scene() : make_random_scene();
+    }
+    settings.image_height = static_cast<int>(settings.image_width / description.cam.aspect_ratio);
+    if (settings.image_height < 2) {
+        std::cerr << "Imagem de " << settings.image_width << "x" << settings.image_height
+                  << " pixels: a largura e a altura precisam ser pelo menos 2\n";
+        return 1;
+    }
+    if (textures) textures->set_pixel_angle(degrees_to_radians(description.cam.vfov) / settings.image_height);
+
+    material_arena arena;
+    hittable_list objects = build_world(description, arena);
+    scene_options options;
+    options.bvh = opt.bvh;
+    options.sphere_sets = opt.sphere_sets;
+    options.dispatch = settings.dispatch;
+    const auto prepared = make_render_scene(std::move(objects), std::move(arena), options);
+    const material_arena& materials = prepared->materials;
+    const hittable& world = *prepared->world;
+    if (opt.sample_lights && !prepared->lights.empty())
+        settings.lights = &prepared->lights;
+    const camera cam = make_camera(description.cam);
+
+    if (opt.name == "scaling") run_scaling_benchmark(world, materials, cam, settings);
+    else if (opt.name == "bvh") run_bvh_benchmark(cam);
+    else if (opt.name == "sphere-set") run_sphere_set_benchmark(cam);
+    else if (opt.name == "wavefront") run_wavefront_benchmark(world, materials, cam, settings);
+    else if (opt.name == "rr") run_roulette_benchmark(world, materials, cam, settings);
+    else if (opt.name == "adaptive" && !adaptive_settings_error(settings).empty()) {
+        std::cerr << "adaptive: " << adaptive_settings_error(settings) << '\n';
+        return 1;
+    } else if (opt.name == "adaptive") run_adaptive_benchmark(world, materials, cam, settings);
+    else if (opt.name == "dispatch") run_dispatch_benchmark(prepared->objects, materials, cam, settings);
+    else if (opt.name == "denoise") run_denoise_benchmark(world, materials, cam, settings);
+    else if (opt.name == "sampler") run_sampler_benchmark(world, materials, cam, settings);
+    else if (opt.name == "nee") run_nee_benchmark(world, materials, cam, settings, prepared->lights);
+    else if (opt.name == "frames") run_frames_benchmark(description, settings);
+    else {
+        std::cerr << "Comparação desconhecida: " << opt.name << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+// Lê os ns_per_op de um JSON gravado por este programa. O arquivo tem um resultado por
+// linha, então basta procurar os dois campos em cada linha.
+std::map<std::string, double> read_baseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto name_at = line.find("\"name\": \"");
+        auto ns_at = line.find("\"ns_per_op\": ");
+        if (name_at == std::string::npos || ns_at == std::string::npos) continue;
+        name_at += 9;
+        auto name_end = line.find('"', name_at);
+        baseline[line.substr(name_at, name_end - name_at)] = std::atof(line.c_str() + ns_at + 13);
+    }
+    return baseline;
+}
+
+std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + '"';
+}
+
+void write_json(std::ostream& out, const std::vector<bench_result>& results, const bench_options& opt,
+                const std::string& label, const std::map<std::string, double>& baseline) {
+    out.precision(6);
+    out << "{\n";
+    out << "  \"label\": " << json_string(label) << ",\n";
+    out << "  \"precision\": \"" << (std::is_same<real, float>::value ? "float" : "double") << "\",\n";
+    out << "  \"simd\": \"" << simd_level_name(detect_simd_level()) << "\",\n";
+#ifdef __VERSION__
+    out << "  \"compiler\": " << json_string(__VERSION__) << ",\n";
+#endif
+    out << "  \"threads\": " << opt.threads << ",\n";
+    out << "  \"repeats\": " << opt.repeats << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const auto& r = results[k];
+        out << "    {\"name\": " << json_string(r.name) << ", \"ns_per_op\": " << r.ns_per_op
+            << ", \"min_ns\": " << r.min_ns << ", \"max_ns\": " << r.max_ns << ", \"ops\": " << r.ops;
+        for (const auto& field : r.extra)
+            out << ", \"" << field.first << "\": " << field.second;
+        auto base = baseline.find(r.name);
+        if (base != baseline.end())
+            out << ", \"baseline_ns\": " << base->second << ", \"speedup_vs_baseline\": " << base->second / r.ns_per_op;
+        out << '}' << (k + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    bench_options opt;
+    compare_options compare;
+    std::string output_path, baseline_path, label;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        if (arg == "--output" && has_value) output_path = argv[++a];
+        else if (arg == "--baseline" && has_value) baseline_path = argv[++a];
+        else if (arg == "--label" && has_value) label = argv[++a];
+        else if (arg == "--filter" && has_value) opt.filter = argv[++a];
+        else if (arg == "--repeats" && has_value) opt.repeats = std::max(1, std::atoi(argv[++a]));
+        else if (arg == "--min-time" && has_value) opt.min_time = std::atof(argv[++a]);
+        else if (arg == "--threads" && has_value) opt.threads = std::max(1, std::atoi(argv[++a]));
+        else if (arg == "--width" && has_value) opt.width = std::atoi(argv[++a]);
+        else if (arg == "--spp" && has_value) opt.spp = std::atoi(argv[++a]);
+        else if (arg == "--quick") { opt.repeats = 3; opt.min_time = 0.01; opt.width = 100; }
+        else if (arg == "--no-kernels") opt.kernels = false;
+        else if (arg == "--no-frames") opt.frames = false;
+        else if (arg == "--compare" && has_value) {
+            compare.name = argv[++a];
+            if (compare.name == "mesh" && a + 1 < argc) compare.mesh_path = argv[++a];
+        }
+        else if (arg == "--scene" && has_value) compare.scene_path = argv[++a];
+        else if (arg == "--room") compare.room = true;
+        else if (arg == "--no-bvh") compare.bvh = false;
+        else if (arg == "--sphere-sets") compare.sphere_sets = true;
+        else if (arg == "--no-nee") compare.sample_lights = false;
+        else if (arg == "--tile" && has_value) compare.settings.tile_size = std::max(1, std::atoi(argv[++a]));
+        else if (arg == "--max-depth" && has_value) compare.settings.max_depth = std::atoi(argv[++a]);
+        else if (arg == "--sampler" && has_value && parse_sampler(argv[a + 1], compare.settings.sampler)) ++a;
+        else if (arg == "--no-rr") compare.settings.rr.enabled = false;
+        else if (arg == "--rr-start" && has_value) compare.settings.rr.start_depth = std::atoi(argv[++a]);
+        else if (arg == "--rr-min-prob" && has_value) compare.settings.rr.min_probability = std::atof(argv[++a]);
+        else if (arg == "--virtual-dispatch") compare.settings.dispatch = dispatch_mode::virtual_calls;
+        else if (arg == "--noise" && has_value) compare.settings.noise_threshold = std::atof(argv[++a]);
+        else if (arg == "--max-spp" && has_value) compare.settings.max_samples_per_pixel = std::atoi(argv[++a]);
+        else if (arg == "--pass-spp" && has_value) compare.settings.pass_samples = std::atoi(argv[++a]);
+        else {
+            std::cerr << "Uso: " << argv[0]
+                      << " [--output arquivo.json] [--baseline anterior.json] [--label texto]"
+                         " [--filter nome] [--repeats N] [--min-time S] [--threads N]"
+                         " [--width N] [--spp N] [--quick] [--no-kernels] [--no-frames]\n"
+                         "       " << argv[0]
+                      << " --compare scaling|bvh|sphere-set|wavefront|rr|adaptive|dispatch|denoise|sampler|nee|instance|frames"
+                         " [--scene arquivo.scn|.scnb | --room] [--threads N] [--width N] [--spp N] [--tile N]"
+                         " [--max-depth N] [--sampler random|sobol|blue-noise] [--no-rr] [--rr-start N]"
+                         " [--rr-min-prob P] [--no-nee] [--no-bvh] [--sphere-sets] [--virtual-dispatch]"
+                         " [--noise T] [--max-spp N] [--pass-spp N]\n"
+                         "       " << argv[0] << " --compare mesh arquivo.obj|.ply\n";
+            return 1;
+        }
+    }
+
+    if (!compare.name.empty()) {
+        compare.settings.image_width = std::max(2, opt.width);
+        compare.settings.samples_per_pixel = std::max(1, opt.spp);
+        compare.settings.threads = opt.threads;
+        return run_comparison(compare);
+    }
+
+    std::vector<bench_result> results;
+    if (opt.kernels) run_kernel_benchmarks(opt, results);
+    if (opt.frames) run_frame_benchmarks(opt, results);
+
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty()) {
+        baseline = read_baseline(baseline_path);
+        if (baseline.empty())
+            std::cerr << "Nenhum resultado em " << baseline_path << '\n';
+        std::cerr << "benchmark  ns/op  anterior  speedup\n";
+        for (const auto& r : results) {
+            auto base = baseline.find(r.name);
+            if (base == baseline.end()) continue;
+            std::cerr << r.name << "  " << r.ns_per_op << "  " << base->second
+                      << "  " << base->second / r.ns_per_op << '\n';
+        }
+    }
+
+    if (output_path.empty()) {
+        write_json(std::cout, results, opt, label, baseline);
+    } else {
+        std::ofstream out(output_path);
+        write_json(out, results, opt, label, baseline);
+        if (!out) {
+            std::cerr << "Não foi possível gravar " << output_path << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
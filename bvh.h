@@ -0,0 +1,432 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "rtweekend.h"
+
+#include "aabb.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "primitive.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Nó da hierarquia já achatada em um vetor. O filho esquerdo de um nó interno é
+// sempre o nó seguinte no vetor; o direito fica em 'offset'. Em uma folha, 'offset'
+// é o índice do primeiro primitivo e 'count' a quantidade de primitivos.
+struct alignas(64) bvh_node {
+    aabb box;           // Caixa que envolve todo o conteúdo do nó
+    int offset;         // Filho direito (nó interno) ou primeiro primitivo (folha)
+    int count;          // Número de primitivos; 0 indica nó interno
+    int axis;           // Eixo usado na divisão, para escolher o filho mais próximo
+};
+
+// Parâmetros de uma construção por SAH
+struct bvh_build_settings {
+    int max_leaf_size = 8;  // Folhas com mais primitivos são sempre divididas
+    int leaf_group = 1;     // Primitivos testados juntos nas folhas (lanes SIMD); o custo de uma folha conta grupos
+};
+
+// Primitivo visto pelo construtor: a caixa, o centróide e a posição na ordem original
+struct bvh_build_prim {
+    aabb box;
+    point3 centroid;
+    int index;
+};
+
+// Construtor da hierarquia pela heurística de área de superfície (SAH) com binning,
+// separado de bvh para servir também às hierarquias internas de outros objetos (ver
+// triangle_mesh). Só enxerga caixas e centróides: build reordena 'prims' na ordem das
+// folhas e grava a árvore achatada em pré-ordem, com offset e count das folhas
+// indexando o vetor reordenado.
+class bvh_builder {
+public:
+    explicit bvh_builder(const bvh_build_settings& settings = bvh_build_settings()) : settings(settings) {}
+
+    void build(std::vector<bvh_build_prim>& prims, std::vector<bvh_node>& nodes);
+
+public:
+    static constexpr int bin_count = 16;            // Número de bins por eixo na SAH
+    static constexpr int parallel_threshold = 8192; // Subárvores maiores são construídas em paralelo
+    static constexpr double traversal_cost = 1.0;   // Custo relativo de visitar um nó
+    static constexpr double intersection_cost = 1.0;// Custo relativo de testar um grupo de primitivos
+
+private:
+    struct build_node {
+        aabb box;
+        std::unique_ptr<build_node> child[2];
+        int first = 0, count = 0, axis = 0;
+    };
+
+    // Grupos de leaf_group primitivos necessários para testar 'count' primitivos
+    int groups(int count) const { return (count + settings.leaf_group - 1) / settings.leaf_group; }
+
+    // Amplia 'box' para conter [lo, hi]. Faz o mesmo que surrounding_box, mas com
+    // std::min e std::max, que viram instruções, em vez de fmin e fmax, que viram
+    // chamadas à libm: com milhões de primitivos (malhas) é o que domina a construção.
+    static void grow(aabb& box, const point3& lo, const point3& hi) {
+        for (int a = 0; a < 3; ++a) {
+            box.minimum[a] = std::min(box.minimum[a], lo[a]);
+            box.maximum[a] = std::max(box.maximum[a], hi[a]);
+        }
+    }
+
+    std::unique_ptr<build_node> build(std::vector<bvh_build_prim>& prims, int begin, int end,
+                                      int depth, int& total_nodes) const;
+    static int flatten(const build_node* node, std::vector<bvh_node>& nodes);
+
+private:
+    bvh_build_settings settings;
+};
+
+
+inline void bvh_builder::build(std::vector<bvh_build_prim>& prims, std::vector<bvh_node>& nodes) {
+    nodes.clear();
+    if (prims.empty()) return;
+    int total_nodes = 0;
+    auto root = build(prims, 0, static_cast<int>(prims.size()), 0, total_nodes);
+    nodes.reserve(total_nodes);
+    flatten(root.get(), nodes);
+}
+
+inline std::unique_ptr<bvh_builder::build_node> bvh_builder::build(std::vector<bvh_build_prim>& prims,
+                                                                   int begin, int end, int depth,
+                                                                   int& total_nodes) const {
+    auto node = std::make_unique<build_node>();
+    total_nodes++;
+
+    aabb centroid_box;
+    for (int i = begin; i < end; ++i) {
+        grow(node->box, prims[i].box.minimum, prims[i].box.maximum);
+        grow(centroid_box, prims[i].centroid, prims[i].centroid);
+    }
+
+    const int count = end - begin;
+    auto make_leaf = [&]() {
+        node->first = begin;
+        node->count = count;
+        return std::move(node);
+    };
+
+    if (count == 1 || depth >= 60)
+        return make_leaf();
+
+    // Procura, entre todos os eixos, o plano de divisão de menor custo SAH
+    struct bin {
+        aabb box;
+        int count = 0;
+    };
+
+    int best_axis = -1, best_split = -1;
+    double best_cost = infinity;
+    const double parent_area = node->box.surface_area();
+
+    for (int axis = 0; axis < 3; ++axis) {
+        const double cmin = centroid_box.min()[axis];
+        const double extent = centroid_box.max()[axis] - cmin;
+        if (extent <= 0) continue;
+
+        bin bins[bin_count];
+        const double scale = bin_count / extent;
+        for (int i = begin; i < end; ++i) {
+            int b = std::min(bin_count - 1, static_cast<int>((prims[i].centroid[axis] - cmin) * scale));
+            bins[b].count++;
+            grow(bins[b].box, prims[i].box.minimum, prims[i].box.maximum);
+        }
+
+        // Varredura da direita para a esquerda acumulando área e contagem
+        double right_area[bin_count];
+        int right_count[bin_count];
+        aabb acc;
+        int acc_count = 0;
+        for (int b = bin_count - 1; b > 0; --b) {
+            acc = surrounding_box(acc, bins[b].box);
+            acc_count += bins[b].count;
+            right_area[b] = acc.surface_area();
+            right_count[b] = acc_count;
+        }
+
+        acc = aabb();
+        acc_count = 0;
+        for (int b = 0; b < bin_count - 1; ++b) {
+            acc = surrounding_box(acc, bins[b].box);
+            acc_count += bins[b].count;
+            if (acc_count == 0 || right_count[b + 1] == 0) continue;
+
+            double cost = traversal_cost + intersection_cost *
+                (acc.surface_area() * groups(acc_count) + right_area[b + 1] * groups(right_count[b + 1])) / parent_area;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    int mid;
+    if (best_axis < 0) {
+        // Todos os centróides coincidem: não há divisão útil
+        if (count <= settings.max_leaf_size)
+            return make_leaf();
+        mid = begin + count / 2;
+        node->axis = 0;
+    } else {
+        if (best_cost >= groups(count) * intersection_cost && count <= settings.max_leaf_size)
+            return make_leaf();
+
+        const double cmin = centroid_box.min()[best_axis];
+        const double scale = bin_count / (centroid_box.max()[best_axis] - cmin);
+        auto it = std::partition(prims.begin() + begin, prims.begin() + end,
+            [&](const bvh_build_prim& p) {
+                int b = std::min(bin_count - 1, static_cast<int>((p.centroid[best_axis] - cmin) * scale));
+                return b <= best_split;
+            });
+        mid = static_cast<int>(it - prims.begin());
+        node->axis = best_axis;
+    }
+
+    // Subárvores grandes são construídas em paralelo; as faixas [begin,mid) e [mid,end)
+    // são disjuntas, então as duas tarefas não compartilham dados. A profundidade é testada
+    // antes do deslocamento, que seria indefinido a partir de 32 níveis.
+    if (count > parallel_threshold && depth < 16 && (1u << depth) < std::thread::hardware_concurrency()) {
+        int left_nodes = 0;
+        auto left = std::async(std::launch::async, [&]() {
+            return build(prims, begin, mid, depth + 1, left_nodes);
+        });
+        node->child[1] = build(prims, mid, end, depth + 1, total_nodes);
+        node->child[0] = left.get();
+        total_nodes += left_nodes;
+    } else {
+        node->child[0] = build(prims, begin, mid, depth + 1, total_nodes);
+        node->child[1] = build(prims, mid, end, depth + 1, total_nodes);
+    }
+
+    return node;
+}
+
+inline int bvh_builder::flatten(const build_node* node, std::vector<bvh_node>& nodes) {
+    const int index = static_cast<int>(nodes.size());
+    nodes.push_back(bvh_node{node->box, node->first, node->count, node->axis});
+
+    if (node->count == 0) {
+        flatten(node->child[0].get(), nodes);
+        nodes[index].offset = flatten(node->child[1].get(), nodes);
+    }
+    return index;
+}
+
+// Hierarquia de volumes envolventes construída por bvh_builder. Pode substituir uma hittable_list em qualquer lugar.
+class bvh : public hittable {
+public:
+    bvh() {}
+
+    // Constrói a hierarquia a partir dos objetos da lista. Objetos sem caixa finita
+    // ficam de fora da árvore e são testados linearmente. 'dispatch' escolhe como as
+    // folhas chamam os primitivos (ver primitive.h).
+    bvh(const hittable_list& list, double time0 = 0, double time1 = 0,
+        dispatch_mode dispatch = dispatch_mode::static_variant);
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override;
+
+    int node_count() const { return static_cast<int>(nodes.size()); }
+
+    // Atualiza as caixas depois que os objetos se moveram, sem mudar a topologia: as
+    // folhas são recalculadas para o intervalo [time0, time1] e as caixas sobem até a
+    // raiz. Bem mais barato que reconstruir, mas a árvore piora se os objetos se
+    // afastam muito das posições da construção (ver sah_cost).
+    void refit(double time0, double time1);
+
+    // Custo SAH da árvore relativo à área da raiz, para comparar a qualidade de uma
+    // árvore reajustada com a de uma reconstruída.
+    double sah_cost() const;
+
+private:
+    std::vector<bvh_node> nodes;                         // Árvore achatada em pré-ordem
+    std::vector<shared_ptr<hittable>> primitives;        // Primitivos na ordem das folhas
+    std::vector<primitive> leaf_objects;                 // Primitivos usados na travessia
+    std::vector<shared_ptr<hittable>> unbounded;         // Objetos sem caixa finita
+    dispatch_mode dispatch = dispatch_mode::static_variant;
+};
+
+
+inline bvh::bvh(const hittable_list& list, double time0, double time1, dispatch_mode dispatch)
+    : dispatch(dispatch)
+{
+    std::vector<bvh_build_prim> prims;
+    prims.reserve(list.objects.size());
+
+    for (const auto& object : list.objects) {
+        aabb box;
+        if (!object->bounding_box(time0, time1, box)) {
+            unbounded.push_back(object);
+            continue;
+        }
+        prims.push_back({box, box.centroid(), static_cast<int>(prims.size())});
+        primitives.push_back(object);
+    }
+
+    if (prims.empty()) return;
+
+    bvh_builder().build(prims, nodes);
+
+    // Reordena os primitivos na ordem das folhas para que cada folha seja contígua
+    std::vector<shared_ptr<hittable>> ordered;
+    ordered.reserve(prims.size());
+    for (const auto& p : prims)
+        ordered.push_back(primitives[p.index]);
+    primitives.swap(ordered);
+
+    leaf_objects.reserve(primitives.size());
+    for (const auto& p : primitives)
+        leaf_objects.push_back(make_primitive(p.get(), dispatch));
+}
+
+inline void bvh::refit(double time0, double time1) {
+    // As cópias das folhas são refeitas, pois guardam o estado antigo dos objetos
+    for (size_t i = 0; i < primitives.size(); ++i)
+        leaf_objects[i] = make_primitive(primitives[i].get(), dispatch);
+
+    // Em pré-ordem os filhos vêm sempre depois do pai; percorrendo o vetor de trás para
+    // frente, as caixas dos filhos já estão prontas quando o pai é visitado.
+    for (int n = node_count() - 1; n >= 0; --n) {
+        bvh_node& node = nodes[n];
+        if (node.count > 0) {
+            aabb box;
+            for (int i = node.offset; i < node.offset + node.count; ++i) {
+                aabb object_box;
+                if (primitives[i]->bounding_box(time0, time1, object_box))
+                    box = surrounding_box(box, object_box);
+            }
+            node.box = box;
+        } else {
+            node.box = surrounding_box(nodes[n + 1].box, nodes[node.offset].box);
+        }
+    }
+}
+
+inline double bvh::sah_cost() const {
+    if (nodes.empty()) return 0;
+    double cost = 0;
+    for (const auto& node : nodes)
+        cost += node.box.surface_area() * (node.count > 0 ? bvh_builder::intersection_cost * node.count
+                                                          : bvh_builder::traversal_cost);
+    return cost / nodes[0].box.surface_area();
+}
+
+inline bool bvh::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    hit_record temp_rec;
+    auto hit_anything = false;
+    auto closest_so_far = t_max;
+
+    for (const auto& object : unbounded) {
+        if (object->hit(r, t_min, closest_so_far, temp_rec)) {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
+    }
+
+    if (nodes.empty()) return hit_anything;
+
+    const point3 origin = r.origin();
+    const vec3 dir = r.direction();
+    const vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+    const bool dir_is_neg[3] = { inv_dir.x() < 0, inv_dir.y() < 0, inv_dir.z() < 0 };
+
+    int stack[64];
+    int stack_size = 0;
+    int current = 0;
+
+    for (;;) {
+        const bvh_node& node = nodes[current];
+        real t_entry;
+        RT_STAT(box_tests++);
+
+        if (node.box.hit(origin, inv_dir, t_min, closest_so_far, t_entry)) {
+            if (node.count > 0) {
+                for (int i = node.offset; i < node.offset + node.count; ++i) {
+                    if (hit_primitive(leaf_objects[i], r, t_min, closest_so_far, temp_rec)) {
+                        hit_anything = true;
+                        closest_so_far = temp_rec.t;
+                        rec = temp_rec;
+                    }
+                }
+            } else {
+                // Visita primeiro o filho do lado de onde o raio vem
+                if (dir_is_neg[node.axis]) {
+                    stack[stack_size++] = current + 1;
+                    current = node.offset;
+                } else {
+                    stack[stack_size++] = node.offset;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stack_size == 0) break;
+        current = stack[--stack_size];
+    }
+
+    return hit_anything;
+}
+
+// Mesma travessia de hit, mas o intervalo não encolhe e a primeira interseção
+// encontrada encerra a busca.
+inline bool bvh::occluded(const ray& r, real t_min, real t_max) const {
+    for (const auto& object : unbounded)
+        if (object->occluded(r, t_min, t_max)) return true;
+
+    if (nodes.empty()) return false;
+
+    const point3 origin = r.origin();
+    const vec3 dir = r.direction();
+    const vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+    const bool dir_is_neg[3] = { inv_dir.x() < 0, inv_dir.y() < 0, inv_dir.z() < 0 };
+
+    int stack[64];
+    int stack_size = 0;
+    int current = 0;
+
+    for (;;) {
+        const bvh_node& node = nodes[current];
+        real t_entry;
+        RT_STAT(box_tests++);
+
+        if (node.box.hit(origin, inv_dir, t_min, t_max, t_entry)) {
+            if (node.count > 0) {
+                for (int i = node.offset; i < node.offset + node.count; ++i)
+                    if (occluded_primitive(leaf_objects[i], r, t_min, t_max)) return true;
+            } else {
+                if (dir_is_neg[node.axis]) {
+                    stack[stack_size++] = current + 1;
+                    current = node.offset;
+                } else {
+                    stack[stack_size++] = node.offset;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stack_size == 0) break;
+        current = stack[--stack_size];
+    }
+
+    return false;
+}
+
+inline bool bvh::bounding_box(double time0, double time1, aabb& output_box) const {
+    if (nodes.empty() || !unbounded.empty()) return false;
+    output_box = nodes[0].box;
+    return true;
+}
+
+#endif
@@ -2,17 +2,23 @@
 #define CAMERA_H
 
 #include "rtweekend.h"  // Inclui o cabeçalho "rtweekend.h" para outras definições utilizadas.
+#include "hash.h"       // Inclui o cabeçalho "hash.h" para identificar a câmera.
 
-class camera {
+// Câmera no tipo escalar T; 'camera' usa o tipo da geometria (ver 'real' em vec3.h).
+template <typename T>
+class camera_t {
 public:
+    using point_type = vec3_t<T>;
+    using vector_type = vec3_t<T>;
+
     // Construtor padrão da câmera
-    camera() : camera(point3(0,0,-1), point3(0,0,0), vec3(0,1,0), 40, 1, 0, 10) {}
+    camera_t() : camera_t(point_type(0,0,-1), point_type(0,0,0), vector_type(0,1,0), 40, 1, 0, 10) {}
 
     // Construtor da câmera com parâmetros personalizados
-    camera(
-        point3 lookfrom,
-        point3 lookat,
-        vec3   vup,
+    camera_t(
+        point_type  lookfrom,
+        point_type  lookat,
+        vector_type vup,
         double vfov,              // Campo de visão vertical em graus
         double aspect_ratio,
         double aperture,
@@ -40,26 +46,39 @@ public:
     }
 
     // Método para obter um raio primário da câmera
-    ray get_ray(double s, double t) const {
-        vec3 rd = lens_radius * random_in_unit_disk();                 // Desvio aleatório na lente
-        vec3 offset = u * rd.x() + v * rd.y();                         // Vetor de deslocamento para desfocar a imagem
-        return ray(
+    ray_t<T> get_ray(T s, T t) const {
+        vector_type rd = lens_radius * vector_type(sample_in_unit_disk());  // Desvio aleatório na lente
+        vector_type offset = u * rd.x() + v * rd.y();                  // Vetor de deslocamento para desfocar a imagem
+        return ray_t<T>(
             origin + offset,                                           // Origem do raio é deslocada pela posição da lente
             lower_left_corner + s*horizontal + t*vertical - origin - offset,  // Direção do raio é calculada com base no viewport e deslocada pela posição da lente
-            random_double(time0, time1)                                // Tempo aleatório do raio para simulação de motion blur
+            sample_1d(time0, time1)                                    // Tempo aleatório do raio para simulação de motion blur
         );
     }
 
+    // Hash de todos os parâmetros da câmera; duas câmeras com o mesmo hash geram os mesmos raios
+    std::uint64_t fingerprint() const {
+        hasher h;
+        for (const vector_type* p : {&origin, &lower_left_corner, &horizontal, &vertical, &u, &v, &w})
+            for (int k = 0; k < 3; ++k) h.add((*p)[k]);
+        h.add(lens_radius);
+        h.add(time0);
+        h.add(time1);
+        return h.value();
+    }
+
 private:
-    point3 origin;                 // Posição da câmera
-    point3 lower_left_corner;       // Canto inferior esquerdo do viewport
-    vec3 horizontal;                // Vetor horizontal do viewport
-    vec3 vertical;                  // Vetor vertical do viewport
-    vec3 u, v, w;                   // Vetores de base da câmera
-    double lens_radius;             // Raio da lente
+    point_type origin;              // Posição da câmera
+    point_type lower_left_corner;   // Canto inferior esquerdo do viewport
+    vector_type horizontal;         // Vetor horizontal do viewport
+    vector_type vertical;           // Vetor vertical do viewport
+    vector_type u, v, w;            // Vetores de base da câmera
+    T lens_radius;                  // Raio da lente
     double time0, time1;            // Tempos de abertura/fechamento do obturador
 };
 
+using camera = camera_t<real>;
+
 #endif
 
 
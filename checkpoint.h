@@ -0,0 +1,178 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "rtweekend.h"
+
+#include "accumulation.h"
+#include "camera.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "renderer.h"
+#include "scene.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// Formato binário do checkpoint (little-endian). Um cabeçalho fixo seguido pelos arrays
+// do accumulation_buffer, cada um começando em um deslocamento múltiplo de 64 bytes,
+// para que o arquivo possa ser mapeado em memória e copiado seção por seção.
+//
+// O fluxo aleatório de cada amostra depende só de (pixel, índice da amostra), então a
+// posição do gerador de cada pixel é o próprio número de amostras já somadas: ao
+// retomar, o pixel continua da amostra count[pixel].
+struct checkpoint_header {
+    char magic[8];              // "RTCKPT01"
+    std::uint32_t version;      // Versão do formato
+    std::uint32_t width;        // Largura da imagem
+    std::uint32_t height;       // Altura da imagem
+    std::uint32_t passes;       // Passadas concluídas
+    std::uint64_t scene_hash;   // Hash da cena
+    std::uint64_t render_hash;  // Hash da câmera e dos parâmetros que afetam as amostras
+    std::uint64_t sum_offset;   // double[3*pixels]: soma R, G, B
+    std::uint64_t count_offset; // uint32[pixels]: amostras por pixel
+    std::uint64_t mean_offset;  // double[pixels]: média da luminância (Welford)
+    std::uint64_t m2_offset;    // double[pixels]: M2 da luminância (Welford)
+    std::uint64_t file_size;    // Tamanho total, para detectar arquivos truncados
+};
+
+// A versão 2 passou a incluir as malhas, as texturas e o modo de amostragem nos hashes
+constexpr std::uint32_t checkpoint_version = 2;
+
+// Hash da cena: os arrays de materiais e esferas da descrição, byte a byte, o número de
+// malhas e, de cada uma, o caminho, o material e os tamanhos (a geometria não é
+// percorrida), e o número de texturas e o caminho de cada uma.
+inline std::uint64_t scene_fingerprint(const scene_data& scene) {
+    hasher h;
+    h.add_bytes(scene.materials(), scene.material_count() * sizeof(scene_material));
+    h.add_bytes(scene.spheres(), scene.sphere_count() * sizeof(scene_sphere));
+    h.add(static_cast<std::int64_t>(scene.mesh_count()));
+    for (size_t k = 0; k < scene.mesh_count(); ++k) {
+        const scene_mesh& m = scene.meshes()[k];
+        h.add(m.path);
+        h.add(static_cast<std::int64_t>(m.material));
+        h.add(static_cast<std::int64_t>(m.geometry ? m.geometry->vertex_count() : 0));
+        h.add(static_cast<std::int64_t>(m.geometry ? m.geometry->triangle_count() : 0));
+    }
+    h.add(static_cast<std::int64_t>(scene.texture_count()));
+    for (size_t k = 0; k < scene.texture_count(); ++k)
+        h.add(scene.textures()[k].path);
+    return h.value();
+}
+
+// Hash dos parâmetros de renderização que mudam o valor das amostras.
+inline std::uint64_t render_fingerprint(const camera& cam, const render_settings& settings) {
+    hasher h;
+    h.add(static_cast<std::int64_t>(cam.fingerprint()));
+    h.add(settings.image_width);
+    h.add(settings.image_height);
+    h.add(settings.max_depth);
+    h.add(settings.rr.enabled ? 1 : 0);
+    h.add(settings.rr.start_depth);
+    h.add(settings.rr.min_probability);
+    h.add(static_cast<int>(settings.sampler));
+    if (settings.lights)  // A amostragem das luzes muda o ruído, então muda as amostras
+        h.add(static_cast<int>(settings.lights->size()));
+    return h.value();
+}
+
+inline std::uint64_t align64(std::uint64_t x) { return (x + 63) & ~std::uint64_t(63); }
+
+// Troca 'path' por 'tmp' (já gravado e fechado) com um rename, depois de garantir que os
+// dados de 'tmp' chegaram ao disco. Quem lê 'path' vê sempre o arquivo antigo inteiro
+// ou o novo inteiro.
+inline bool replace_file(const std::string& tmp, const std::string& path) {
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(tmp.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#else
+    std::remove(path.c_str());  // Fora do POSIX, rename não substitui um arquivo existente
+#endif
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// Preenche os deslocamentos das seções e o tamanho do arquivo a partir das dimensões.
+inline void checkpoint_layout(checkpoint_header& header) {
+    const std::uint64_t pixels = static_cast<std::uint64_t>(header.width) * header.height;
+    header.sum_offset = align64(sizeof(checkpoint_header));
+    header.count_offset = align64(header.sum_offset + pixels * 3 * sizeof(double));
+    header.mean_offset = align64(header.count_offset + pixels * sizeof(std::uint32_t));
+    header.m2_offset = align64(header.mean_offset + pixels * sizeof(double));
+    header.file_size = header.m2_offset + pixels * sizeof(double);
+}
+
+// Grava o checkpoint de forma atômica: escreve em 'path.tmp' e renomeia por cima do
+// arquivo anterior, de modo que uma interrupção no meio da escrita nunca deixa um
+// checkpoint corrompido no lugar do último válido.
+inline bool save_checkpoint(const std::string& path, const accumulation_buffer& acc,
+                            std::uint32_t passes, std::uint64_t scene_hash,
+                            std::uint64_t render_hash) {
+    const std::uint64_t pixels = acc.pixel_count();
+
+    checkpoint_header header{};
+    std::memcpy(header.magic, "RTCKPT01", 8);
+    header.version = checkpoint_version;
+    header.width = static_cast<std::uint32_t>(acc.width);
+    header.height = static_cast<std::uint32_t>(acc.height);
+    header.passes = passes;
+    header.scene_hash = scene_hash;
+    header.render_hash = render_hash;
+    checkpoint_layout(header);
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        auto write_at = [&](std::uint64_t offset, const void* data, std::uint64_t n) {
+            static const char zeros[64] = {};
+            const auto pos = static_cast<std::uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(offset - pos));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_at(header.sum_offset, acc.sum.data(), pixels * 3 * sizeof(double));
+        write_at(header.count_offset, acc.count.data(), pixels * sizeof(std::uint32_t));
+        write_at(header.mean_offset, acc.lum_mean.data(), pixels * sizeof(double));
+        write_at(header.m2_offset, acc.lum_m2.data(), pixels * sizeof(double));
+        out.flush();
+        if (!out) return false;
+    }
+    return replace_file(tmp, path);
+}
+
+// Lê um checkpoint para o buffer de acumulação. Retorna false se o arquivo não existir,
+// estiver truncado ou tiver outro formato; os hashes ficam em 'header' para o chamador
+// conferir se o checkpoint pertence à renderização atual.
+inline bool load_checkpoint(const std::string& path, accumulation_buffer& acc,
+                            checkpoint_header& header) {
+    mapped_file file;
+    if (!file.open(path) || file.size() < sizeof(checkpoint_header)) return false;
+    const char* data = file.data();
+
+    std::memcpy(&header, data, sizeof(header));
+    checkpoint_header expected = header;
+    checkpoint_layout(expected);
+    bool ok = std::memcmp(header.magic, "RTCKPT01", 8) == 0
+           && header.version == checkpoint_version
+           && header.file_size == file.size()
+           && std::memcmp(&header, &expected, sizeof(header)) == 0;
+
+    if (ok) {
+        acc.resize(static_cast<int>(header.width), static_cast<int>(header.height));
+        const std::uint64_t pixels = acc.pixel_count();
+        std::memcpy(acc.sum.data(), data + header.sum_offset, pixels * 3 * sizeof(double));
+        std::memcpy(acc.count.data(), data + header.count_offset, pixels * sizeof(std::uint32_t));
+        std::memcpy(acc.lum_mean.data(), data + header.mean_offset, pixels * sizeof(double));
+        std::memcpy(acc.lum_m2.data(), data + header.m2_offset, pixels * sizeof(double));
+    }
+    return ok;
+}
+
+#endif
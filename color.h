@@ -6,7 +6,7 @@
 #include <iostream>
 
 
-void write_color(std::ostream &out, color pixel_color, int samples_per_pixel) {
+inline void write_color(std::ostream &out, color pixel_color, int samples_per_pixel) {
     auto r = pixel_color.x();  // Componente vermelha do pixel
     auto g = pixel_color.y();  // Componente verde do pixel
     auto b = pixel_color.z();  // Componente azul do pixel
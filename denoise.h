@@ -0,0 +1,318 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "rtweekend.h"
+
+#include "feature_buffer.h"
+#include "framebuffer.h"
+#include "scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Denoiser à-trous guiado por atributos e pela variância (edge-avoiding à-trous wavelet,
+// Dammertz et al. 2010, com os pesos de cor do SVGF, Schied et al. 2017). Cada passada
+// aplica o núcleo B3-spline 5x5 com as amostras espaçadas de 2^i pixels, então cinco
+// passadas cobrem uma janela de 125 pixels com só 25 leituras por pixel em cada uma.
+// O peso de um vizinho cai com a diferença de normal, albedo e profundidade em relação
+// ao pixel do centro, o que preserva as bordas da geometria, e com a diferença de
+// luminância medida em desvios padrão do ruído estimado do centro: com poucas amostras
+// o filtro alisa muito, com muitas quase não mexe na imagem. A cor é dividida pelo
+// albedo antes do filtro e multiplicada de volta no fim, para que as bordas entre
+// materiais não borrem.
+
+struct denoise_settings {
+    int iterations = 5;          // Passadas; o espaçamento dobra a cada uma
+    double sigma_color = 4;      // Diferença de luminância tolerada, em desvios padrão do ruído
+    double sigma_normal = 0.3;
+    double sigma_albedo = 0.1;
+    double sigma_depth = 0.1;    // Relativa à profundidade do pixel do centro
+};
+
+// Aproximação de exp(x) para x <= 0, com as mesmas operações na versão escalar e na
+// SSE2: 2^(x·log2 e) é separado em parte inteira, montada direto no expoente do float,
+// e parte fracionária, por um polinômio (erro relativo abaixo de 2e-4, o bastante
+// para pesos). Abaixo de 2^-40 o resultado fica preso em 2^-40, o que mantém
+// os pesos (e os seus quadrados) longe dos números subnormais, muito lentos.
+inline float exp_neg_approx(float x) {
+    const float t = std::max(x * 1.44269504f, -40.0f);
+    const float n = std::floor(t);
+    const float f = t - n;
+    const float p = 1.0f + f * (0.69314718f + f * (0.24022650f + f * (0.05550411f
+                  + f * (0.00961813f + f * 0.00133336f))));
+    const std::int32_t bits = (static_cast<std::int32_t>(n) + 127) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+#if defined(__SSE2__)
+inline __m128 exp_neg_approx(__m128 x) {
+    const __m128 t = _mm_max_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504f)), _mm_set1_ps(-40.0f));
+    // floor(t): o truncamento arredonda números negativos para cima
+    __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+    n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, t), _mm_set1_ps(1.0f)));
+    const __m128 f = _mm_sub_ps(t, n);
+    __m128 p = _mm_set1_ps(0.00133336f);
+    p = _mm_add_ps(_mm_set1_ps(0.00961813f), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(0.05550411f), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(0.24022650f), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(0.69314718f), _mm_mul_ps(f, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(f, p));
+    const __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+    return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+}
+#endif
+
+// Uma passada do filtro sobre imagens guardadas como planos separados (um vetor por
+// canal), para que quatro pixels vizinhos caibam em um registrador SSE2. Cada linha
+// tem 'pad' pixels de margem de cada lado, cópias do pixel da borda, e a largura útil
+// arredondada para múltiplo de 4; assim nenhum vizinho cai fora do plano e a linha
+// inteira passa pelo laço vetorial. Os ponteiros apontam para o pixel (0, 0) e o pixel
+// (x, y) fica em y·stride + x.
+class atrous_pass {
+public:
+    static constexpr float kernel[5] = {1.0f / 16, 1.0f / 4, 3.0f / 8, 1.0f / 4, 1.0f / 16};
+    static constexpr float variance_floor = 1e-6f;  // Mantém um mínimo de filtragem sem ruído
+
+    const float* in[3];        // Cor (já dividida pelo albedo)
+    float* out[3];
+    const float* variance_in;  // Variância da luminância de cada pixel de 'in'
+    float* variance_out;
+    const float* normal[3];
+    const float* albedo[3];
+    const float* depth;
+    const float* inv_depth;    // 1/(sigma_depth²·(profundidade² + eps)) de cada pixel
+    int width, height, stride, pad, step;
+    float sigma_color2, inv_normal, inv_albedo;
+
+    // Filtra a linha y e preenche as margens dela na saída
+    void filter_row(int y) const;
+
+    // Copia os pixels das bordas da linha y de 'plane' para as margens
+    void pad_row(float* plane, int y) const {
+        float* row = plane + static_cast<size_t>(y) * stride;
+        std::fill(row - pad, row, row[0]);
+        std::fill(row + width, row + stride - pad, row[width - 1]);
+    }
+
+private:
+    void filter_pixel(int x, int y) const;
+#if defined(__SSE2__)
+    void filter_4(int x, int y) const;
+#endif
+};
+
+inline void atrous_pass::filter_row(int y) const {
+#if defined(__SSE2__)
+    for (int x = 0; x < width; x += 4) filter_4(x, y);
+#else
+    for (int x = 0; x < width; ++x) filter_pixel(x, y);
+#endif
+    for (int k = 0; k < 3; ++k) pad_row(out[k], y);
+    pad_row(variance_out, y);
+}
+
+// A nova variância é a soma das variâncias dos vizinhos ponderada pelo quadrado dos
+// pesos normalizados, como para uma média ponderada de amostras independentes.
+inline void atrous_pass::filter_pixel(int x, int y) const {
+    const size_t p = static_cast<size_t>(y) * stride + x;
+    const float lum_p = 0.2126f * in[0][p] + 0.7152f * in[1][p] + 0.0722f * in[2][p];
+    const float inv_color = 1.0f / (sigma_color2 * variance_in[p] + variance_floor);
+    float weight_sum = 0, variance_sum = 0, acc[3] = {0, 0, 0};
+
+    for (int dy = -2; dy <= 2; ++dy) {
+        const size_t row = static_cast<size_t>(std::clamp(y + dy * step, 0, height - 1)) * stride;
+        for (int dx = -2; dx <= 2; ++dx) {
+            const size_t q = row + x + dx * step;
+            const float dl = lum_p - (0.2126f * in[0][q] + 0.7152f * in[1][q] + 0.0722f * in[2][q]);
+            float dn = 0, da = 0;
+            for (int k = 0; k < 3; ++k) {
+                dn += (normal[k][p] - normal[k][q]) * (normal[k][p] - normal[k][q]);
+                da += (albedo[k][p] - albedo[k][q]) * (albedo[k][p] - albedo[k][q]);
+            }
+            const float dz = depth[p] - depth[q];
+            const float d = dl * dl * inv_color + dn * inv_normal + da * inv_albedo + dz * dz * inv_depth[p];
+            const float w = kernel[dy + 2] * kernel[dx + 2] * exp_neg_approx(-d);
+            weight_sum += w;
+            variance_sum += w * w * variance_in[q];
+            for (int k = 0; k < 3; ++k) acc[k] += w * in[k][q];
+        }
+    }
+    for (int k = 0; k < 3; ++k) out[k][p] = acc[k] / weight_sum;
+    variance_out[p] = variance_sum / (weight_sum * weight_sum);
+}
+
+#if defined(__SSE2__)
+inline void atrous_pass::filter_4(int x, int y) const {
+    const size_t p = static_cast<size_t>(y) * stride + x;
+    const __m128 lr = _mm_set1_ps(0.2126f), lg = _mm_set1_ps(0.7152f), lb = _mm_set1_ps(0.0722f);
+    auto lum = [&](__m128 r, __m128 g, __m128 b) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(lr, r), _mm_mul_ps(lg, g)), _mm_mul_ps(lb, b));
+    };
+    auto sq = [](__m128 a, __m128 b) { const __m128 d = _mm_sub_ps(a, b); return _mm_mul_ps(d, d); };
+
+    __m128 pn[3], pa[3];
+    for (int k = 0; k < 3; ++k) {
+        pn[k] = _mm_loadu_ps(normal[k] + p);
+        pa[k] = _mm_loadu_ps(albedo[k] + p);
+    }
+    const __m128 lum_p = lum(_mm_loadu_ps(in[0] + p), _mm_loadu_ps(in[1] + p), _mm_loadu_ps(in[2] + p));
+    const __m128 pz = _mm_loadu_ps(depth + p);
+    const __m128 piz = _mm_loadu_ps(inv_depth + p);
+    const __m128 vic = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sigma_color2),
+                                  _mm_loadu_ps(variance_in + p)), _mm_set1_ps(variance_floor)));
+    const __m128 vin = _mm_set1_ps(inv_normal), via = _mm_set1_ps(inv_albedo);
+
+    __m128 weight_sum = _mm_setzero_ps(), variance_sum = _mm_setzero_ps();
+    __m128 acc[3] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+
+    for (int dy = -2; dy <= 2; ++dy) {
+        const size_t row = static_cast<size_t>(std::clamp(y + dy * step, 0, height - 1)) * stride;
+        for (int dx = -2; dx <= 2; ++dx) {
+            const size_t q = row + x + dx * step;
+            const __m128 qc[3] = {_mm_loadu_ps(in[0] + q), _mm_loadu_ps(in[1] + q), _mm_loadu_ps(in[2] + q)};
+            __m128 dn = _mm_setzero_ps(), da = _mm_setzero_ps();
+            for (int k = 0; k < 3; ++k) {
+                dn = _mm_add_ps(dn, sq(pn[k], _mm_loadu_ps(normal[k] + q)));
+                da = _mm_add_ps(da, sq(pa[k], _mm_loadu_ps(albedo[k] + q)));
+            }
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sq(lum_p, lum(qc[0], qc[1], qc[2])), vic),
+                                             _mm_mul_ps(dn, vin)), _mm_mul_ps(da, via));
+            d = _mm_add_ps(d, _mm_mul_ps(sq(pz, _mm_loadu_ps(depth + q)), piz));
+            const __m128 w = _mm_mul_ps(_mm_set1_ps(kernel[dy + 2] * kernel[dx + 2]),
+                                        exp_neg_approx(_mm_sub_ps(_mm_setzero_ps(), d)));
+            weight_sum = _mm_add_ps(weight_sum, w);
+            variance_sum = _mm_add_ps(variance_sum, _mm_mul_ps(_mm_mul_ps(w, w), _mm_loadu_ps(variance_in + q)));
+            for (int k = 0; k < 3; ++k) acc[k] = _mm_add_ps(acc[k], _mm_mul_ps(w, qc[k]));
+        }
+    }
+    for (int k = 0; k < 3; ++k) _mm_storeu_ps(out[k] + p, _mm_div_ps(acc[k], weight_sum));
+    _mm_storeu_ps(variance_out + p, _mm_div_ps(variance_sum, _mm_mul_ps(weight_sum, weight_sum)));
+}
+#endif
+
+// Filtra 'noisy' (soma das amostras; 'scale' normaliza, normalmente 1/amostras por
+// pixel) guiado pelos atributos já normalizados e grava em 'out' a imagem filtrada,
+// normalizada. As linhas de cada passada são divididas entre as threads, ou entre os
+// workers de 'pool' com a prioridade 'priority', se houver.
+inline void denoise(const framebuffer& noisy, double scale, const feature_buffer& features,
+                    const denoise_settings& settings, int threads, framebuffer& out,
+                    worker_pool* pool = nullptr, int priority = 0) {
+    const int width = noisy.width, height = noisy.height;
+    constexpr float albedo_floor = 1e-3f;  // Evita dividir por albedo zero
+    constexpr float depth_eps = 1e-4f;
+
+    atrous_pass pass;
+    pass.width = width;
+    pass.height = height;
+    pass.pad = settings.iterations > 0 ? 2 << (settings.iterations - 1) : 0;  // Maior deslocamento
+    pass.stride = (width + 3) / 4 * 4 + 2 * pass.pad;
+    const size_t plane_size = static_cast<size_t>(pass.stride) * height + 4;
+
+    // Planos: cor dividida pelo albedo e a sua variância (duas cópias, que se alternam
+    // entre entrada e saída), normal, albedo, profundidade e momentos da luminância
+    std::vector<float> planes[15];
+    float* plane[15];
+    for (int k = 0; k < 15; ++k) {
+        planes[k].resize(plane_size);
+        plane[k] = planes[k].data() + pass.pad;
+    }
+    float* color_a[3] = {plane[0], plane[1], plane[2]};
+    float* color_b[3] = {plane[3], plane[4], plane[5]};
+    float* variance_a = plane[6];
+    float* variance_b = plane[7];
+    float* normal[3] = {plane[8], plane[9], plane[10]};
+    float* albedo[3] = {plane[11], plane[12], plane[13]};
+    float* depth = plane[14];
+    std::vector<float> inv_depth_plane(plane_size), moment1(plane_size), moment2(plane_size);
+    float* inv_depth = inv_depth_plane.data() + pass.pad;
+
+    // Momentos da luminância sem o albedo; o ruído é estimado depois juntando os
+    // momentos dos vizinhos 3x3, o que funciona até com uma amostra por pixel
+    const float s = static_cast<float>(scale);
+    const float inv_sigma_depth2 = static_cast<float>(1 / (settings.sigma_depth * settings.sigma_depth));
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t src = static_cast<size_t>(y) * width + x;
+            const size_t p = static_cast<size_t>(y) * pass.stride + x;
+            for (int k = 0; k < 3; ++k) {
+                float c = noisy.rgb[src * 3 + k] * s;
+                if (!(c == c)) c = 0;  // NaN -> 0, como em write_color
+                albedo[k][p] = features.albedo.rgb[src * 3 + k];
+                normal[k][p] = features.normal.rgb[src * 3 + k];
+                color_a[k][p] = c / std::max(albedo[k][p], albedo_floor);
+            }
+            const float z = features.depth[src];
+            depth[p] = z;
+            inv_depth[p] = inv_sigma_depth2 / (z * z + depth_eps);
+
+            const float a = std::max(0.2126f * albedo[0][p] + 0.7152f * albedo[1][p] + 0.0722f * albedo[2][p],
+                                     albedo_floor);
+            moment1[p] = features.luminance_sum[src] / a;
+            moment2[p] = features.luminance_sq_sum[src] / (a * a);
+        }
+    }
+
+    // Variância da média das amostras: variância das amostras dividida pelo número delas
+    parallel_for(pool, priority, height, threads, [&](int y, int) {
+        for (int x = 0; x < width; ++x) {
+            float m1 = 0, m2 = 0;
+            for (int dy = -1; dy <= 1; ++dy) {
+                const size_t row = static_cast<size_t>(std::clamp(y + dy, 0, height - 1)) * pass.stride;
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const size_t q = row + std::clamp(x + dx, 0, width - 1);
+                    m1 += moment1[q];
+                    m2 += moment2[q];
+                }
+            }
+            m1 /= 9;
+            m2 /= 9;
+            variance_a[static_cast<size_t>(y) * pass.stride + x] = std::max(m2 - m1 * m1, 0.0f) * s;
+        }
+    });
+
+    for (int y = 0; y < height; ++y)
+        for (int k = 0; k < 15; ++k) pass.pad_row(plane[k], y);
+    for (int y = 0; y < height; ++y) pass.pad_row(inv_depth, y);
+
+    for (int k = 0; k < 3; ++k) {
+        pass.normal[k] = normal[k];
+        pass.albedo[k] = albedo[k];
+    }
+    pass.depth = depth;
+    pass.inv_depth = inv_depth;
+    pass.sigma_color2 = static_cast<float>(settings.sigma_color * settings.sigma_color);
+    pass.inv_normal = static_cast<float>(1 / (settings.sigma_normal * settings.sigma_normal));
+    pass.inv_albedo = static_cast<float>(1 / (settings.sigma_albedo * settings.sigma_albedo));
+
+    for (int i = 0; i < settings.iterations; ++i) {
+        pass.step = 1 << i;
+        std::copy(color_a, color_a + 3, pass.in);
+        std::copy(color_b, color_b + 3, pass.out);
+        pass.variance_in = variance_a;
+        pass.variance_out = variance_b;
+        parallel_for(pool, priority, height, threads, [&](int y, int) { pass.filter_row(y); });
+        std::swap(color_a, color_b);
+        std::swap(variance_a, variance_b);
+    }
+
+    out.resize(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t p = static_cast<size_t>(y) * pass.stride + x;
+            const size_t dst = static_cast<size_t>(y) * width + x;
+            for (int k = 0; k < 3; ++k)
+                out.rgb[dst * 3 + k] = color_a[k][p] * std::max(albedo[k][p], albedo_floor);
+        }
+    }
+}
+
+#endif
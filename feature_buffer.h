@@ -0,0 +1,85 @@
+#ifndef FEATURE_BUFFER_H
+#define FEATURE_BUFFER_H
+
+#include "rtweekend.h"
+
+#include "accumulation.h"
+#include "framebuffer.h"
+#include "image_io.h"
+
+#include <string>
+#include <vector>
+
+// Atributos do primeiro ponto atingido por um caminho. Variam pouco de uma amostra para
+// outra e marcam as bordas da cena, então servem para guiar o denoiser (ver denoise.h).
+struct path_features {
+    color albedo;      // Atenuação do material no primeiro ponto; a cor do fundo se o raio escapar
+    vec3 normal;       // Normal do lado de onde o raio veio; zero se o raio escapar
+    double depth = 0;  // Distância da câmera ao primeiro ponto; zero se o raio escapar
+};
+
+// Buffers auxiliares da imagem, um plano por atributo, com a soma das amostras de cada
+// pixel (como o framebuffer) até normalize() dividir pelo número de amostras. Além dos
+// atributos guarda os dois primeiros momentos da luminância das amostras, de onde o
+// denoiser estima o ruído de cada pixel.
+class feature_buffer {
+public:
+    // Redimensiona e zera os buffers
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        const size_t n = static_cast<size_t>(w) * h;
+        albedo.resize(w, h);
+        normal.resize(w, h);
+        depth.assign(n, 0.0f);
+        luminance_sum.assign(n, 0.0f);
+        luminance_sq_sum.assign(n, 0.0f);
+    }
+
+    size_t pixel_count() const { return static_cast<size_t>(width) * height; }
+
+    // Soma os atributos de uma amostra ao pixel
+    void add(size_t pixel, const path_features& f) {
+        albedo.add(pixel, f.albedo);
+        normal.add(pixel, f.normal);
+        depth[pixel] += static_cast<float>(f.depth);
+    }
+
+    // Soma a radiância de uma amostra aos momentos do pixel; cada amostra deve entrar
+    // uma única vez, com a sua radiância total
+    void add_radiance(size_t pixel, const color& c) {
+        const float y = static_cast<float>(luminance(c));
+        luminance_sum[pixel] += y;
+        luminance_sq_sum[pixel] += y * y;
+    }
+
+    // Multiplica tudo por 'scale' (normalmente 1/amostras por pixel)
+    void normalize(double scale) {
+        const float s = static_cast<float>(scale);
+        for (auto* plane : {&albedo.rgb, &normal.rgb, &depth, &luminance_sum, &luminance_sq_sum})
+            for (auto& v : *plane) v *= s;
+    }
+
+public:
+    int width = 0;
+    int height = 0;
+    framebuffer albedo;
+    framebuffer normal;
+    std::vector<float> depth;
+    std::vector<float> luminance_sum;     // Depois de normalize(), a média da luminância
+    std::vector<float> luminance_sq_sum;  // Depois de normalize(), a média do quadrado
+};
+
+// Grava os atributos já normalizados em PFM (valores lineares, sem correção gama), no
+// formato que denoisers externos esperam: base_albedo.pfm, base_normal.pfm e
+// base_depth.pfm, com a profundidade repetida nos três canais.
+inline bool write_features(const std::string& base, const feature_buffer& f) {
+    framebuffer depth(f.width, f.height);
+    for (size_t k = 0; k < f.pixel_count(); ++k)
+        depth.set(k, color(f.depth[k], f.depth[k], f.depth[k]));
+    return write_pfm(base + "_albedo.pfm", f.albedo, 1.0)
+        && write_pfm(base + "_normal.pfm", f.normal, 1.0)
+        && write_pfm(base + "_depth.pfm", depth, 1.0);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "rtweekend.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Framebuffer HDR em float: acumula a radiância de cada pixel (três floats por pixel)
+// durante a renderização e só é convertido para 8 bits na hora de gravar a imagem.
+// Os pixels são indexados por j*largura + i, com j = 0 na linha de baixo.
+class framebuffer {
+public:
+    framebuffer() {}
+    framebuffer(int w, int h) { resize(w, h); }
+
+    // Redimensiona e zera o buffer
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        rgb.assign(static_cast<size_t>(w) * h * 3, 0.0f);
+    }
+
+    void clear() { std::fill(rgb.begin(), rgb.end(), 0.0f); }
+
+    size_t pixel_count() const { return static_cast<size_t>(width) * height; }
+
+    // Substitui o valor de um pixel
+    void set(size_t pixel, const color& c) {
+        float* p = &rgb[pixel * 3];
+        p[0] = static_cast<float>(c.x());
+        p[1] = static_cast<float>(c.y());
+        p[2] = static_cast<float>(c.z());
+    }
+
+    // Soma uma contribuição ao pixel
+    void add(size_t pixel, const color& c) {
+        float* p = &rgb[pixel * 3];
+        p[0] += static_cast<float>(c.x());
+        p[1] += static_cast<float>(c.y());
+        p[2] += static_cast<float>(c.z());
+    }
+
+    color get(size_t pixel) const {
+        const float* p = &rgb[pixel * 3];
+        return color(p[0], p[1], p[2]);
+    }
+
+    // Converte o buffer inteiro para RGB de 8 bits, linha de cima primeiro, aplicando o
+    // mesmo tratamento de write_color: NaN vira zero, multiplica por scale (1/amostras),
+    // correção gama 2 e corte em [0, 0.999].
+    std::vector<std::uint8_t> to_rgb8(double scale) const;
+
+public:
+    int width = 0;
+    int height = 0;
+    std::vector<float> rgb;  // R, G, B de cada pixel
+};
+
+
+// Converte n floats para 8 bits. O laço principal trabalha com 4 valores por instrução
+// (SSE2); os valores que sobram passam pela versão escalar.
+inline void tonemap_to_u8(const float* in, std::uint8_t* out, size_t n, float scale) {
+    size_t k = 0;
+
+#if defined(__SSE2__)
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 top = _mm_set1_ps(0.999f);
+    const __m128 v256 = _mm_set1_ps(256.0f);
+
+    for (; k + 4 <= n; k += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(in + k), vscale);
+        v = _mm_and_ps(v, _mm_cmpeq_ps(v, v));                // NaN -> 0
+        v = _mm_sqrt_ps(_mm_max_ps(v, zero));                 // Correção gama
+        v = _mm_min_ps(v, top);                               // Corte em 0.999
+        __m128i q = _mm_cvttps_epi32(_mm_mul_ps(v, v256));    // [0,255]
+        q = _mm_packs_epi32(q, q);
+        q = _mm_packus_epi16(q, q);
+        std::uint32_t packed = static_cast<std::uint32_t>(_mm_cvtsi128_si32(q));
+        out[k + 0] = static_cast<std::uint8_t>(packed);
+        out[k + 1] = static_cast<std::uint8_t>(packed >> 8);
+        out[k + 2] = static_cast<std::uint8_t>(packed >> 16);
+        out[k + 3] = static_cast<std::uint8_t>(packed >> 24);
+    }
+#endif
+
+    for (; k < n; ++k) {
+        float v = in[k] * scale;
+        if (v != v) v = 0.0f;
+        v = std::sqrt(v > 0.0f ? v : 0.0f);
+        if (v > 0.999f) v = 0.999f;
+        out[k] = static_cast<std::uint8_t>(256.0f * v);
+    }
+}
+
+inline std::vector<std::uint8_t> framebuffer::to_rgb8(double scale) const {
+    const size_t row = static_cast<size_t>(width) * 3;
+    std::vector<std::uint8_t> out(row * height);
+    for (int j = 0; j < height; ++j) {
+        const float* src = &rgb[static_cast<size_t>(j) * row];
+        std::uint8_t* dst = &out[static_cast<size_t>(height - 1 - j) * row];
+        tonemap_to_u8(src, dst, row, static_cast<float>(scale));
+    }
+    return out;
+}
+
+// Erro RMS entre duas imagens já normalizadas, medido depois da correção gama e do
+// corte em [0,1], ou seja, na escala em que a imagem é vista.
+inline double display_rmse(const framebuffer& a, const framebuffer& b) {
+    double err = 0;
+    for (size_t k = 0; k < a.rgb.size(); ++k) {
+        double x = sqrt(clamp(a.rgb[k], 0.0, 1.0));
+        double y = sqrt(clamp(b.rgb[k], 0.0, 1.0));
+        err += (x - y) * (x - y);
+    }
+    return sqrt(err / a.rgb.size());
+}
+
+#endif
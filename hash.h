@@ -0,0 +1,32 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Hash FNV-1a de 64 bits, usado para identificar cenas, câmeras e configurações
+// (por exemplo, para conferir se um checkpoint pertence à renderização atual).
+class hasher {
+public:
+    void add_bytes(const void* data, size_t n) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (size_t k = 0; k < n; ++k) {
+            h ^= p[k];
+            h *= 0x100000001b3ull;
+        }
+    }
+
+    void add(double x) { add_bytes(&x, sizeof(x)); }
+    void add(std::int64_t x) { add_bytes(&x, sizeof(x)); }
+    void add(int x) { add(static_cast<std::int64_t>(x)); }
+    void add(const std::string& s) { add_bytes(s.data(), s.size()); add(static_cast<std::int64_t>(s.size())); }
+
+    std::uint64_t value() const { return h; }
+
+private:
+    std::uint64_t h = 0xcbf29ce484222325ull;
+};
+
+#endif
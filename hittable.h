@@ -3,15 +3,28 @@
 
 #include "ray.h"        // Inclui o cabeçalho "ray.h" para a definição de 'ray' usada no arquivo.
 #include "rtweekend.h"  // Inclui o cabeçalho "rtweekend.h" para outras definições utilizadas.
+#include "aabb.h"       // Inclui o cabeçalho "aabb.h" para as caixas delimitadoras.
 
-class material; // Declaração antecipada (forward declaration) da classe "material" para evitar referências circulares.
+#include <cstdint>      // Para o índice do material
+#include <type_traits>  // Para conferir que hit_record é trivialmente copiável
+
+// Como o caminho quente chama objetos e materiais: pela interface virtual ou por
+// despacho estático sobre o conjunto fechado de tipos conhecidos (ver primitive.h e
+// material_arena). Os dois modos produzem exatamente a mesma imagem.
+enum class dispatch_mode { virtual_calls, static_variant };
 
 // Estrutura para armazenar informações sobre uma interseção com um objeto hittable.
+// Não guarda ponteiros com contagem de referência: o material é um índice na
+// material_arena da cena, e o registro inteiro é copiado como bytes.
 struct hit_record {
     point3 p;                    // Ponto de interseção 3D
     vec3 normal;                 // Vetor normal na interseção
-    shared_ptr<material> mat_ptr; // Ponteiro compartilhado para o material do objeto na interseção
-    double t;                    // Parâmetro 't' do raio onde ocorreu a interseção
+    real t;                      // Parâmetro 't' do raio onde ocorreu a interseção
+    // Parametrização da superfície, convertida em coordenadas de textura só quando um
+    // material com textura precisa delas (ver surface_uv em texture.h)
+    vec3 local_normal;           // Normal externa no espaço do objeto (esferas); zero se não há parametrização
+    real uv_length;              // Comprimento, na superfície, de uma unidade de v; zero se não há parametrização
+    std::uint32_t mat_id;        // Índice do material do objeto na material_arena
     bool front_face;             // Indica se o raio atingiu a frente (true) ou a parte de trás (false) do objeto
 
     // Função para definir a normal do objeto com base na direção do raio e na normal externa.
@@ -20,8 +33,25 @@ struct hit_record {
         front_face = dot(r.direction(), outward_normal) < 0;
         normal = front_face ? outward_normal : -outward_normal;
     }
+
+    // Origem de um raio que sai da superfície na direção 'dir'. Em double é o próprio
+    // ponto, e o t_min de 0.001 basta para o raio não encontrar de novo a superfície de
+    // onde saiu. Em float o erro do ponto cresce com as suas coordenadas, então ele é
+    // afastado ao longo da normal, para o lado de 'dir', por uma distância proporcional
+    // à maior delas.
+    point3 spawn_origin(const vec3& dir) const {
+        if constexpr (std::is_same<real, float>::value) {
+            const real scale = fmax(fabs(p.x()), fmax(fabs(p.y()), fabs(p.z())));
+            const real offset = real(1e-5) * (1 + scale);
+            return dot(dir, normal) > 0 ? p + offset * normal : p - offset * normal;
+        } else {
+            return p;
+        }
+    }
 };
 
+static_assert(std::is_trivially_copyable<hit_record>::value, "hit_record é copiado no caminho quente");
+
 // Classe abstrata base para objetos hittables.
 class hittable {
 public:
@@ -29,7 +59,21 @@ public:
     // Retorna true se o raio atingiu o objeto e preenche o registro de interseção 'rec',
     // com as informações relevantes sobre o ponto de interseção.
     // t_min e t_max especificam o intervalo válido de parâmetros 't' do raio.
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const = 0;
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const = 0;
+
+    // Consulta de oclusão ("any-hit"): só diz se o raio atinge algo em [t_min, t_max].
+    // Pode parar na primeira interseção encontrada, sem procurar a mais próxima nem
+    // preencher um registro, o que basta para os raios de sombra. A versão padrão usa hit().
+    virtual bool occluded(const ray& r, real t_min, real t_max) const {
+        hit_record rec;
+        return hit(r, t_min, t_max, rec);
+    }
+
+    // Método virtual puro para obter a caixa delimitadora do objeto no intervalo de tempo
+    // [time0, time1]. Retorna false se o objeto não tiver uma caixa finita.
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const = 0;
+
+    virtual ~hittable() = default;
 };
 
 #endif
@@ -18,14 +18,16 @@ class hittable_list : public hittable {
         void clear() { objects.clear(); }  // Limpa a lista de objetos
         void add(shared_ptr<hittable> object) { objects.push_back(object); }  // Adiciona um objeto à lista
 
-        virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override;
+        virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+        virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+        virtual bool bounding_box(double time0, double time1, aabb& output_box) const override;
 
     public:
         std::vector<shared_ptr<hittable>> objects;  // Vetor de objetos hittable
 };
 
 
-bool hittable_list::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
+inline bool hittable_list::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
     hit_record temp_rec;
     auto hit_anything = false;  // Variável para indicar se algum objeto foi atingido
     auto closest_so_far = t_max;  // Variável para armazenar a distância mais próxima encontrada até o momento
@@ -41,6 +43,27 @@ bool hittable_list::hit(const ray& r, double t_min, double t_max, hit_record& re
     return hit_anything;  // Retorna se algum objeto foi atingido
 }
 
+// Para no primeiro objeto que bloqueia o raio
+inline bool hittable_list::occluded(const ray& r, real t_min, real t_max) const {
+    for (const auto& object : objects)
+        if (object->occluded(r, t_min, t_max)) return true;
+    return false;
+}
+
+inline bool hittable_list::bounding_box(double time0, double time1, aabb& output_box) const {
+    if (objects.empty()) return false;
+
+    aabb temp_box;
+    output_box = aabb();
+
+    for (const auto& object : objects) {
+        if (!object->bounding_box(time0, time1, temp_box)) return false;  // Algum objeto é ilimitado
+        output_box = surrounding_box(output_box, temp_box);  // Expande a caixa para incluir o objeto
+    }
+
+    return true;
+}
+
 
 #endif
 
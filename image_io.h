@@ -0,0 +1,210 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include "framebuffer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef RT_USE_ZLIB
+#include <zlib.h>
+#endif
+
+// Gravação do framebuffer em arquivos binários. Cada função monta a imagem inteira em
+// memória e a grava com uma única escrita. 'scale' normaliza a soma das amostras
+// (normalmente 1/amostras por pixel). Todas retornam false se o arquivo não puder ser gravado.
+
+inline bool write_file(const std::string& path, const std::vector<std::uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(out);
+}
+
+inline void append(std::vector<std::uint8_t>& out, const std::string& text) {
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+// PPM binário (P6), 8 bits por canal, com correção gama.
+inline bool write_ppm(const std::string& path, const framebuffer& fb, double scale) {
+    std::vector<std::uint8_t> out;
+    append(out, "P6\n" + std::to_string(fb.width) + ' ' + std::to_string(fb.height) + "\n255\n");
+    auto pixels = fb.to_rgb8(scale);
+    out.insert(out.end(), pixels.begin(), pixels.end());
+    return write_file(path, out);
+}
+
+// PFM (Portable Float Map) colorido: radiância linear em float, sem correção gama.
+// A escala negativa no cabeçalho indica little-endian, e as linhas vão de baixo para
+// cima, que já é a ordem do framebuffer.
+inline bool write_pfm(const std::string& path, const framebuffer& fb, double scale) {
+    std::vector<std::uint8_t> out;
+    append(out, "PF\n" + std::to_string(fb.width) + ' ' + std::to_string(fb.height) + "\n-1.0\n");
+
+    const size_t header = out.size();
+    out.resize(header + fb.rgb.size() * sizeof(float));
+    float* dst = reinterpret_cast<float*>(out.data() + header);
+    const float s = static_cast<float>(scale);
+    for (size_t k = 0; k < fb.rgb.size(); ++k)
+        dst[k] = fb.rgb[k] * s;
+    return write_file(path, out);
+}
+
+// Maior largura ou altura aceita ao ler uma imagem
+constexpr int max_image_side = 1 << 16;
+
+// Lê um PFM colorido ("PF") para o framebuffer, já normalizado. Aceita as duas ordens
+// de bytes (escala negativa indica little-endian); as linhas ficam de baixo para cima,
+// como no framebuffer.
+inline bool read_pfm(const std::string& path, framebuffer& fb) {
+    std::ifstream in(path, std::ios::binary);
+    std::string magic;
+    int width = 0, height = 0;
+    double scale = 0;
+    if (!(in >> magic >> width >> height >> scale) || magic != "PF" || width <= 0 || height <= 0
+        || width > max_image_side || height > max_image_side)
+        return false;
+    in.get();  // Um único caractere de espaço separa o cabeçalho dos dados
+
+    // Um cabeçalho corrompido não pode pedir mais memória do que o arquivo tem de dados
+    const std::streamoff data_start = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::streamoff data_end = in.tellg();
+    in.seekg(data_start);
+    const std::uint64_t data_bytes = static_cast<std::uint64_t>(width) * height * 3 * sizeof(float);
+    if (!in || data_start < 0 || static_cast<std::uint64_t>(data_end - data_start) < data_bytes)
+        return false;
+
+    fb.resize(width, height);
+    in.read(reinterpret_cast<char*>(fb.rgb.data()),
+            static_cast<std::streamsize>(fb.rgb.size() * sizeof(float)));
+    if (!in) return false;
+
+    const std::uint16_t probe = 1;
+    const bool host_little = *reinterpret_cast<const std::uint8_t*>(&probe) == 1;
+    if ((scale < 0) != host_little) {
+        for (float& v : fb.rgb) {
+            std::uint8_t* b = reinterpret_cast<std::uint8_t*>(&v);
+            std::swap(b[0], b[3]);
+            std::swap(b[1], b[2]);
+        }
+    }
+    return true;
+}
+
+// CRC-32 usado pelos chunks do PNG
+inline std::uint32_t crc32_update(std::uint32_t crc, const std::uint8_t* data, size_t n) {
+    static const auto table = [] {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t k = 0; k < 256; ++k) {
+            std::uint32_t c = k;
+            for (int b = 0; b < 8; ++b)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[k] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t k = 0; k < n; ++k)
+        crc = table[(crc ^ data[k]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline void put_u32_be(std::vector<std::uint8_t>& out, std::uint32_t v) {
+    out.push_back(static_cast<std::uint8_t>(v >> 24));
+    out.push_back(static_cast<std::uint8_t>(v >> 16));
+    out.push_back(static_cast<std::uint8_t>(v >> 8));
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+inline void png_chunk(std::vector<std::uint8_t>& out, const char* type,
+                      const std::vector<std::uint8_t>& data) {
+    put_u32_be(out, static_cast<std::uint32_t>(data.size()));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32_be(out, crc32_update(0, &out[start], out.size() - start));
+}
+
+// Fluxo zlib com blocos deflate sem compressão ("stored"), usado quando a zlib não
+// está disponível.
+inline std::vector<std::uint8_t> zlib_store(const std::vector<std::uint8_t>& raw) {
+    std::vector<std::uint8_t> out = {0x78, 0x01};
+    size_t pos = 0;
+    do {
+        const size_t len = std::min<size_t>(65535, raw.size() - pos);
+        const bool last = pos + len == raw.size();
+        out.push_back(last ? 1 : 0);
+        out.push_back(static_cast<std::uint8_t>(len));
+        out.push_back(static_cast<std::uint8_t>(len >> 8));
+        out.push_back(static_cast<std::uint8_t>(~len));
+        out.push_back(static_cast<std::uint8_t>(~len >> 8));
+        out.insert(out.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while (pos < raw.size());
+
+    std::uint32_t a = 1, b = 0;  // Adler-32
+    for (auto byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_u32_be(out, (b << 16) | a);
+    return out;
+}
+
+// PNG RGB de 8 bits. Compilado com -DRT_USE_ZLIB (e -lz), comprime os dados com a zlib
+// no nível 'level' (1..9); caso contrário grava os dados sem compressão.
+inline bool write_png(const std::string& path, const framebuffer& fb, double scale, int level = 6) {
+    const auto pixels = fb.to_rgb8(scale);
+    const size_t row = static_cast<size_t>(fb.width) * 3;
+
+    // Cada linha começa com o tipo de filtro; 'Up' (2) guarda a diferença para a linha
+    // de cima, o que ajuda a compressão em gradientes como o céu.
+    std::vector<std::uint8_t> raw;
+    raw.reserve((row + 1) * fb.height);
+    for (int y = 0; y < fb.height; ++y) {
+        const std::uint8_t* cur = &pixels[y * row];
+        raw.push_back(2);
+        for (size_t x = 0; x < row; ++x)
+            raw.push_back(static_cast<std::uint8_t>(cur[x] - (y > 0 ? cur[x - row] : 0)));
+    }
+
+    std::vector<std::uint8_t> idat;
+#ifdef RT_USE_ZLIB
+    uLongf size = compressBound(static_cast<uLong>(raw.size()));
+    idat.resize(size);
+    if (compress2(idat.data(), &size, raw.data(), static_cast<uLong>(raw.size()), level) != Z_OK)
+        return false;
+    idat.resize(size);
+#else
+    (void)level;
+    idat = zlib_store(raw);
+#endif
+
+    std::vector<std::uint8_t> ihdr;
+    put_u32_be(ihdr, static_cast<std::uint32_t>(fb.width));
+    put_u32_be(ihdr, static_cast<std::uint32_t>(fb.height));
+    ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0});  // 8 bits, RGB, deflate, filtro adaptativo, sem entrelaçamento
+
+    std::vector<std::uint8_t> out = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    png_chunk(out, "IHDR", ihdr);
+    png_chunk(out, "IDAT", idat);
+    png_chunk(out, "IEND", {});
+    return write_file(path, out);
+}
+
+// Escolhe o formato pela extensão do arquivo: .pfm, .png ou (padrão) .ppm.
+inline bool write_image(const std::string& path, const framebuffer& fb, double scale) {
+    auto ends_with = [&](const char* ext) {
+        const size_t n = std::strlen(ext);
+        return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (ends_with(".pfm")) return write_pfm(path, fb, scale);
+    if (ends_with(".png")) return write_png(path, fb, scale);
+    return write_ppm(path, fb, scale);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "rtweekend.h"
+
+#include "hittable.h"
+#include "stats.h"
+#include "transform.h"
+
+#include <cmath>
+#include <memory>
+
+// Cópia de um objeto compartilhado (uma esfera, uma malha, uma BVH inteira) posicionada
+// por uma transformação afim. A geometria não é duplicada: mil instâncias de uma BVH de
+// mil esferas custam mil transformações, não um milhão de esferas. O objeto pode ser
+// ele mesmo uma BVH de instâncias, o que dá instâncias em vários níveis.
+//
+// O raio é levado para o espaço do objeto pela inversa, sem normalizar a direção, para
+// que o parâmetro t seja o mesmo nos dois espaços; o ponto atingido é recalculado no
+// raio original e a normal volta pela inversa transposta.
+class instance final : public hittable {
+public:
+    instance(shared_ptr<const hittable> object, const affine_transform& to_world)
+        : object(std::move(object)), to_world(to_world), to_object(to_world.inverse()),
+          length_scale(std::cbrt(std::fabs(to_world.determinant()))) {}
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override;
+
+    const hittable& inner() const { return *object; }
+    const affine_transform& transform() const { return to_world; }
+
+private:
+    ray object_ray(const ray& r) const {
+        RT_STAT(instance_transforms++);
+        return ray(to_object.apply_point(r.origin()), to_object.apply_vector(r.direction()), r.time());
+    }
+
+private:
+    shared_ptr<const hittable> object;
+    affine_transform to_world;
+    affine_transform to_object;
+    real length_scale;  // Escala média dos comprimentos, para rec.uv_length
+};
+
+
+inline bool instance::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    if (!object->hit(object_ray(r), t_min, t_max, rec)) return false;
+    // A direção da normal em relação ao raio não muda com a transformação, então
+    // front_face continua valendo
+    rec.p = r.at(rec.t);
+    rec.normal = unit_vector(to_object.apply_transposed(rec.normal));
+    // A normal no espaço do objeto continua valendo: a textura acompanha o objeto
+    rec.uv_length *= length_scale;
+    return true;
+}
+
+inline bool instance::occluded(const ray& r, real t_min, real t_max) const {
+    return object->occluded(object_ray(r), t_min, t_max);
+}
+
+inline bool instance::bounding_box(double time0, double time1, aabb& output_box) const {
+    aabb box;
+    if (!object->bounding_box(time0, time1, box)) return false;
+    output_box = to_world.apply_box(box);
+    return true;
+}
+
+#endif
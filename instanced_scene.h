@@ -0,0 +1,147 @@
+#ifndef INSTANCED_SCENE_H
+#define INSTANCED_SCENE_H
+
+#include "rtweekend.h"
+
+#include "bvh.h"
+#include "hittable_list.h"
+#include "instance.h"
+#include "material.h"
+#include "scene.h"
+#include "sphere.h"
+#include "transform.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// Campo de bolinhas no estilo da cena aleatória, repetido até o horizonte com
+// instâncias em três níveis:
+//  - ladrilho: 10 x 10 bolinhas de raio 0.2, uma por célula de lado 1, com materiais
+//    sorteados como na cena aleatória; há field_tile_variants ladrilhos diferentes;
+//  - bloco: 10 x 10 ladrilhos, cada um sorteado entre as variantes e girado por um
+//    múltiplo de 90 graus; há field_block_variants blocos diferentes;
+//  - campo: N x N blocos, também sorteados e girados, cada um inclinado para ficar
+//    tangente ao chão, uma esfera de raio field_ground_radius.
+// Cada bloco tem 10^4 bolinhas, então N = 100 dá 10^8 bolinhas efetivas com só
+// field_tile_variants * 100 esferas de verdade. Os sorteios usam thread_rng(), como
+// make_random_scene.
+
+constexpr int field_tile_variants = 8;
+constexpr int field_block_variants = 4;
+constexpr double field_ground_radius = 1e5;
+
+// O chão, a câmera e o material do chão; as bolinhas vêm de make_sphere_field
+inline scene_data make_field_scene() {
+    scene_data scene;
+    const auto ground = scene.add_lambertian(color(0.5, 0.5, 0.5));
+    scene.add_sphere(point3(0, -field_ground_radius, 0), field_ground_radius, ground);
+
+    scene.cam.lookfrom[0] = 0;  scene.cam.lookfrom[1] = 3;   scene.cam.lookfrom[2] = 0;
+    scene.cam.lookat[0] = 12;   scene.cam.lookat[1] = 0.5;   scene.cam.lookat[2] = -16;
+    scene.cam.vfov = 40;
+    scene.cam.aperture = 0;
+    scene.cam.focus_dist = 20;
+    return scene;
+}
+
+// Cria os materiais das bolinhas na arena e o campo de blocks_per_side x
+// blocks_per_side blocos. O campo é um único objeto (uma BVH de instâncias); com
+// 'flatten' as mesmas bolinhas são criadas uma a uma, nas posições que as instâncias
+// dariam, para comparação com a cena plana.
+inline hittable_list make_sphere_field(material_arena& materials, int blocks_per_side, bool flatten = false) {
+    constexpr int cells = 10;            // Bolinhas por lado de um ladrilho e ladrilhos por lado de um bloco
+    constexpr double tile_size = cells;
+    constexpr double block_size = cells * tile_size;
+    const vec3 up(0, 1, 0);
+
+    // Ladrilhos: os centros em volta da origem, no plano y = 0.2
+    std::vector<std::vector<sphere>> tiles(field_tile_variants);
+    for (auto& tile : tiles) {
+        for (int a = 0; a < cells; ++a) {
+            for (int b = 0; b < cells; ++b) {
+                const auto choose_mat = random_double();
+                const point3 center(a + 0.05 + 0.9 * random_double() - tile_size / 2, 0.2,
+                                    b + 0.05 + 0.9 * random_double() - tile_size / 2);
+                std::uint32_t mat;
+                if (choose_mat < 0.8) {
+                    mat = materials.make<lambertian>(color::random() * color::random());
+                } else if (choose_mat < 0.95) {
+                    const auto albedo = color::random(0.5, 1);
+                    mat = materials.make<metal>(albedo, random_double(0, 0.5));
+                } else {
+                    mat = materials.make<dielectric>(1.5);
+                }
+                tile.push_back(sphere(center, 0.2, mat));
+            }
+        }
+    }
+
+    // Blocos: a variante e a posição de cada ladrilho
+    auto quarter_turn = [&]() { return affine_transform::rotate(up, 90 * static_cast<int>(4 * random_double())); };
+    std::vector<std::vector<std::pair<int, affine_transform>>> blocks(field_block_variants);
+    for (auto& block : blocks) {
+        for (int i = 0; i < cells; ++i) {
+            for (int j = 0; j < cells; ++j) {
+                const int variant = static_cast<int>(field_tile_variants * random_double());
+                const vec3 offset((i + 0.5) * tile_size - block_size / 2, 0, (j + 0.5) * tile_size - block_size / 2);
+                block.emplace_back(variant, affine_transform::translate(offset) * quarter_turn());
+            }
+        }
+    }
+
+    // Campo: cada bloco gira em torno do centro do chão até ficar sobre o ponto do chão
+    // abaixo do seu centro
+    std::vector<std::pair<int, affine_transform>> field;
+    field.reserve(static_cast<size_t>(blocks_per_side) * blocks_per_side);
+    const point3 ground_center(0, -field_ground_radius, 0);
+    for (int i = 0; i < blocks_per_side; ++i) {
+        for (int j = 0; j < blocks_per_side; ++j) {
+            const int variant = static_cast<int>(field_block_variants * random_double());
+            const double x = (i - (blocks_per_side - 1) / 2.0) * block_size;
+            const double z = (j - (blocks_per_side - 1) / 2.0) * block_size;
+            const vec3 normal = unit_vector(vec3(x, field_ground_radius, z));
+            affine_transform tilt;
+            const vec3 axis = cross(up, normal);
+            if (axis.length_squared() > 0)
+                tilt = affine_transform::rotate(axis, std::acos(static_cast<double>(normal.y())) * 180 / pi);
+            const point3 origin = ground_center + field_ground_radius * normal;
+            field.emplace_back(variant, affine_transform::translate(origin) * tilt * quarter_turn());
+        }
+    }
+
+    hittable_list result;
+    if (flatten) {
+        result.objects.reserve(field.size() * cells * cells * cells * cells);
+        for (const auto& [block_variant, block_transform] : field) {
+            for (const auto& [tile_variant, tile_transform] : blocks[block_variant]) {
+                const affine_transform to_world = block_transform * tile_transform;
+                for (const auto& s : tiles[tile_variant])
+                    result.add(make_shared<sphere>(to_world.apply_point(s.center), s.radius, s.mat_id));
+            }
+        }
+        return result;
+    }
+
+    std::vector<shared_ptr<const hittable>> tile_objects;
+    for (const auto& tile : tiles) {
+        hittable_list list;
+        for (const auto& s : tile) list.add(make_shared<sphere>(s));
+        tile_objects.push_back(make_shared<bvh>(list, 0, 0));
+    }
+    std::vector<shared_ptr<const hittable>> block_objects;
+    for (const auto& block : blocks) {
+        hittable_list list;
+        for (const auto& [variant, transform] : block)
+            list.add(make_shared<instance>(tile_objects[variant], transform));
+        block_objects.push_back(make_shared<bvh>(list, 0, 0));
+    }
+    hittable_list list;
+    list.objects.reserve(field.size());
+    for (const auto& [variant, transform] : field)
+        list.add(make_shared<instance>(block_objects[variant], transform));
+    result.add(make_shared<bvh>(list, 0, 0));
+    return result;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include "rtweekend.h"
+
+#include "feature_buffer.h"
+#include "hittable.h"
+#include "lights.h"
+#include "material.h"
+#include "stats.h"
+
+// Cor do fundo: um gradiente de azul claro para branco conforme a altura da direção.
+inline color background(const ray& r) {
+    vec3 unit_direction = unit_vector(r.direction());
+    auto t = 0.5*(unit_direction.y() + 1.0);
+    return (1.0-t)*color(1.0, 1.0, 1.0) + t*color(0.5, 0.7, 1.0);
+}
+
+// Política de roleta russa: a partir de start_depth reflexões, o caminho continua com
+// probabilidade igual à maior componente do seu throughput (limitada a min_probability)
+// e, se continuar, tem o throughput dividido por essa probabilidade. A média não muda
+// (o estimador continua sem viés), mas caminhos que quase não carregam energia acabam cedo.
+struct russian_roulette {
+    bool enabled = true;
+    int start_depth = 3;            // Reflexões antes de a roleta começar
+    double min_probability = 0.05;  // Menor probabilidade de sobrevivência
+
+    // Decide se o caminho continua, corrigindo o throughput quando continua.
+    bool survive(int bounce, color& throughput) const {
+        if (!enabled || bounce < start_depth) return true;
+
+        double q = fmax(throughput.x(), fmax(throughput.y(), throughput.z()));
+        if (q >= 1) return true;
+        q = fmax(q, min_probability);
+        if (sample_1d() >= q) return false;
+        throughput /= q;
+        return true;
+    }
+};
+
+// Implementação da função ray_color()
+// Segue o caminho iterativamente, acumulando em 'throughput' o produto das atenuações,
+// até o raio escapar para o fundo, ser absorvido, perder na roleta russa ou atingir
+// max_depth reflexões. 'mode' escolhe como os materiais são chamados; as duas versões
+// dão o mesmo resultado. Se 'first_hit' não for nulo, recebe os atributos do primeiro
+// ponto atingido (só os campos que o caminho chegou a preencher mudam).
+//
+// A luz vem do fundo e dos materiais emissores. Com 'lights', cada ponto lambertiano
+// também amostra as luzes diretamente (ver lights.h), e a emissão que o caminho
+// encontra depois de uma reflexão difusa entra com o peso MIS complementar.
+template <dispatch_mode mode = dispatch_mode::static_variant>
+color ray_color(const ray& r, const hittable& world, const material_arena& materials,
+                int max_depth, const russian_roulette& rr = russian_roulette(),
+                path_features* first_hit = nullptr, const light_list* lights = nullptr) {
+    ray current = r;
+    color throughput(1,1,1);
+    color radiance(0,0,0);
+    double bsdf_pdf = 0;  // Densidade com que a última reflexão difusa sorteou 'current'; 0 se especular
+
+    for (int bounce = 0; bounce < max_depth; ++bounce) {
+        RT_STAT(primary_rays += (bounce == 0));
+        RT_STAT(secondary_rays += (bounce != 0));
+
+        hit_record rec;
+        if (!world.hit(current, 0.001, infinity, rec)) {
+            RT_STAT(end_path(path_end::escaped, bounce + 1));
+            if (first_hit && bounce == 0) first_hit->albedo = background(current);
+            return radiance + throughput * background(current);
+        }
+
+        const material_kind kind = materials.kind(rec.mat_id);
+        if (kind == material_kind::diffuse_light) {
+            color emitted;
+            if constexpr (mode == dispatch_mode::static_variant)
+                emitted = materials.emitted(rec.mat_id, rec);
+            else
+                emitted = materials[rec.mat_id].emitted(rec);
+            const double weight = lights && bsdf_pdf > 0 ? lights->hit_weight(current, rec, bsdf_pdf) : 1.0;
+            radiance += weight * throughput * emitted;
+        }
+
+        ray scattered;
+        color attenuation;
+        bool scatters;
+        set_sample_dimension(bounce_dimension(bounce));
+        if constexpr (mode == dispatch_mode::static_variant)
+            scatters = materials.scatter(rec.mat_id, current, rec, attenuation, scattered);
+        else
+            scatters = materials[rec.mat_id].scatter(current, rec, attenuation, scattered);
+        RT_STAT(record_scatter(kind, scatters));
+        if (first_hit && bounce == 0)
+            *first_hit = {attenuation, rec.normal, rec.t * current.direction().length()};
+        if (!scatters) {
+            RT_STAT(end_path(path_end::absorbed, bounce + 1));
+            return radiance;
+        }
+
+        bsdf_pdf = 0;
+        if (lights && kind == material_kind::lambertian) {
+            set_sample_dimension(bounce_dimension(bounce) + 4);
+            radiance += throughput * attenuation * lights->sample_direct(world, materials, rec, current.time());
+            bsdf_pdf = lambertian_pdf(rec.normal, scattered.direction());
+        }
+
+        throughput = throughput * attenuation;
+        current = scattered;
+
+        set_sample_dimension(bounce_dimension(bounce) + 3);
+        if (!rr.survive(bounce, throughput)) {
+            RT_STAT(end_path(path_end::roulette, bounce + 1));
+            return radiance;
+        }
+    }
+
+    // Se excedemos o limite máximo de reflexões do raio, não há mais luz a ser coletada.
+    RT_STAT(end_path(path_end::max_depth, max_depth));
+    return radiance;
+}
+
+#endif
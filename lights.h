@@ -0,0 +1,202 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include "rtweekend.h"
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "material.h"
+#include "moving_sphere.h"
+#include "sphere.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <vector>
+
+// Amostragem direta das luzes (next-event estimation). Em cada ponto difuso o caminho,
+// além de seguir a direção sorteada pelo material, sorteia um ponto em uma luz e testa
+// com um raio de sombra se ela é visível. As duas estratégias encontram a mesma luz por
+// caminhos diferentes, então cada uma entra com o peso da heurística da potência
+// (Veach, "multiple importance sampling"): a amostragem da luz domina em luzes pequenas
+// e a do material em luzes grandes e próximas, sem contar a mesma energia duas vezes.
+
+// Peso da estratégia de densidade 'a' quando a mesma direção também poderia ter sido
+// sorteada pela outra, de densidade 'b' (heurística da potência com expoente 2)
+inline double power_heuristic(double a, double b) {
+    return a * a / (a * a + b * b);
+}
+
+// Densidade, por ângulo sólido, com que lambertian::scatter sorteia 'direction': o
+// material soma a normal a um vetor unitário uniforme, o que dá cosseno/pi
+inline double lambertian_pdf(const vec3& normal, const vec3& direction) {
+    return fmax(0.0, static_cast<double>(dot(normal, unit_vector(direction)))) / pi;
+}
+
+// Esfera emissora, copiada dos objetos da cena (fixa ou em movimento linear, como
+// moving_sphere) para que as luzes sejam sorteadas sem passar pela hierarquia. Malhas
+// emissoras não são amostradas: só contribuem quando um caminho as encontra.
+struct sphere_light {
+    point3 center0, center1;
+    double time0 = 0, time1 = 0;
+    real radius = 0;
+    std::uint32_t mat_id = 0;
+
+    point3 center(double time) const {
+        if (time1 == time0) return center0;
+        return center0 + real((time - time0) / (time1 - time0)) * (center1 - center0);
+    }
+};
+
+// As luzes da cena. Uma luz é sorteada com probabilidade uniforme e, dentro dela, uma
+// direção uniforme no cone que a esfera ocupa vista do ponto, o que nunca desperdiça
+// amostras na metade de trás da esfera.
+class light_list {
+public:
+    light_list() {}
+
+    // Recolhe as esferas da lista cujo material é diffuse_light
+    light_list(const hittable_list& world, const material_arena& materials);
+
+    bool empty() const { return lights.empty(); }
+    size_t size() const { return lights.size(); }
+
+    // Luz direta em 'rec' por amostragem de uma luz, já com o peso MIS e dividida pela
+    // densidade: emitida * cosseno/pi * peso / pdf. Multiplicada pelo albedo do material
+    // lambertiano dá a contribuição do ponto. Consome três dimensões da amostra.
+    color sample_direct(const hittable& world, const material_arena& materials,
+                        const hit_record& rec, double time) const;
+
+    // Peso MIS da emissão encontrada pelo raio 'r', sorteado por um material difuso com
+    // densidade bsdf_pdf, no ponto 'rec' de uma luz. Emissores que não estão na lista
+    // (ou um ponto dentro da própria luz) só podem ser encontrados assim, e têm peso 1.
+    double hit_weight(const ray& r, const hit_record& rec, double bsdf_pdf) const;
+
+public:
+    // Raios de sombra com a consulta de oclusão; false usa hit(), para comparação
+    bool any_hit = true;
+
+private:
+    // Densidade do cone da luz visto de 'p', já dividida pelo número de luzes.
+    // 'one_minus_cos' recebe 1 - cosseno do semiângulo do cone; zero se p está dentro da luz.
+    double cone_pdf(const sphere_light& light, const point3& p, double time, double& one_minus_cos) const;
+
+private:
+    std::vector<sphere_light> lights;
+};
+
+
+inline light_list::light_list(const hittable_list& world, const material_arena& materials) {
+    for (const auto& object : world.objects) {
+        sphere_light light;
+        if (auto s = dynamic_cast<const sphere*>(object.get())) {
+            light.center0 = light.center1 = s->center;
+            light.radius = s->radius;
+            light.mat_id = s->mat_id;
+        } else if (auto m = dynamic_cast<const moving_sphere*>(object.get())) {
+            light.center0 = m->center0;
+            light.center1 = m->center1;
+            light.time0 = m->time0;
+            light.time1 = m->time1;
+            light.radius = m->radius;
+            light.mat_id = m->mat_id;
+        } else {
+            continue;
+        }
+        if (materials.kind(light.mat_id) == material_kind::diffuse_light)
+            lights.push_back(light);
+    }
+}
+
+inline double light_list::cone_pdf(const sphere_light& light, const point3& p, double time,
+                                   double& one_minus_cos) const {
+    const double distance_squared = (light.center(time) - p).length_squared();
+    const double radius_squared = static_cast<double>(light.radius) * light.radius;
+    if (distance_squared <= radius_squared) {
+        one_minus_cos = 0;
+        return 0;
+    }
+    // 1 - cos pela forma sin²/(1 + cos), que não perde dígitos em luzes pequenas ou distantes
+    const double sin2_max = radius_squared / distance_squared;
+    one_minus_cos = sin2_max / (1 + sqrt(1 - sin2_max));
+    return 1 / (2 * pi * one_minus_cos * lights.size());
+}
+
+inline color light_list::sample_direct(const hittable& world, const material_arena& materials,
+                                       const hit_record& rec, double time) const {
+    const double choice = sample_1d();
+    double u, v;
+    sample_2d(u, v);
+
+    const auto n = lights.size();
+    const sphere_light& light = lights[std::min(n - 1, static_cast<size_t>(choice * n))];
+    double one_minus_cos;
+    const double light_pdf = cone_pdf(light, rec.p, time, one_minus_cos);
+    if (light_pdf == 0) return color(0,0,0);
+
+    // Direção no cone, em torno do eixo que aponta para o centro da luz
+    const vec3 to_center = light.center(time) - rec.p;
+    const double distance = to_center.length();
+    const vec3 w = to_center / distance;
+    const double cos_theta = 1 - u * one_minus_cos;
+    const double sin_theta = sqrt(fmax(0.0, 1 - cos_theta * cos_theta));
+    const double phi = 2 * pi * v;
+    // Base ortonormal sem desvios (Duff et al., "Building an Orthonormal Basis, Revisited")
+    const double sign = std::copysign(1.0, static_cast<double>(w.z()));
+    const double a = -1 / (sign + w.z());
+    const double b = w.x() * w.y() * a;
+    const vec3 tangent(1 + sign * w.x() * w.x() * a, sign * b, -sign * w.x());
+    const vec3 bitangent(b, sign + w.y() * w.y() * a, -w.y());
+    const vec3 direction = (sin_theta * std::cos(phi)) * tangent + (sin_theta * std::sin(phi)) * bitangent
+                         + cos_theta * w;
+
+    const double cosine = dot(rec.normal, direction);
+    if (cosine <= 0) return color(0,0,0);
+
+    // Distância até a superfície da luz nessa direção; o raio de sombra para um pouco antes
+    const double projection = dot(to_center, direction);
+    const double half_chord2 = static_cast<double>(light.radius) * light.radius
+                             - (distance * distance - projection * projection);
+    const double t_light = projection - sqrt(fmax(0.0, half_chord2));
+
+    RT_STAT(shadow_rays++);
+    const ray shadow(rec.spawn_origin(direction), direction, time);
+    if (any_hit) {
+        if (world.occluded(shadow, 0.001, t_light - 0.001)) return color(0,0,0);
+    } else {
+        hit_record blocker;
+        if (world.hit(shadow, 0.001, t_light - 0.001, blocker)) return color(0,0,0);
+    }
+
+    hit_record light_rec;
+    light_rec.t = t_light;
+    light_rec.p = shadow.at(t_light);
+    light_rec.set_face_normal(shadow, (light_rec.p - light.center(time)) / light.radius);
+    light_rec.mat_id = light.mat_id;
+
+    const double bsdf_pdf = cosine / pi;
+    const double weight = power_heuristic(light_pdf, bsdf_pdf);
+    return materials.emitted(light.mat_id, light_rec) * (bsdf_pdf * weight / light_pdf);
+}
+
+inline double light_list::hit_weight(const ray& r, const hit_record& rec, double bsdf_pdf) const {
+    // A luz atingida é a de mesmo material cuja superfície passa mais perto do ponto.
+    // Se nenhuma passa perto, o ponto é de outro emissor com o mesmo material (uma malha).
+    const sphere_light* hit_light = nullptr;
+    double best = infinity;
+    for (const auto& light : lights) {
+        if (light.mat_id != rec.mat_id) continue;
+        const double gap = fabs((rec.p - light.center(r.time())).length() - light.radius);
+        if (gap < best && gap <= 1e-3 * (1 + light.radius)) {
+            best = gap;
+            hit_light = &light;
+        }
+    }
+    if (!hit_light) return 1;
+
+    double one_minus_cos;
+    const double light_pdf = cone_pdf(*hit_light, r.origin(), r.time(), one_minus_cos);
+    if (light_pdf == 0) return 1;
+    return power_heuristic(bsdf_pdf, light_pdf);
+}
+
+#endif
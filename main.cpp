@@ -1,121 +1,448 @@
 #include "rtweekend.h"
 
+#include "animation.h"
 #include "camera.h"
-#include "color.h"
+#include "checkpoint.h"
 #include "hittable_list.h"
+#include "image_io.h"
+#include "instanced_scene.h"
 #include "material.h"
-#include "sphere.h"
+#include "partial.h"
+#include "random_scene.h"
+#include "render_queue.h"
+#include "renderer.h"
+#include "scene.h"
+#include "stats.h"
+#include "texture_cache.h"
+#include "tile_stream.h"
 
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
-#include <fstream>
+#include <string>
 
-// Implementação da função ray_color()
-color ray_color(const ray& r, const hittable& world, int depth) { 
-    hit_record rec;
-
-    // Se excedemos o limite máximo de reflexões do raio, não há mais luz a ser coletada.
-    if (depth <= 0)
-        return color(0,0,0);
+// Lê um inteiro de pelo menos 'min'; retorna false, sem mudar 'value', se o texto não
+// for um número inteiro ou for menor
+bool parse_int(const char* text, int min, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    const long v = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || v < min || v > INT_MAX) return false;
+    value = static_cast<int>(v);
+    return true;
+}
 
-    if (world.hit(r, 0.001, infinity, rec)) {
-        ray scattered;
-        color attenuation;
-        if (rec.mat_ptr->scatter(r, rec, attenuation, scattered))
-            return attenuation * ray_color(scattered, world, depth-1);
-        return color(0,0,0);
-    }
+// Lê um número real finito entre 'min' e 'max'; retorna false, sem mudar 'value', se o
+// texto não for um número ou estiver fora do intervalo
+bool parse_double(const char* text, double min, double max, double& value) {
+    char* end = nullptr;
+    errno = 0;
+    const double v = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(v) || v < min || v > max) return false;
+    value = v;
+    return true;
+}
 
-    // Calcula a cor do fundo usando um gradiente de azul claro para branco.
-    vec3 unit_direction = unit_vector(r.direction());
-    auto t = 0.5*(unit_direction.y() + 1.0);
-    return (1.0-t)*color(1.0, 1.0, 1.0) + t*color(0.5, 0.7, 1.0);
+// Lê a parte "K/N" de --job; a validação de K contra N fica para depois das opções,
+// porque --jobs também muda N
+bool parse_job(const char* text, render_job& job) {
+    const std::string s = text;
+    const auto slash = s.find('/');
+    int index = 0, count = 0;
+    if (slash == std::string::npos || !parse_int(s.substr(0, slash).c_str(), 0, index)
+        || !parse_int(s.substr(slash + 1).c_str(), 1, count)) return false;
+    job.index = index;
+    job.count = count;
+    return true;
 }
 
-// Implementação da função random_scene()
-hittable_list random_scene() {
-    hittable_list world;
-
-    auto ground_material = make_shared<lambertian>(color(0.5, 0.5, 0.5));
-    world.add(make_shared<sphere>(point3(0,-1000,0), 1000, ground_material));
-
-    for (int a = -2; a <8; a+=1) {
-        for (int b = -2; b < 8; b+=1) {
-            auto choose_mat = random_double();
-            point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
-
-            if ((center - point3(4, 0.2, 0)).length() > 0.9) {
-                shared_ptr<material> sphere_material;
-
-                if (choose_mat < 0.8) {
-                    // Material difuso
-                    auto albedo = color::random() * color::random();
-                    sphere_material = make_shared<lambertian>(albedo);
-                    world.add(make_shared<sphere>(center, 0.2, sphere_material));
-                } else if (choose_mat < 0.95) {
-                    // Material metálico
-                    auto albedo = color::random(0.5, 1);
-                    auto fuzz = random_double(0, 0.5);
-                    sphere_material = make_shared<metal>(albedo, fuzz);
-                    world.add(make_shared<sphere>(center, 0.2, sphere_material));
-                } else {
-                    // Material de vidro
-                    sphere_material = make_shared<dielectric>(1.5);
-                    world.add(make_shared<sphere>(center, 0.2, sphere_material));
-                }
-            }
+// Renderização distribuída (ver partial.h): renderiza só a parte 'job' e a grava em
+// partial_path ou, com um diretório de trabalhos, reserva e renderiza uma a uma as
+// partes que ainda estiverem livres, até não sobrar nenhuma. Cada parte é um job no pool.
+int run_distributed(const shared_ptr<const render_scene>& scene, const camera& cam, const render_settings& settings,
+                    worker_pool& pool, render_job job, const std::string& partial_path,
+                    const std::string& job_dir, std::uint64_t scene_hash) {
+    auto render_one = [&](const std::string& path) {
+        submit_options request;
+        request.mode = render_mode::partial;
+        request.pool = &pool;
+        request.job = job;
+        const render_handle rendering = submit(scene, cam, settings, std::move(request));
+        partial_buffer part = rendering.result().part;
+        part.scene_hash = scene_hash;
+        part.render_hash = render_fingerprint(cam, settings);
+        if (!save_partial(path, part)) {
+            std::cerr << "\nNão foi possível gravar " << path << '\n';
+            return false;
         }
-    }
-
-    auto material1 = make_shared<dielectric>(1.5);
-    world.add(make_shared<sphere>(point3(0, 1, 0), 1.0, material1));
+        std::cerr << "\nParte " << job.index << " de " << job.count << " gravada em " << path
+                  << " (" << rendering.result().render_seconds << " s)\n";
+        return true;
+    };
 
-    auto material2 = make_shared<lambertian>(color(0.4, 0.2, 0.1));
-    world.add(make_shared<sphere>(point3(-4, 1, 0), 1.0, material2));
+    if (job_dir.empty())
+        return render_one(partial_path) ? 0 : 1;
 
-    auto material3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
-    world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
-
-    return world;
+    std::error_code ec;
+    std::filesystem::create_directories(job_dir, ec);
+    int rendered = 0;
+    for (int k = 0; k < job.count; ++k) {
+        if (!claim_job(job_dir, k)) continue;
+        job.index = k;
+        if (!render_one(job_partial_path(job_dir, k))) return 1;
+        rendered++;
+    }
+    std::cerr << "Partes renderizadas por este processo: " << rendered << '\n';
+    return 0;
 }
 
-int main() {
+int main(int argc, char** argv) {
     // Imagem
 
     // Definição das constantes
-    const auto aspect_ratio = 16.0 / 9.0;
-    const int image_width = 1200;
-    const int image_height = static_cast<int>(image_width / aspect_ratio);
-    const int samples_per_pixel = 10;
-    const int max_depth = 50;
+    render_settings settings;
+    std::string output_path = "./output/image.ppm";
+    std::string scene_path;
+    std::string compare_path;
+    std::string stats_path;
+    render_job job;
+    std::string partial_path;
+    std::string job_dir;
+    std::string heatmap_path;
+    sequence_settings sequence;
+    sequence.frames = 0;
+    double degrees_per_frame = 0;
+    double shutter = 0.5;
+    bool room_scene = false;
+    int field_blocks = 0;
+    bool flatten_field = false;
+    bool use_nee = true;
+    bool denoise_output = false;
+    std::string aux_base;
+    bool adaptive = false;
+    bool progressive = false;
+    bool resume = false;
+    std::string checkpoint_path;
+    std::string stream_target;
+    double texture_budget_mb = 256;
+    bool use_bvh = true;
+    bool use_sphere_sets = false;
+
+    // Opções de linha de comando
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        if (arg == "--threads" && has_value && parse_int(argv[a + 1], 1, settings.threads)) ++a;
+        else if (arg == "--tile" && has_value && parse_int(argv[a + 1], 1, settings.tile_size)) ++a;
+        else if (arg == "--width" && has_value && parse_int(argv[a + 1], 2, settings.image_width)) ++a;
+        else if (arg == "--spp" && has_value && parse_int(argv[a + 1], 1, settings.samples_per_pixel)) ++a;
+        else if (arg == "--output" && has_value) output_path = argv[++a];
+        else if (arg == "--scene" && has_value) scene_path = argv[++a];
+        else if (arg == "--compare" && has_value) compare_path = argv[++a];
+        else if (arg == "--stats" && has_value) stats_path = argv[++a];
+        else if (arg == "--job" && has_value && parse_job(argv[a + 1], job)) ++a;
+        else if (arg == "--partial" && has_value) partial_path = argv[++a];
+        else if (arg == "--job-dir" && has_value) job_dir = argv[++a];
+        else if (arg == "--jobs" && has_value && parse_int(argv[a + 1], 1, job.count)) ++a;
+        else if (arg == "--split" && has_value)
+            job.split = std::string(argv[++a]) == "samples" ? split_mode::samples : split_mode::tiles;
+        else if (arg == "--frames" && has_value && parse_int(argv[a + 1], 1, sequence.frames)) ++a;
+        else if (arg == "--degrees-per-frame" && has_value
+                 && parse_double(argv[a + 1], -infinity, infinity, degrees_per_frame)) ++a;
+        else if (arg == "--shutter" && has_value && parse_double(argv[a + 1], 0, 1, shutter)) ++a;
+        else if (arg == "--rebuild") sequence.always_rebuild = true;
+        else if (arg == "--stats-heatmap" && has_value) heatmap_path = argv[++a];
+        else if (arg == "--max-depth" && has_value && parse_int(argv[a + 1], 1, settings.max_depth)) ++a;
+        else if (arg == "--wavefront") settings.wavefront = true;
+        else if (arg == "--no-rr") settings.rr.enabled = false;
+        else if (arg == "--rr-start" && has_value && parse_int(argv[a + 1], 0, settings.rr.start_depth)) ++a;
+        else if (arg == "--rr-min-prob" && has_value
+                 && parse_double(argv[a + 1], 0, 1, settings.rr.min_probability)) ++a;
+        else if (arg == "--sampler" && has_value && parse_sampler(argv[a + 1], settings.sampler)) ++a;
+        else if (arg == "--room") room_scene = true;
+        else if (arg == "--instances" && has_value && parse_int(argv[a + 1], 1, field_blocks)) ++a;
+        else if (arg == "--flatten") flatten_field = true;
+        else if (arg == "--no-nee") use_nee = false;
+        else if (arg == "--denoise") denoise_output = true;
+        else if (arg == "--aux" && has_value) aux_base = argv[++a];
+        else if (arg == "--virtual-dispatch") settings.dispatch = dispatch_mode::virtual_calls;
+        else if (arg == "--adaptive") adaptive = true;
+        else if (arg == "--progressive") progressive = true;
+        else if (arg == "--checkpoint" && has_value) checkpoint_path = argv[++a];
+        else if (arg == "--resume") resume = true;
+        else if (arg == "--stream" && has_value) stream_target = argv[++a];
+        else if (arg == "--texture-budget" && has_value
+                 && parse_double(argv[a + 1], 0, 1 << 20, texture_budget_mb)) ++a;
+        else if (arg == "--noise" && has_value
+                 && parse_double(argv[a + 1], 0, infinity, settings.noise_threshold)) ++a;
+        else if (arg == "--max-spp" && has_value && parse_int(argv[a + 1], 1, settings.max_samples_per_pixel)) ++a;
+        else if (arg == "--pass-spp" && has_value && parse_int(argv[a + 1], 1, settings.pass_samples)) ++a;
+        else if (arg == "--no-bvh") use_bvh = false;
+        else if (arg == "--sphere-sets") use_sphere_sets = true;
+        else {
+            std::cerr << "Uso: " << argv[0]
+                      << " [--threads N] [--tile N] [--width N] [--spp N] [--max-depth N]"
+                         " [--output arquivo.ppm|.pfm|.png] [--scene arquivo.scn|.scnb] [--compare ref.pfm]"
+                         " [--stats arquivo.json] [--stats-heatmap arquivo.ppm|.png]"
+                         " [--job K/N --partial arquivo.rtp | --job-dir dir --jobs N]"
+                         " [--split tiles|samples (só tiles junta uma imagem idêntica, byte a byte)]"
+                         " [--frames N] [--degrees-per-frame G] [--shutter S] [--rebuild]"
+                         " [--denoise] [--aux base] [--sampler random|sobol|blue-noise]"
+                         " [--room] [--no-nee] [--instances N [--flatten]]"
+                         " [--no-bvh] [--sphere-sets] [--wavefront] [--no-rr] [--rr-start N] [--rr-min-prob P]"
+                         " [--adaptive] [--noise T] [--max-spp N] [--pass-spp N]"
+                         " [--progressive] [--checkpoint arquivo] [--resume] [--stream -|socket|fifo]"
+                         " [--texture-budget MB (sem os caches das threads)] [--virtual-dispatch]\n"
+                         "(as comparações de técnicas estão em bench --compare)\n";
+            return 1;
+        }
+    }
+
+    if (job.count < 1 || job.index < 0 || job.index >= job.count) {
+        std::cerr << "Parte inválida: " << job.index << " de " << job.count << '\n';
+        return 1;
+    }
+    if (adaptive && !adaptive_settings_error(settings).empty()) {
+        std::cerr << "--adaptive: " << adaptive_settings_error(settings) << '\n';
+        return 1;
+    }
+    const bool want_features = denoise_output || !aux_base.empty();
+    if (want_features && (adaptive || progressive)) {
+        std::cerr << "--denoise e --aux não funcionam com --adaptive nem --progressive\n";
+        return 1;
+    }
+    if (!stream_target.empty() && (sequence.frames > 0 || !partial_path.empty() || !job_dir.empty())) {
+        std::cerr << "--stream não funciona com --frames nem com a renderização distribuída\n";
+        return 1;
+    }
+    if (!stats_enabled() && !(stats_path.empty() && heatmap_path.empty())) {
+        std::cerr << "--stats e --stats-heatmap exigem um programa compilado com -DRT_STATS\n";
+        return 1;
+    }
+
+    // Cena: a do arquivo, se houver, o campo instanciado, a sala iluminada ou a cena
+    // aleatória padrão
+    scene_data description;
+    if (field_blocks > 0 && scene_path.empty()) {
+        description = make_field_scene();
+    } else if (room_scene && scene_path.empty()) {
+        description = make_room_scene();
+    } else if (scene_path.empty()) {
+        description = make_random_scene();
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        if (!load_scene(scene_path, description, error)) {
+            std::cerr << "Erro ao ler a cena: " << error << '\n';
+            return 1;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << "Cena " << scene_path << ": " << description.sphere_count() << " esferas, "
+                  << description.mesh_count() << " malhas, " << description.material_count() << " materiais, lida em "
+                  << elapsed.count() * 1000 << " ms\n";
+    }
+    settings.image_height = static_cast<int>(settings.image_width / description.cam.aspect_ratio);
+    // A câmera divide por (largura - 1) e (altura - 1)
+    if (settings.image_height < 2) {
+        std::cerr << "Imagem de " << settings.image_width << "x" << settings.image_height
+                  << " pixels: a largura e a altura precisam ser pelo menos 2\n";
+        return 1;
+    }
+
+    // Texturas: só os cabeçalhos são lidos agora; os tiles vêm do disco durante a
+    // renderização e ficam no cache até o limite de memória
+    shared_ptr<texture_cache> textures;
+    if (description.texture_count() > 0) {
+        textures = make_shared<texture_cache>(static_cast<std::uint64_t>(texture_budget_mb * 1024 * 1024));
+        textures->set_pixel_angle(degrees_to_radians(description.cam.vfov) / settings.image_height);
+        std::string error;
+        if (!description.open_textures(scene_path, textures, error)) {
+            std::cerr << "Erro ao abrir as texturas: " << error << '\n';
+            return 1;
+        }
+        if (textures->budget() < textures->max_tile_bytes())
+            std::cerr << "Aviso: --texture-budget é menor que um tile (" << textures->max_tile_bytes() / 1e6
+                      << " MB); o cache vai guardar um tile de cada vez\n";
+    }
+
+    // Animação: uma volta completa no número de quadros pedido, se o passo não for dado
+    if (sequence.frames > 0) {
+        if (field_blocks > 0) {
+            std::cerr << "--instances não funciona com --frames\n";
+            return 1;
+        }
+        sequence.use_bvh = use_bvh;
+        sequence.sample_lights = use_nee;
+        if (degrees_per_frame == 0) degrees_per_frame = 360.0 / sequence.frames;
+        return write_animation(description, settings, sequence, degrees_per_frame, shutter, output_path) ? 0 : 1;
+    }
 
     // Mundo
-    auto world = random_scene();
+    material_arena arena;
+    hittable_list objects = build_world(description, arena);
+    if (field_blocks > 0 && scene_path.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& object : make_sphere_field(arena, field_blocks, flatten_field).objects)
+            objects.add(object);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << "Campo de " << field_blocks << "x" << field_blocks << " blocos: "
+                  << 1e4 * field_blocks * field_blocks << " esferas"
+                  << (flatten_field ? "" : " efetivas") << ", criado em " << elapsed.count() << " s\n";
+    }
+    scene_options options;
+    options.bvh = use_bvh;
+    options.sphere_sets = use_sphere_sets;
+    options.sample_lights = use_nee;
+    options.dispatch = settings.dispatch;
+    const auto prepared = make_render_scene(std::move(objects), std::move(arena), options);
+    if (!prepared->lights.empty())
+        settings.lights = &prepared->lights;
 
     // Câmera
-    point3 lookfrom(13,2,3);
-    point3 lookat(0,0,0);
-    vec3 vup(0,1,0);
-    auto dist_to_focus = 10.0;
-    auto aperture = 0.1;
-    camera cam(lookfrom, lookat, vup, 20, aspect_ratio, aperture, dist_to_focus);
-    std::ofstream outfile("./output/image.ppm");
-    // Renderização
-    std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
-
-    for (int j = image_height-1; j >= 0; --j) {
-        std::cerr << "\rScanlines restantes: " << j << ' ' << std::flush;
-        for (int i = 0; i < image_width; ++i) {
-            color pixel_color(0,0,0);
-            for (int s = 0; s < samples_per_pixel; ++s) {
-                auto u = (i + random_double()) / (image_width-1);
-                auto v = (j + random_double()) / (image_height-1);
-                ray r = cam.get_ray(u, v);
-                pixel_color += ray_color(r, world, max_depth);
+    camera cam = make_camera(description.cam);
+
+    // O campo instanciado não está na descrição; o tamanho dele entra no hash da cena
+    std::uint64_t scene_hash = scene_fingerprint(description);
+    if (field_blocks > 0 && scene_path.empty()) {
+        hasher h;
+        h.add(static_cast<std::int64_t>(scene_hash));
+        h.add(field_blocks);
+        h.add(flatten_field ? 1 : 0);
+        scene_hash = h.value();
+    }
+
+    // Renderização: um job no pool de --threads workers (ver render_queue.h), ou um por
+    // parte na renderização distribuída
+    worker_pool pool(settings.threads);
+    if (!partial_path.empty() || !job_dir.empty())
+        return run_distributed(prepared, cam, settings, pool, job, partial_path, job_dir, scene_hash);
+
+    render_stats stats;
+    if (!stats_path.empty() || !heatmap_path.empty())
+        settings.stats = &stats;
+    tile_stream stream;
+    if (!stream_target.empty()) {
+        std::string error;
+        if (!stream.open(stream_target, settings.image_width, settings.image_height, error)) {
+            std::cerr << "Erro no stream: " << error << '\n';
+            return 1;
+        }
+        settings.stream = &stream;
+    }
+    submit_options request;
+    request.pool = &pool;
+    request.features = want_features;
+    request.denoise = denoise_output;
+    if (progressive) {
+        // Cada passada grava o checkpoint (se pedido) e uma prévia da imagem
+        request.mode = render_mode::progressive;
+        const auto render_hash = render_fingerprint(cam, settings);
+        std::uint32_t passes_before = 0;
+
+        if (resume) {
+            checkpoint_header header;
+            if (!load_checkpoint(checkpoint_path, request.resume, header)) {
+                std::cerr << "Checkpoint inválido ou inexistente: " << checkpoint_path << '\n';
+                return 1;
+            }
+            if (header.scene_hash != scene_hash || header.render_hash != render_hash) {
+                std::cerr << "O checkpoint " << checkpoint_path << " é de outra cena ou câmera\n";
+                return 1;
             }
-            write_color(outfile, pixel_color, samples_per_pixel);
+            passes_before = header.passes;
+            std::cerr << "Retomando após " << header.passes << " passadas ("
+                      << request.resume.count[0] << " amostras por pixel)\n";
+        }
+
+        request.after_pass = [&, passes_before, render_hash](const accumulation_buffer& acc, int pass) {
+            const std::uint32_t done = passes_before + pass;
+            if (!checkpoint_path.empty()
+                && !save_checkpoint(checkpoint_path, acc, done, scene_hash, render_hash))
+                std::cerr << "\nNão foi possível gravar o checkpoint " << checkpoint_path << '\n';
+            framebuffer preview;
+            acc.resolve(preview);
+            write_image(output_path, preview, 1.0);
+            if (settings.progress)
+                std::cerr << "\rPassada " << done << ": " << acc.count[0] << " amostras por pixel " << std::flush;
+        };
+    } else if (adaptive) {
+        request.mode = render_mode::adaptive;
+    }
+
+    const render_handle rendering = submit(prepared, cam, settings, std::move(request));
+    const render_result& result = rendering.result();
+    const framebuffer& fb = result.image;
+    const double scale = result.scale;
+    if (adaptive)
+        std::cerr << "\nAmostras: " << result.acc.total_samples() << " ("
+                  << static_cast<double>(result.acc.total_samples()) / result.acc.pixel_count() << " por pixel)";
+
+    // Buffers auxiliares e denoiser
+    if (!aux_base.empty() && !write_features(aux_base, result.features)) {
+        std::cerr << "\nNão foi possível gravar os buffers auxiliares " << aux_base << "_*.pfm\n";
+        return 1;
+    }
+    if (denoise_output)
+        std::cerr << "\nDenoiser: " << result.denoise_seconds * 1000 << " ms";
+
+    if (!write_image(output_path, fb, scale)) {
+        std::cerr << "\nNão foi possível gravar " << output_path << '\n';
+        return 1;
+    }
+    // Só agora espera o leitor receber o resto do stream, com a imagem já gravada
+    if (stream.is_open()) {
+        const bool ok = stream.close();
+        std::cerr << "\nStream: " << stream.messages_sent() << " mensagens, "
+                  << stream.bytes_sent() / 1e6 << " MB, " << stream.messages_replaced()
+                  << " tiles substituídos na fila" << (ok ? "" : " (o leitor fechou a conexão)");
+    }
+
+    if (textures) {
+        const auto t = textures->stats();
+        std::cerr << "\nTexturas: " << t.lookups << " consultas, " << 100 * t.hit_rate() << "% sem ler o disco ("
+                  << t.thread_hits << " no cache da thread, " << t.shared_hits << " no compartilhado); "
+                  << t.loads << " tiles lidos, " << t.evictions << " descartados, "
+                  << t.resident_bytes / 1e6 << " MB no cache (pico " << t.peak_bytes / 1e6 << " MB, limite "
+                  << textures->budget() / 1e6 << " MB, fora os caches das threads, de até "
+                  << texture_thread_slots * textures->max_tile_bytes() / 1e6 << " MB cada)";
+        if (t.read_errors > 0) std::cerr << "; " << t.read_errors << " leituras falharam";
+    }
+
+    if (!stats_path.empty()) {
+        if (!write_stats_json(stats_path, stats, result.render_seconds)) {
+            std::cerr << "\nNão foi possível gravar " << stats_path << '\n';
+            return 1;
+        }
+        std::cerr << "\nRaios: " << stats.primary_rays << " primários, " << stats.secondary_rays
+                  << " secundários; " << static_cast<double>(stats.box_tests + stats.primitive_tests) / stats.rays()
+                  << " testes de interseção por raio";
+    }
+    if (!heatmap_path.empty() && !write_stats_heatmap(heatmap_path, stats)) {
+        std::cerr << "\nNão foi possível gravar " << heatmap_path << '\n';
+        return 1;
+    }
+
+    // Compara com uma imagem de referência, por exemplo a mesma cena renderizada com a
+    // outra precisão (ver RT_FLOAT em vec3.h)
+    if (!compare_path.empty()) {
+        framebuffer reference;
+        if (!read_pfm(compare_path, reference)
+            || reference.width != fb.width || reference.height != fb.height) {
+            std::cerr << "\nReferência inválida ou de outro tamanho: " << compare_path << '\n';
+            return 1;
         }
+        framebuffer normalized = fb;
+        for (auto& v : normalized.rgb) v *= static_cast<float>(scale);
+        const double primary_rays = static_cast<double>(fb.pixel_count()) * settings.samples_per_pixel;
+        std::cerr << "\nPrecisão: " << (sizeof(real) == sizeof(float) ? "float" : "double")
+                  << "  tempo: " << result.render_seconds << " s  "
+                  << primary_rays / result.render_seconds / 1e6 << " Mrays/s"
+                  << "  erro RMS: " << display_rmse(normalized, reference);
     }
-    outfile.close();
     std::cerr << "\nConcluído.\n";
 }
 
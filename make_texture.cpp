@@ -0,0 +1,225 @@
+// Converte uma imagem em textura .rtt (ver texture_cache.h): calcula o mip-map inteiro,
+// com cada nível filtrado do anterior em espaço linear, e grava os níveis divididos em
+// tiles. A conversão acontece uma vez; a renderização só lê os tiles que usar.
+//
+//     g++ -O2 -std=c++17 make_texture.cpp -o output/make_texture
+//     ./output/make_texture terra.ppm --output texturas/terra.rtt
+//     ./output/make_texture --pattern 16384 8192 --output texturas/grade.rtt
+//
+// Aceita PPM binário (P6, 8 bits, com correção gama 2 como os gravados pelo ray tracer)
+// e PFM (radiância linear). --pattern gera uma grade de meridianos e paralelos em
+// projeção equirretangular, do tamanho pedido, para testar texturas maiores que a memória
+// do cache sem precisar de uma imagem desse tamanho.
+
+#include "rtweekend.h"
+
+#include "image_io.h"
+#include "texture_cache.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Imagem linear, linha de cima primeiro
+struct linear_image {
+    int width = 0, height = 0;
+    std::vector<float> rgb;
+};
+
+static bool read_ppm(const std::string& path, linear_image& image) {
+    std::ifstream in(path, std::ios::binary);
+    std::string magic;
+    int maxval = 0;
+    if (!(in >> magic >> image.width >> image.height >> maxval) || magic != "P6"
+        || image.width <= 0 || image.height <= 0 || maxval != 255)
+        return false;
+    in.get();
+    std::vector<std::uint8_t> bytes(static_cast<size_t>(image.width) * image.height * 3);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+        return false;
+    image.rgb.resize(bytes.size());
+    for (size_t k = 0; k < bytes.size(); ++k) {
+        const float c = (bytes[k] + 0.5f) / 256.0f;  // Mesma decodificação do texture_cache
+        image.rgb[k] = c * c;
+    }
+    return true;
+}
+
+static bool read_input(const std::string& path, linear_image& image) {
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".pfm") == 0) {
+        framebuffer fb;
+        if (!read_pfm(path, fb)) return false;
+        image.width = fb.width;
+        image.height = fb.height;
+        image.rgb.resize(fb.rgb.size());
+        const size_t row = static_cast<size_t>(fb.width) * 3;
+        for (int j = 0; j < fb.height; ++j)  // O PFM vem de baixo para cima
+            std::copy_n(&fb.rgb[static_cast<size_t>(fb.height - 1 - j) * row], row, &image.rgb[j * row]);
+        return true;
+    }
+    return read_ppm(path, image);
+}
+
+// Meridianos a cada 15 graus e paralelos a cada 10 sobre um xadrez cuja cor muda com a
+// longitude, para que o nível do mip-map escolhido apareça na imagem
+static linear_image make_pattern(int width, int height) {
+    linear_image image;
+    image.width = width;
+    image.height = height;
+    image.rgb.resize(static_cast<size_t>(width) * height * 3);
+    const double line = 0.15;  // Largura das linhas em graus
+    for (int y = 0; y < height; ++y) {
+        const double latitude = 180.0 * (y + 0.5) / height;
+        for (int x = 0; x < width; ++x) {
+            const double longitude = 360.0 * (x + 0.5) / width;
+            float* p = &image.rgb[(static_cast<size_t>(y) * width + x) * 3];
+            const bool on_line = std::fmod(longitude, 15.0) < line || std::fmod(latitude, 10.0) < line;
+            if (on_line) {
+                p[0] = p[1] = p[2] = 0.9f;
+                continue;
+            }
+            const bool dark = (static_cast<int>(longitude / 15) + static_cast<int>(latitude / 10)) % 2;
+            const double hue = longitude / 360.0;
+            const float level = dark ? 0.1f : 0.5f;
+            p[0] = level * static_cast<float>(0.6 + 0.4 * std::cos(2 * pi * hue));
+            p[1] = level * static_cast<float>(0.6 + 0.4 * std::cos(2 * pi * (hue - 1.0 / 3)));
+            p[2] = level * static_cast<float>(0.6 + 0.4 * std::cos(2 * pi * (hue - 2.0 / 3)));
+        }
+    }
+    return image;
+}
+
+// Nível seguinte do mip-map: média de blocos 2x2, repetindo a última linha ou coluna
+// quando o tamanho é ímpar
+static linear_image downsample(const linear_image& in) {
+    linear_image out;
+    out.width = std::max(1, (in.width + 1) / 2);
+    out.height = std::max(1, (in.height + 1) / 2);
+    out.rgb.resize(static_cast<size_t>(out.width) * out.height * 3);
+    for (int y = 0; y < out.height; ++y) {
+        const int y0 = std::min(2 * y, in.height - 1), y1 = std::min(2 * y + 1, in.height - 1);
+        for (int x = 0; x < out.width; ++x) {
+            const int x0 = std::min(2 * x, in.width - 1), x1 = std::min(2 * x + 1, in.width - 1);
+            for (int c = 0; c < 3; ++c) {
+                auto at = [&](int xx, int yy) { return in.rgb[(static_cast<size_t>(yy) * in.width + xx) * 3 + c]; };
+                out.rgb[(static_cast<size_t>(y) * out.width + x) * 3 + c] =
+                    0.25f * (at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1));
+            }
+        }
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    std::string input_path;
+    std::string output_path = "./output/texture.rtt";
+    int pattern_width = 0, pattern_height = 0;
+    int tile_size = 64;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        if (arg == "--output" && has_value) output_path = argv[++a];
+        else if (arg == "--pattern" && a + 2 < argc) {
+            pattern_width = std::atoi(argv[++a]);
+            pattern_height = std::atoi(argv[++a]);
+        }
+        else if (arg == "--tile" && has_value) tile_size = std::atoi(argv[++a]);
+        else if (arg[0] != '-' && input_path.empty()) input_path = arg;
+        else {
+            std::cerr << "Uso: " << argv[0] << " (imagem.ppm|.pfm | --pattern L A) [--output arquivo.rtt] [--tile N]\n";
+            return 1;
+        }
+    }
+    if (input_path.empty() == (pattern_width <= 0 || pattern_height <= 0) || tile_size < 1 || tile_size > 4096) {
+        std::cerr << "Dê uma imagem ou --pattern L A, e um --tile entre 1 e 4096\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    linear_image image;
+    if (!input_path.empty()) {
+        if (!read_input(input_path, image)) {
+            std::cerr << "Não foi possível ler " << input_path << " (PPM P6 de 8 bits ou PFM)\n";
+            return 1;
+        }
+    } else {
+        image = make_pattern(pattern_width, pattern_height);
+    }
+
+    std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Não foi possível gravar " << output_path << '\n';
+        return 1;
+    }
+
+    // O cabeçalho precisa das posições dos níveis, que só dependem dos tamanhos
+    std::vector<texture_file_level> levels;
+    for (int w = image.width, h = image.height; ; w = std::max(1, (w + 1) / 2), h = std::max(1, (h + 1) / 2)) {
+        texture_file_level l{};
+        l.width = static_cast<std::uint32_t>(w);
+        l.height = static_cast<std::uint32_t>(h);
+        l.tiles_x = static_cast<std::uint32_t>((w + tile_size - 1) / tile_size);
+        l.tiles_y = static_cast<std::uint32_t>((h + tile_size - 1) / tile_size);
+        levels.push_back(l);
+        if (w == 1 && h == 1) break;
+    }
+    const std::uint64_t tile_bytes = static_cast<std::uint64_t>(tile_size) * tile_size * 3;
+    // Os tiles começam em múltiplos de 4096 bytes, como as páginas lidas pelo sistema
+    std::uint64_t offset = sizeof(texture_file_header) + levels.size() * sizeof(texture_file_level);
+    for (auto& l : levels) {
+        offset = (offset + 4095) & ~std::uint64_t(4095);
+        l.offset = offset;
+        offset += static_cast<std::uint64_t>(l.tiles_x) * l.tiles_y * tile_bytes;
+    }
+
+    texture_file_header header{};
+    std::memcpy(header.magic, "RTTEX001", 8);
+    header.version = texture_file_version;
+    header.width = static_cast<std::uint32_t>(image.width);
+    header.height = static_cast<std::uint32_t>(image.height);
+    header.tile_size = static_cast<std::uint32_t>(tile_size);
+    header.levels = static_cast<std::uint32_t>(levels.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(levels.data()),
+              static_cast<std::streamsize>(levels.size() * sizeof(texture_file_level)));
+
+    std::vector<std::uint8_t> encoded, tile(tile_bytes);
+    for (size_t level = 0; level < levels.size(); ++level) {
+        if (level > 0) image = downsample(image);
+        const texture_file_level& l = levels[level];
+        encoded.resize(image.rgb.size());
+        tonemap_to_u8(image.rgb.data(), encoded.data(), image.rgb.size(), 1.0f);
+
+        static const char zeros[4096] = {};
+        out.write(zeros, static_cast<std::streamsize>(l.offset - static_cast<std::uint64_t>(out.tellp())));
+        for (std::uint32_t ty = 0; ty < l.tiles_y; ++ty) {
+            for (std::uint32_t tx = 0; tx < l.tiles_x; ++tx) {
+                // Os texels fora da imagem repetem a última linha ou coluna
+                for (int y = 0; y < tile_size; ++y) {
+                    const int sy = std::min(static_cast<int>(ty) * tile_size + y, image.height - 1);
+                    for (int x = 0; x < tile_size; ++x) {
+                        const int sx = std::min(static_cast<int>(tx) * tile_size + x, image.width - 1);
+                        std::memcpy(&tile[(static_cast<size_t>(y) * tile_size + x) * 3],
+                                    &encoded[(static_cast<size_t>(sy) * image.width + sx) * 3], 3);
+                    }
+                }
+                out.write(reinterpret_cast<const char*>(tile.data()), static_cast<std::streamsize>(tile.size()));
+            }
+        }
+    }
+    if (!out.flush()) {
+        std::cerr << "Não foi possível gravar " << output_path << '\n';
+        return 1;
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << output_path << ": " << header.width << "x" << header.height << ", " << levels.size()
+              << " níveis em tiles de " << tile_size << "x" << tile_size << ", " << offset / 1e6
+              << " MB, em " << elapsed.count() << " s\n";
+    return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Arquivo inteiro mapeado em memória, somente leitura. Em sistemas POSIX usa mmap, e
+// as páginas só são lidas do disco quando acessadas; nos outros o arquivo é lido para
+// um buffer. Os dados ficam válidos enquanto o objeto existir, inclusive depois de
+// movido.
+class mapped_file {
+public:
+    mapped_file() {}
+    ~mapped_file() { close(); }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept { *this = std::move(other); }
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            close();
+            storage = std::move(other.storage);
+            bytes = other.bytes;
+            length = other.length;
+            mapped = other.mapped;
+            other.bytes = nullptr;
+            other.length = 0;
+            other.mapped = false;
+        }
+        return *this;
+    }
+
+    // Abre o arquivo; retorna false se ele não existir ou não puder ser lido
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return bytes; }
+    std::uint64_t size() const { return length; }
+
+private:
+    std::vector<char> storage;   // Cópia do arquivo quando não há mmap
+    const char* bytes = nullptr;
+    std::uint64_t length = 0;
+    bool mapped = false;
+};
+
+
+inline bool mapped_file::open(const std::string& path) {
+    close();
+
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<std::uint64_t>(st.st_size);
+    if (length == 0) {  // mmap não aceita tamanho zero
+        ::close(fd);
+        return true;
+    }
+    void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    bytes = static_cast<const char*>(p);
+    mapped = true;
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    length = static_cast<std::uint64_t>(in.tellg());
+    storage.resize(length);
+    in.seekg(0);
+    in.read(storage.data(), static_cast<std::streamsize>(length));
+    if (!in) {
+        close();
+        return false;
+    }
+    bytes = storage.data();
+    return true;
+#endif
+}
+
+inline void mapped_file::close() {
+#ifdef MAPPED_FILE_MMAP
+    if (mapped) ::munmap(const_cast<char*>(bytes), length);
+#endif
+    storage.clear();
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+}
+
+#endif
@@ -3,55 +3,83 @@
 
 #include "rtweekend.h"
 
-// Declaração antecipada da estrutura hit_record
-struct hit_record;
+#include "texture.h"
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Classes de material conhecidas, usadas para agrupar raios que vão executar o mesmo
+// código de dispersão (ver wavefront.h). Materiais novos podem usar 'other'; os que
+// emitem luz devem usar 'diffuse_light', que o integrador consulta antes de emitted().
+enum class material_kind { lambertian, metal, dielectric, diffuse_light, other };
+constexpr int material_kind_count = 5;
 
 // Classe abstrata para materiais
 class material {
 public:
+    virtual ~material() = default;
+
+    // Classe do material
+    virtual material_kind kind() const { return material_kind::other; }
+
     // Função virtual pura para calcular a dispersão dos raios
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
     ) const = 0;
+
+    // Radiância emitida no ponto atingido; zero para materiais que não são luzes
+    virtual color emitted(const hit_record& rec) const { return color(0,0,0); }
 };
 
 // Classe para materiais lambertianos (difusos)
-class lambertian : public material {
+class lambertian final : public material {
 public:
     color albedo; // Albedo do material
+    shared_ptr<const texture> tex;  // Se houver, dá o albedo de cada ponto no lugar de 'albedo'
 
     // Construtor que recebe o albedo como parâmetro
     lambertian(const color& a) : albedo(a) {}
+    lambertian(shared_ptr<const texture> t) : albedo(0, 0, 0), tex(std::move(t)) {}
+
+    virtual material_kind kind() const override { return material_kind::lambertian; }
 
     // Implementação da função de dispersão para materiais lambertianos
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
     ) const override {
         // Calcula uma direção aleatória para dispersão
-        auto scatter_direction = rec.normal + random_unit_vector();
+        auto scatter_direction = rec.normal + sample_unit_vector();
 
         // Verifica se a direção de dispersão é degenerada (perto de zero)
         // Caso seja degenerada, usa a normal como direção de dispersão
         if (scatter_direction.near_zero())
             scatter_direction = rec.normal;
 
-        // Define o raio dispersado com a nova direção e o ponto de origem
-        scattered = ray(rec.p, scatter_direction);
+        // Define o raio dispersado com a nova direção e o ponto de origem, no mesmo
+        // instante do raio de entrada (as esferas em movimento dependem disso)
+        scattered = ray(rec.spawn_origin(scatter_direction), scatter_direction, r_in.time());
         // Define a atenuação como o albedo do material
-        attenuation = albedo;
+        attenuation = tex ? tex->value(r_in, rec) : albedo;
 
         return true; // Sempre retorna true, indicando que houve dispersão
     }
 };
 
 // Classe para materiais metálicos
-class metal : public material {
+class metal final : public material {
 public:
     color albedo; // Albedo do material
     double fuzz;  // Fuzziness do material
+    shared_ptr<const texture> tex;  // Se houver, dá o albedo de cada ponto no lugar de 'albedo'
 
     // Construtor que recebe o albedo e a fuzziness como parâmetros
     metal(const color& a, double f) : albedo(a), fuzz(f < 1 ? f : 1) {}
+    metal(shared_ptr<const texture> t, double f) : albedo(0, 0, 0), fuzz(f < 1 ? f : 1), tex(std::move(t)) {}
+
+    virtual material_kind kind() const override { return material_kind::metal; }
 
     // Implementação da função de dispersão para materiais metálicos
     virtual bool scatter(
@@ -61,9 +89,11 @@ public:
         vec3 reflected = reflect(unit_vector(r_in.direction()), rec.normal);
 
         // Define o raio dispersado com a reflexão e um deslocamento aleatório
-        scattered = ray(rec.p, reflected + fuzz * random_in_unit_sphere());
+        vec3 direction = reflected + fuzz * sample_in_unit_sphere();
+        scattered = ray(rec.spawn_origin(direction), direction, r_in.time());
+
         // Define a atenuação como o albedo do material
-        attenuation = albedo;
+        attenuation = tex ? tex->value(r_in, rec) : albedo;
 
         // Verifica se o raio dispersado está na mesma direção da normal da superfície
         // Se estiver, significa que o raio foi refletido e retorna true
@@ -73,34 +103,36 @@ public:
 };
 
 // Classe para materiais dielétricos (vidros)
-class dielectric : public material {
+class dielectric final : public material {
 public:
     double ir; // Índice de refração do material
 
     // Construtor que recebe o índice de refração como parâmetro
     dielectric(double index_of_refraction) : ir(index_of_refraction) {}
 
+    virtual material_kind kind() const override { return material_kind::dielectric; }
+
     // Implementação da função de dispersão para materiais dielétricos
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
     ) const override {
         attenuation = color(1.0, 1.0, 1.0);
-        double refraction_ratio = rec.front_face ? (1.0 / ir) : ir;
+        real refraction_ratio = rec.front_face ? (1.0 / ir) : ir;
 
         vec3 unit_direction = unit_vector(r_in.direction());
-        double cos_theta = fmin(dot(-unit_direction, rec.normal), 1.0);
-        double sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+        real cos_theta = fmin(dot(-unit_direction, rec.normal), real(1));
+        real sin_theta = sqrt(real(1) - cos_theta * cos_theta);
 
         bool cannot_refract = refraction_ratio * sin_theta > 1.0;
         vec3 direction;
 
-        if (cannot_refract || reflectance(cos_theta, refraction_ratio) > random_double())
+        if (cannot_refract || reflectance(cos_theta, refraction_ratio) > sample_1d())
             direction = reflect(unit_direction, rec.normal);
         else
             direction = refract(unit_direction, rec.normal, refraction_ratio);
 
         // Define o raio dispersado com a direção calculada
-        scattered = ray(rec.p, direction);
+        scattered = ray(rec.spawn_origin(direction), direction, r_in.time());
         return true; // Sempre retorna true, indicando que houve dispersão
     }
 
@@ -113,4 +145,109 @@ private:
     }
 };
 
+// Luz difusa: emite 'emit' igualmente em todas as direções, dos dois lados da
+// superfície, e não espalha os raios que chegam. O caminho termina na luz.
+class diffuse_light final : public material {
+public:
+    color emit; // Radiância emitida
+
+    diffuse_light(const color& c) : emit(c) {}
+
+    virtual material_kind kind() const override { return material_kind::diffuse_light; }
+
+    // A luz não tem albedo; a atenuação 1 deixa a cor como está quando o denoiser
+    // divide a imagem pelo albedo do primeiro ponto
+    virtual bool scatter(
+        const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
+    ) const override {
+        attenuation = color(1.0, 1.0, 1.0);
+        return false;
+    }
+
+    virtual color emitted(const hit_record& rec) const override { return emit; }
+};
+
+// Arena de materiais da cena. Os objetos guardam só o índice de 32 bits do seu material
+// e o registro de interseção carrega esse índice, então copiar um hit_record não mexe
+// em contadores de referência. A arena é dona dos materiais e os índices valem enquanto
+// ela existir.
+//
+// Os materiais deste arquivo ficam guardados por valor em um std::variant e scatter()
+// e kind() os chamam sem passar pela vtable, o que deixa o compilador expandir o código
+// de dispersão dentro do integrador. Materiais definidos fora daqui entram como ponteiro
+// e continuam usando a interface virtual.
+using material_variant = std::variant<lambertian, metal, dielectric, diffuse_light, std::unique_ptr<material>>;
+
+class material_arena {
+public:
+    // Cria um material na arena e retorna o seu índice
+    template <typename T, typename... Args>
+    std::uint32_t make(Args&&... args) {
+        if constexpr (std::is_same<T, lambertian>::value || std::is_same<T, metal>::value
+                      || std::is_same<T, dielectric>::value || std::is_same<T, diffuse_light>::value)
+            items.emplace_back(std::in_place_type<T>, std::forward<Args>(args)...);
+        else
+            items.emplace_back(std::make_unique<T>(std::forward<Args>(args)...));
+        return static_cast<std::uint32_t>(items.size() - 1);
+    }
+
+    std::uint32_t add(std::unique_ptr<material> m) {
+        items.emplace_back(std::move(m));
+        return static_cast<std::uint32_t>(items.size() - 1);
+    }
+
+    // Acesso pela interface virtual, válido para qualquer material
+    const material& operator[](std::uint32_t id) const {
+        const material_variant& m = items[id];
+        switch (m.index()) {
+            case 0:  return *std::get_if<0>(&m);
+            case 1:  return *std::get_if<1>(&m);
+            case 2:  return *std::get_if<2>(&m);
+            case 3:  return *std::get_if<3>(&m);
+            default: return **std::get_if<4>(&m);
+        }
+    }
+
+    // Despacho estático: mesmo resultado de (*this)[id].scatter(...)
+    bool scatter(std::uint32_t id, const ray& r_in, const hit_record& rec,
+                 color& attenuation, ray& scattered) const {
+        const material_variant& m = items[id];
+        switch (m.index()) {
+            case 0:  return std::get_if<0>(&m)->scatter(r_in, rec, attenuation, scattered);
+            case 1:  return std::get_if<1>(&m)->scatter(r_in, rec, attenuation, scattered);
+            case 2:  return std::get_if<2>(&m)->scatter(r_in, rec, attenuation, scattered);
+            case 3:  return std::get_if<3>(&m)->scatter(r_in, rec, attenuation, scattered);
+            default: return (*std::get_if<4>(&m))->scatter(r_in, rec, attenuation, scattered);
+        }
+    }
+
+    // Despacho estático: mesmo resultado de (*this)[id].emitted(rec)
+    color emitted(std::uint32_t id, const hit_record& rec) const {
+        const material_variant& m = items[id];
+        switch (m.index()) {
+            case 0:
+            case 1:
+            case 2:  return color(0,0,0);
+            case 3:  return std::get_if<3>(&m)->emitted(rec);
+            default: return (*std::get_if<4>(&m))->emitted(rec);
+        }
+    }
+
+    material_kind kind(std::uint32_t id) const {
+        const material_variant& m = items[id];
+        switch (m.index()) {
+            case 0:  return material_kind::lambertian;
+            case 1:  return material_kind::metal;
+            case 2:  return material_kind::dielectric;
+            case 3:  return material_kind::diffuse_light;
+            default: return (*std::get_if<4>(&m))->kind();
+        }
+    }
+
+    size_t size() const { return items.size(); }
+
+private:
+    std::vector<material_variant> items;
+};
+
 #endif
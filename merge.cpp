@@ -0,0 +1,67 @@
+// Junta os arquivos parciais de uma renderização distribuída (ver partial.h) na imagem
+// final. Com as partes divididas por tiles, ela é idêntica à de uma renderização em um
+// único processo; divididas por amostras, pode diferir no arredondamento da soma.
+//
+//     g++ -O2 -std=c++17 merge.cpp -o output/merge
+//     ./output/merge --job-dir trabalhos --output imagem.png
+//     ./output/merge parte0.rtp parte1.rtp parte2.rtp --output imagem.ppm
+
+#include "rtweekend.h"
+
+#include "image_io.h"
+#include "partial.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::string output_path = "./output/image.ppm";
+    std::vector<std::string> paths;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        if (arg == "--output" && has_value) output_path = argv[++a];
+        else if (arg == "--job-dir" && has_value) {
+            // Todos os part-*.rtp do diretório de trabalhos
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(argv[++a], ec)) {
+                const std::string name = entry.path().filename().string();
+                if (name.rfind("part-", 0) == 0 && entry.path().extension() == ".rtp")
+                    paths.push_back(entry.path().string());
+            }
+            if (ec) {
+                std::cerr << "Não foi possível ler o diretório " << argv[a] << '\n';
+                return 1;
+            }
+        }
+        else if (arg.rfind("--", 0) != 0) paths.push_back(arg);
+        else {
+            std::cerr << "Uso: " << argv[0]
+                      << " [--output arquivo.ppm|.pfm|.png] [--job-dir dir] [parcial.rtp ...]\n";
+            return 1;
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    auto start = std::chrono::steady_clock::now();
+    framebuffer fb;
+    int samples_per_pixel = 0;
+    std::string error;
+    if (!merge_partials(paths, fb, samples_per_pixel, error)) {
+        std::cerr << "Erro ao juntar: " << error << '\n';
+        return 1;
+    }
+    if (!write_image(output_path, fb, 1.0 / samples_per_pixel)) {
+        std::cerr << "Não foi possível gravar " << output_path << '\n';
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << paths.size() << " parciais juntados em " << output_path << " ("
+              << elapsed.count() * 1000 << " ms)\n";
+    return 0;
+}
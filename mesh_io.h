@@ -0,0 +1,550 @@
+#ifndef MESH_IO_H
+#define MESH_IO_H
+
+#include "rtweekend.h"
+
+#include "mapped_file.h"
+#include "triangle_mesh.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Leitores de malhas. O arquivo é mapeado (mapped_file) e dividido em faixas que
+// threads diferentes convertem ao mesmo tempo, escrevendo direto nos buffers finais
+// de mesh_data:
+//  - OBJ: só as linhas 'v' e 'f' contam; polígonos viram leques de triângulos e índices
+//    negativos são relativos ao último vértice lido. Uma primeira passada conta os
+//    vértices de cada faixa, para que a segunda saiba de onde partem os seus índices;
+//  - PLY binário (little ou big endian): os vértices têm tamanho fixo e são divididos
+//    entre as threads; as faces também, quando todas são triângulos (o caso comum),
+//    o que é conferido antes. Senão as faces são lidas em sequência.
+// Os índices são conferidos contra o número de vértices, então a malha resultante pode
+// ir direto para triangle_mesh.
+
+// Executa f(0) ... f(n - 1) em n threads (a última na thread atual)
+template <typename F>
+void run_parallel(int n, F f) {
+    std::vector<std::thread> workers;
+    workers.reserve(n > 0 ? n - 1 : 0);
+    for (int k = 0; k + 1 < n; ++k)
+        workers.emplace_back(f, k);
+    if (n > 0) f(n - 1);
+    for (auto& w : workers) w.join();
+}
+
+// Threads para um arquivo de 'size' bytes: uma por núcleo, mas nenhuma com menos de 1 MB
+inline int loader_threads(std::uint64_t size, int threads) {
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    const std::uint64_t by_size = size / (1 << 20) + 1;
+    return static_cast<int>(std::min<std::uint64_t>(threads, by_size));
+}
+
+// Formato OBJ -------------------------------------------------------------------------
+
+struct obj_chunk {
+    const char* begin;
+    const char* end;
+    size_t first_line = 0;       // Número da primeira linha da faixa menos um
+    size_t lines = 0;
+    size_t vertex_base = 0;      // Vértices das faixas anteriores
+    size_t vertices = 0;
+    std::vector<std::uint32_t> indices;
+    std::string error;
+};
+
+inline bool load_obj(const char* data, std::uint64_t size, mesh_data& mesh, std::string& error,
+                     int threads = 0) {
+    const int n = loader_threads(size, threads);
+    const char* end = data + size;
+
+    // Faixas com fronteiras no início de uma linha
+    std::vector<obj_chunk> chunks(n);
+    const char* p = data;
+    for (int k = 0; k < n; ++k) {
+        const char* q = k + 1 == n ? end : std::max(p, data + size * (k + 1) / n);
+        if (q < end) {
+            const char* nl = static_cast<const char*>(std::memchr(q, '\n', end - q));
+            q = nl ? nl + 1 : end;
+        }
+        chunks[k].begin = p;
+        chunks[k].end = q;
+        p = q;
+    }
+
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+    // Primeira passada: linhas e vértices de cada faixa
+    run_parallel(n, [&](int k) {
+        obj_chunk& c = chunks[k];
+        for (const char* q = c.begin; q < c.end; ) {
+            const char* nl = static_cast<const char*>(std::memchr(q, '\n', c.end - q));
+            const char* line_end = nl ? nl : c.end;
+            while (q < line_end && is_space(*q)) ++q;
+            if (line_end - q >= 2 && q[0] == 'v' && is_space(q[1])) ++c.vertices;
+            ++c.lines;
+            q = line_end + 1;
+        }
+    });
+
+    size_t vertex_count = 0, line_count = 0;
+    for (auto& c : chunks) {
+        c.vertex_base = vertex_count;
+        c.first_line = line_count;
+        vertex_count += c.vertices;
+        line_count += c.lines;
+    }
+    if (vertex_count > 0x7fffffff / 3) {
+        error = "vértices demais";
+        return false;
+    }
+    mesh.positions.assign(3 * vertex_count, 0);
+
+    // Segunda passada: as coordenadas vão direto para a posição final; os triângulos
+    // ficam em cada faixa até todas terminarem
+    run_parallel(n, [&](int k) {
+        obj_chunk& c = chunks[k];
+        real* out = mesh.positions.data() + 3 * c.vertex_base;
+        size_t seen = c.vertex_base;   // Vértices lidos até aqui no arquivo
+        size_t line = c.first_line;
+        std::uint32_t polygon[64];
+
+        auto fail = [&](const char* message) {
+            c.error = "linha " + std::to_string(line) + ": " + message;
+        };
+
+        for (const char* q = c.begin; q < c.end; ) {
+            ++line;
+            const char* nl = static_cast<const char*>(std::memchr(q, '\n', c.end - q));
+            const char* line_end = nl ? nl : c.end;
+            const char* next = line_end + 1;
+            while (q < line_end && is_space(*q)) ++q;
+            if (line_end - q < 2 || !is_space(q[1]) || (q[0] != 'v' && q[0] != 'f')) {
+                q = next;
+                continue;
+            }
+            const bool vertex = q[0] == 'v';
+            q += 2;
+
+            int fields = 0;
+            while (q < line_end) {
+                while (q < line_end && is_space(*q)) ++q;
+                if (q == line_end || *q == '#') break;
+                const char* start = q;
+                while (q < line_end && !is_space(*q)) ++q;
+
+                if (vertex) {
+                    if (fields < 3) {  // Um 'w' opcional é ignorado
+                        double value;
+                        const char* first = *start == '+' ? start + 1 : start;
+                        auto result = std::from_chars(first, q, value);
+                        if (result.ec != std::errc() || result.ptr != q) return fail("coordenada inválida");
+                        out[fields] = static_cast<real>(value);
+                    }
+                } else {
+                    // 'v', 'v/vt', 'v//vn' ou 'v/vt/vn': só o índice do vértice interessa
+                    long long value;
+                    const char* first = *start == '+' ? start + 1 : start;
+                    auto result = std::from_chars(first, q, value);
+                    if (result.ec != std::errc() || (result.ptr != q && *result.ptr != '/'))
+                        return fail("índice de vértice inválido");
+                    const long long index = value < 0 ? static_cast<long long>(seen) + value : value - 1;
+                    if (value == 0 || index < 0 || index >= static_cast<long long>(vertex_count))
+                        return fail("índice de vértice fora da malha");
+                    if (fields == 64) return fail("polígono com vértices demais");
+                    polygon[fields] = static_cast<std::uint32_t>(index);
+                }
+                ++fields;
+            }
+
+            if (vertex) {
+                if (fields < 3) return fail("esperado 'v x y z'");
+                out += 3;
+                ++seen;
+            } else {
+                if (fields < 3) return fail("face com menos de três vértices");
+                for (int j = 1; j + 1 < fields; ++j) {
+                    c.indices.push_back(polygon[0]);
+                    c.indices.push_back(polygon[j]);
+                    c.indices.push_back(polygon[j + 1]);
+                }
+            }
+            q = next;
+        }
+    });
+
+    size_t index_count = 0;
+    for (const auto& c : chunks) {
+        if (!c.error.empty()) {
+            error = c.error;
+            mesh = mesh_data();
+            return false;
+        }
+        index_count += c.indices.size();
+    }
+    if (index_count / 3 > 0x7fffffff / 3) {
+        error = "triângulos demais";
+        mesh = mesh_data();
+        return false;
+    }
+    mesh.indices.resize(index_count);
+    std::vector<size_t> offsets(n, 0);
+    for (int k = 1; k < n; ++k) offsets[k] = offsets[k - 1] + chunks[k - 1].indices.size();
+    run_parallel(n, [&](int k) {
+        std::copy(chunks[k].indices.begin(), chunks[k].indices.end(), mesh.indices.begin() + offsets[k]);
+    });
+    return true;
+}
+
+// Formato PLY -------------------------------------------------------------------------
+
+enum class ply_type { none, int8, uint8, int16, uint16, int32, uint32, float32, float64 };
+
+inline ply_type parse_ply_type(std::string_view name) {
+    if (name == "char" || name == "int8") return ply_type::int8;
+    if (name == "uchar" || name == "uint8") return ply_type::uint8;
+    if (name == "short" || name == "int16") return ply_type::int16;
+    if (name == "ushort" || name == "uint16") return ply_type::uint16;
+    if (name == "int" || name == "int32") return ply_type::int32;
+    if (name == "uint" || name == "uint32") return ply_type::uint32;
+    if (name == "float" || name == "float32") return ply_type::float32;
+    if (name == "double" || name == "float64") return ply_type::float64;
+    return ply_type::none;
+}
+
+inline int ply_type_size(ply_type type) {
+    switch (type) {
+        case ply_type::int8: case ply_type::uint8:     return 1;
+        case ply_type::int16: case ply_type::uint16:   return 2;
+        case ply_type::int32: case ply_type::uint32:
+        case ply_type::float32:                        return 4;
+        case ply_type::float64:                        return 8;
+        default:                                       return 0;
+    }
+}
+
+// Valor de um escalar do arquivo, trocando a ordem dos bytes se preciso
+inline double read_ply_value(const char* p, ply_type type, bool swap) {
+    unsigned char bytes[8];
+    const int size = ply_type_size(type);
+    for (int k = 0; k < size; ++k) bytes[k] = static_cast<unsigned char>(p[swap ? size - 1 - k : k]);
+    switch (type) {
+        case ply_type::int8:    { std::int8_t v;   std::memcpy(&v, bytes, 1); return v; }
+        case ply_type::uint8:   { std::uint8_t v;  std::memcpy(&v, bytes, 1); return v; }
+        case ply_type::int16:   { std::int16_t v;  std::memcpy(&v, bytes, 2); return v; }
+        case ply_type::uint16:  { std::uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+        case ply_type::int32:   { std::int32_t v;  std::memcpy(&v, bytes, 4); return v; }
+        case ply_type::uint32:  { std::uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+        case ply_type::float32: { float v;         std::memcpy(&v, bytes, 4); return v; }
+        default:                { double v;        std::memcpy(&v, bytes, 8); return v; }
+    }
+}
+
+struct ply_property {
+    std::string name;
+    ply_type type = ply_type::none;        // Tipo do escalar, ou dos itens de uma lista
+    ply_type count_type = ply_type::none;  // Tipo do tamanho, se for uma lista
+};
+
+struct ply_element {
+    std::string name;
+    std::uint64_t count = 0;
+    std::vector<ply_property> properties;
+
+    // Bytes de um registro, ou 0 se algum campo for uma lista
+    int record_size() const {
+        int size = 0;
+        for (const auto& p : properties) {
+            if (p.count_type != ply_type::none) return 0;
+            size += ply_type_size(p.type);
+        }
+        return size;
+    }
+};
+
+inline bool load_ply(const char* data, std::uint64_t size, mesh_data& mesh, std::string& error,
+                     int threads = 0) {
+    const char* end = data + size;
+    const char* p = data;
+    std::vector<ply_element> elements;
+    bool big_endian = false;
+    bool format_seen = false;
+
+    // Cabeçalho em texto, até 'end_header'
+    for (bool first = true;; first = false) {
+        if (p >= end) {
+            error = "cabeçalho PLY sem 'end_header'";
+            return false;
+        }
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* line_end = nl ? nl : end;
+        std::string_view line(p, line_end - p);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        p = nl ? nl + 1 : end;
+
+        std::string_view words[8];
+        int n = 0;
+        for (size_t k = 0; k < line.size() && n < 8; ) {
+            while (k < line.size() && line[k] == ' ') ++k;
+            const size_t start = k;
+            while (k < line.size() && line[k] != ' ') ++k;
+            if (k > start) words[n++] = line.substr(start, k - start);
+        }
+
+        if (first) {
+            if (n != 1 || words[0] != "ply") {
+                error = "não é um arquivo PLY";
+                return false;
+            }
+        } else if (n == 0 || words[0] == "comment" || words[0] == "obj_info") {
+            continue;
+        } else if (words[0] == "end_header") {
+            break;
+        } else if (words[0] == "format" && n >= 2) {
+            if (words[1] == "binary_little_endian") big_endian = false;
+            else if (words[1] == "binary_big_endian") big_endian = true;
+            else {
+                error = "só o PLY binário é suportado (formato '" + std::string(words[1]) + "')";
+                return false;
+            }
+            format_seen = true;
+        } else if (words[0] == "element" && n == 3) {
+            ply_element e;
+            e.name = std::string(words[1]);
+            auto result = std::from_chars(words[2].data(), words[2].data() + words[2].size(), e.count);
+            if (result.ec != std::errc()) {
+                error = "contagem inválida no elemento '" + e.name + "'";
+                return false;
+            }
+            elements.push_back(e);
+        } else if (words[0] == "property" && !elements.empty()) {
+            ply_property prop;
+            if (n == 5 && words[1] == "list") {
+                prop.count_type = parse_ply_type(words[2]);
+                prop.type = parse_ply_type(words[3]);
+                prop.name = std::string(words[4]);
+            } else if (n == 3) {
+                prop.type = parse_ply_type(words[1]);
+                prop.name = std::string(words[2]);
+            }
+            if (prop.type == ply_type::none || (n == 5 && prop.count_type == ply_type::none)) {
+                error = "propriedade PLY inválida: " + std::string(line);
+                return false;
+            }
+            elements.back().properties.push_back(prop);
+        } else {
+            error = "linha de cabeçalho PLY não reconhecida: " + std::string(line);
+            return false;
+        }
+    }
+    if (!format_seen) {
+        error = "cabeçalho PLY sem 'format'";
+        return false;
+    }
+
+    const std::uint16_t one = 1;
+    const bool host_big_endian = *reinterpret_cast<const unsigned char*>(&one) == 0;
+    const bool swap = big_endian != host_big_endian;
+    const ply_element* vertex = nullptr;
+    const ply_element* face = nullptr;
+    const char* vertex_data = nullptr;
+    const char* face_data = nullptr;
+
+    // Localiza os dados de 'vertex' e 'face'; outros elementos antes deles precisam ter
+    // registros de tamanho fixo para serem pulados
+    for (const auto& e : elements) {
+        if (e.name == "vertex") {
+            vertex = &e;
+            vertex_data = p;
+        } else if (e.name == "face") {
+            face = &e;
+            face_data = p;
+        }
+        if (vertex && face) break;
+        const int record = e.record_size();
+        if (record == 0) {
+            if (&e == face) break;  // O tamanho das faces só se sabe lendo
+            error = "elemento '" + e.name + "' com listas antes dos vértices ou das faces";
+            return false;
+        }
+        if (e.count > static_cast<std::uint64_t>(end - p) / record) {
+            error = "arquivo PLY truncado";
+            return false;
+        }
+        p += e.count * record;
+    }
+    if (!vertex) {
+        error = "arquivo PLY sem o elemento 'vertex'";
+        return false;
+    }
+
+    // Vértices
+    const int vertex_record = vertex->record_size();
+    int coordinate_offset[3] = {-1, -1, -1};
+    ply_type coordinate_type[3] = {};
+    {
+        int offset = 0;
+        for (const auto& prop : vertex->properties) {
+            for (int a = 0; a < 3; ++a)
+                if (prop.name == std::string_view("xyz" + a, 1)) {
+                    coordinate_offset[a] = offset;
+                    coordinate_type[a] = prop.type;
+                }
+            offset += ply_type_size(prop.type);
+        }
+    }
+    if (vertex_record == 0 || coordinate_offset[0] < 0 || coordinate_offset[1] < 0 || coordinate_offset[2] < 0) {
+        error = "os vértices do PLY precisam de x, y e z escalares";
+        return false;
+    }
+    if (vertex->count > 0x7fffffff / 3
+        || vertex->count > static_cast<std::uint64_t>(end - vertex_data) / vertex_record) {
+        error = vertex->count > 0x7fffffff / 3 ? "vértices demais" : "arquivo PLY truncado";
+        return false;
+    }
+    const size_t vertex_count = static_cast<size_t>(vertex->count);
+    mesh.positions.assign(3 * vertex_count, 0);
+
+    const int n = loader_threads(vertex_count * vertex_record, threads);
+    run_parallel(n, [&](int k) {
+        const size_t first = vertex_count * k / n, last = vertex_count * (k + 1) / n;
+        for (size_t v = first; v < last; ++v) {
+            const char* record = vertex_data + v * vertex_record;
+            for (int a = 0; a < 3; ++a)
+                mesh.positions[3 * v + a] =
+                    static_cast<real>(read_ply_value(record + coordinate_offset[a], coordinate_type[a], swap));
+        }
+    });
+
+    mesh.indices.clear();
+    if (!face) return true;
+
+    // Faces: a lista de índices e, antes ou depois dela, escalares que são ignorados
+    int list = -1;
+    int before = 0, after = 0;
+    for (int k = 0; k < static_cast<int>(face->properties.size()); ++k) {
+        const ply_property& prop = face->properties[k];
+        if (prop.count_type != ply_type::none) {
+            if (list >= 0 || (prop.name != "vertex_indices" && prop.name != "vertex_index")) {
+                error = "as faces do PLY precisam de uma única lista 'vertex_indices'";
+                return false;
+            }
+            list = k;
+        } else if (list < 0) {
+            before += ply_type_size(prop.type);
+        } else {
+            after += ply_type_size(prop.type);
+        }
+    }
+    if (list < 0) {
+        error = "as faces do PLY precisam de uma lista 'vertex_indices'";
+        return false;
+    }
+    const ply_type count_type = face->properties[list].count_type;
+    const ply_type index_type = face->properties[list].type;
+    const int count_size = ply_type_size(count_type), index_size = ply_type_size(index_type);
+    const std::uint64_t face_count = face->count;
+    const std::uint64_t available = static_cast<std::uint64_t>(end - face_data);
+
+    auto index_at = [&](const char* q, std::uint32_t& index) {
+        const double value = read_ply_value(q, index_type, swap);
+        if (!(value >= 0 && value < static_cast<double>(vertex_count))) return false;
+        index = static_cast<std::uint32_t>(value);
+        return true;
+    };
+
+    // Caso comum: só triângulos, registros de tamanho fixo divididos entre as threads
+    const int triangle_record = before + count_size + 3 * index_size + after;
+    bool all_triangles = face_count <= 0x7fffffff / 3 && face_count <= available / triangle_record;
+    if (all_triangles) {
+        const int m = loader_threads(face_count * triangle_record, threads);
+        std::vector<char> ok(m, 1);
+        run_parallel(m, [&](int k) {
+            const std::uint64_t first = face_count * k / m, last = face_count * (k + 1) / m;
+            for (std::uint64_t f = first; f < last && ok[k]; ++f)
+                if (read_ply_value(face_data + f * triangle_record + before, count_type, swap) != 3) ok[k] = 0;
+        });
+        all_triangles = std::find(ok.begin(), ok.end(), 0) == ok.end();
+        if (all_triangles) {
+            mesh.indices.assign(3 * face_count, 0);
+            run_parallel(m, [&](int k) {
+                const std::uint64_t first = face_count * k / m, last = face_count * (k + 1) / m;
+                for (std::uint64_t f = first; f < last && ok[k]; ++f) {
+                    const char* q = face_data + f * triangle_record + before + count_size;
+                    for (int j = 0; j < 3; ++j)
+                        if (!index_at(q + j * index_size, mesh.indices[3 * f + j])) ok[k] = 0;
+                }
+            });
+            if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+                error = "índice de vértice fora da malha";
+                mesh = mesh_data();
+                return false;
+            }
+            return true;
+        }
+    }
+
+    // Polígonos quaisquer: leitura sequencial, em leques de triângulos
+    const char* q = face_data;
+    for (std::uint64_t f = 0; f < face_count; ++f) {
+        if (static_cast<std::uint64_t>(end - q) < static_cast<std::uint64_t>(before + count_size)) {
+            error = "arquivo PLY truncado";
+            mesh = mesh_data();
+            return false;
+        }
+        q += before;
+        const double count = read_ply_value(q, count_type, swap);
+        q += count_size;
+        if (!(count >= 3 && count <= 64)
+            || static_cast<std::uint64_t>(end - q) < static_cast<std::uint64_t>(count) * index_size + after) {
+            error = !(count >= 3 && count <= 64) ? "face com número de vértices inválido" : "arquivo PLY truncado";
+            mesh = mesh_data();
+            return false;
+        }
+        std::uint32_t polygon[64];
+        for (int j = 0; j < static_cast<int>(count); ++j) {
+            if (!index_at(q, polygon[j])) {
+                error = "índice de vértice fora da malha";
+                mesh = mesh_data();
+                return false;
+            }
+            q += index_size;
+        }
+        q += after;
+        for (int j = 1; j + 1 < static_cast<int>(count); ++j) {
+            mesh.indices.push_back(polygon[0]);
+            mesh.indices.push_back(polygon[j]);
+            mesh.indices.push_back(polygon[j + 1]);
+        }
+    }
+    if (mesh.triangle_count() > 0x7fffffff / 3) {
+        error = "triângulos demais";
+        mesh = mesh_data();
+        return false;
+    }
+    return true;
+}
+
+// Lê uma malha OBJ ou PLY binário, escolhido pelo conteúdo (arquivos PLY começam com
+// "ply"). 'threads' = 0 usa todos os núcleos.
+inline bool load_mesh(const std::string& path, mesh_data& mesh, std::string& error, int threads = 0) {
+    mapped_file file;
+    if (!file.open(path)) {
+        error = "não foi possível abrir " + path;
+        return false;
+    }
+    mesh = mesh_data();
+    const bool ply = file.size() >= 4 && std::memcmp(file.data(), "ply", 3) == 0
+                  && (file.data()[3] == '\n' || file.data()[3] == '\r');
+    const bool ok = ply ? load_ply(file.data(), file.size(), mesh, error, threads)
+                        : load_obj(file.data(), file.size(), mesh, error, threads);
+    if (!ok) error = path + ": " + error;
+    return ok;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef MOVING_SPHERE_H
+#define MOVING_SPHERE_H
+
+#include "rtweekend.h"
+
+#include "aabb.h"
+#include "hittable.h"
+#include "sphere.h"
+
+// Esfera em movimento linear: o centro vai de center0, no tempo time0, a center1, no
+// tempo time1, e cada raio a encontra na posição do seu próprio tempo (r.time()).
+// Fora do intervalo o movimento continua na mesma reta.
+class moving_sphere final : public hittable {
+public:
+    moving_sphere() {}
+
+    moving_sphere(point3 cen0, point3 cen1, double _time0, double _time1, real r, std::uint32_t m)
+        : center0(cen0), center1(cen1), time0(_time0), time1(_time1), radius(r), mat_id(m) {}
+
+    // Centro da esfera no instante 'time'
+    point3 center(double time) const {
+        if (time1 == time0) return center0;
+        return center0 + real((time - time0) / (time1 - time0)) * (center1 - center0);
+    }
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+
+    // Caixa que cobre todo o trajeto entre time0 e time1 do intervalo pedido
+    virtual bool bounding_box(double _time0, double _time1, aabb& output_box) const override;
+
+public:
+    point3 center0, center1;  // Centros nos tempos time0 e time1
+    double time0 = 0, time1 = 0;
+    real radius = 0;
+    std::uint32_t mat_id = 0;
+};
+
+
+inline bool moving_sphere::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    return hit_sphere(center(r.time()), radius, mat_id, r, t_min, t_max, rec);
+}
+
+inline bool moving_sphere::occluded(const ray& r, real t_min, real t_max) const {
+    return sphere_occludes(center(r.time()), radius, r, t_min, t_max);
+}
+
+// Como o movimento é linear, a união das caixas nos dois extremos cobre todas as
+// posições intermediárias.
+inline bool moving_sphere::bounding_box(double _time0, double _time1, aabb& output_box) const {
+    const vec3 extent(radius, radius, radius);
+    const point3 c0 = center(_time0), c1 = center(_time1);
+    output_box = surrounding_box(aabb(c0 - extent, c0 + extent), aabb(c1 - extent, c1 + extent));
+    return true;
+}
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef PARTIAL_H
+#define PARTIAL_H
+
+#include "rtweekend.h"
+
+#include "checkpoint.h"
+#include "framebuffer.h"
+#include "mapped_file.h"
+#include "renderer.h"
+#include "tile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Renderização distribuída: a imagem é dividida em 'count' partes, cada processo (em
+// qualquer máquina) renderiza algumas delas e grava um arquivo parcial com a soma das
+// amostras de cada pixel, e merge_partials junta os parciais na imagem final.
+//
+// A divisão pode ser por tiles (cada parte fica com um subconjunto dos tiles, com todas
+// as amostras) ou por amostras (cada parte fica com uma faixa [first, last) dos índices
+// de amostra de todos os pixels). O fluxo aleatório de cada amostra depende só de
+// (pixel, índice da amostra), então as partes usam fluxos disjuntos sem combinar nada
+// entre si. Dividida por tiles, cada pixel é somado inteiro por uma só parte, e a imagem
+// juntada é idêntica, byte a byte, à de um único processo. Dividida por amostras, as
+// somas das faixas (em 'real', a precisão de color) são somadas na ordem das faixas, e
+// como a soma em ponto flutuante não é associativa, o último bit de um pixel pode sair
+// diferente do da soma amostra a amostra: a imagem é a mesma a menos desse arredondamento,
+// não byte a byte.
+
+enum class split_mode : std::uint32_t { tiles = 0, samples = 1 };
+
+// Parte 'index' de 'count' de uma renderização
+struct render_job {
+    split_mode split = split_mode::tiles;
+    int index = 0;
+    int count = 1;
+
+    // Por tiles, a parte fica com os tiles (na ordem de Morton) de número t com
+    // t % count == index, o que espalha as regiões caras da imagem entre as partes.
+    bool owns_tile(int t) const {
+        return split == split_mode::samples || t % count == index;
+    }
+
+    int first_sample(int samples_per_pixel) const {
+        if (split == split_mode::tiles) return 0;
+        return static_cast<int>(static_cast<long long>(samples_per_pixel) * index / count);
+    }
+
+    int last_sample(int samples_per_pixel) const {
+        if (split == split_mode::tiles) return samples_per_pixel;
+        return static_cast<int>(static_cast<long long>(samples_per_pixel) * (index + 1) / count);
+    }
+};
+
+// Resultado de uma parte: soma das amostras [first_sample, last_sample) de cada pixel
+// coberto e quantas amostras foram somadas (zero nos pixels que a parte não cobre).
+struct partial_buffer {
+    int width = 0;
+    int height = 0;
+    int samples_per_pixel = 0;  // Amostras por pixel da imagem completa
+    int first_sample = 0;
+    int last_sample = 0;
+    render_job job;
+    std::uint64_t scene_hash = 0;
+    std::uint64_t render_hash = 0;
+    std::vector<double> sum;             // Soma R, G, B
+    std::vector<std::uint32_t> count;    // Amostras por pixel nesta parte
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        sum.assign(pixel_count() * 3, 0.0);
+        count.assign(pixel_count(), 0);
+    }
+
+    size_t pixel_count() const { return static_cast<size_t>(width) * height; }
+};
+
+// Formato do arquivo parcial (little-endian): cabeçalho fixo e as seções de soma e
+// contagem, cada uma começando em um deslocamento múltiplo de 64 bytes, como no checkpoint.
+struct partial_header {
+    char magic[8];                 // "RTPART01"
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t samples_per_pixel;
+    std::uint32_t split;           // split_mode
+    std::uint32_t job_index;
+    std::uint32_t job_count;
+    std::uint32_t first_sample;
+    std::uint32_t last_sample;
+    std::uint32_t reserved;
+    std::uint64_t scene_hash;
+    std::uint64_t render_hash;
+    std::uint64_t sum_offset;      // double[3*pixels]
+    std::uint64_t count_offset;    // uint32[pixels]
+    std::uint64_t file_size;
+};
+
+constexpr std::uint32_t partial_version = 1;
+
+inline void partial_layout(partial_header& header) {
+    const std::uint64_t pixels = static_cast<std::uint64_t>(header.width) * header.height;
+    header.sum_offset = align64(sizeof(partial_header));
+    header.count_offset = align64(header.sum_offset + pixels * 3 * sizeof(double));
+    header.file_size = header.count_offset + pixels * sizeof(std::uint32_t);
+}
+
+// Renderiza a parte 'job' da imagem. Cada pixel soma as suas amostras na mesma ordem
+// de render(), então uma parte que cobre todas as amostras de um pixel tem exatamente
+// a mesma soma. Como render(), roda no pool de settings.pool, se houver, e, cancelada
+// por settings.control, deixa com zero amostras os pixels dos tiles que não começaram.
+inline void render_partial(const hittable& world, const material_arena& materials, const camera& cam,
+                           const render_settings& settings, const render_job& job, partial_buffer& part) {
+    const int width = settings.image_width;
+    const int height = settings.image_height;
+    part.resize(width, height);
+    part.samples_per_pixel = settings.samples_per_pixel;
+    part.first_sample = job.first_sample(settings.samples_per_pixel);
+    part.last_sample = job.last_sample(settings.samples_per_pixel);
+    part.job = job;
+
+    auto tiles = make_tiles(width, height, settings.tile_size);
+    std::vector<int> mine;
+    std::uint64_t pixels = 0;
+    for (int t = 0; t < static_cast<int>(tiles.size()); ++t)
+        if (job.owns_tile(t)) {
+            mine.push_back(t);
+            pixels += tiles[t].pixel_count();
+        }
+
+    const int tile_count = static_cast<int>(mine.size());
+    const int samples = part.last_sample - part.first_sample;
+    std::atomic<int> tiles_done(0);
+    std::mutex progress_mutex;
+    render_control* control = settings.control;
+    if (control) control->begin(width, height, pixels * samples);
+
+    parallel_for(settings.pool, settings.priority, tile_count, settings.threads, [&](int k, int) {
+        const tile& tl = tiles[mine[k]];
+        if (control && control->cancelled()) return;
+        for (int j = tl.y0; j < tl.y1; ++j) {
+            for (int i = tl.x0; i < tl.x1; ++i) {
+                color pixel_color(0,0,0);
+                for (int s = part.first_sample; s < part.last_sample; ++s)
+                    pixel_color += trace_sample(world, materials, cam, settings, i, j, s);
+
+                const size_t pixel = static_cast<size_t>(j) * width + i;
+                part.sum[pixel * 3 + 0] = pixel_color.x();
+                part.sum[pixel * 3 + 1] = pixel_color.y();
+                part.sum[pixel * 3 + 2] = pixel_color.z();
+                part.count[pixel] = static_cast<std::uint32_t>(samples);
+            }
+        }
+        if (control) control->samples_finished(static_cast<std::uint64_t>(tl.pixel_count()) * samples);
+
+        int done = ++tiles_done;
+        if (settings.progress) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            std::cerr << "\rTiles restantes: " << tile_count - done << ' ' << std::flush;
+        }
+    });
+    if (control) control->pass_finished(1);
+}
+
+// Grava o parcial de forma atômica (ver replace_file), para que quem estiver juntando
+// as partes nunca leia um arquivo pela metade.
+inline bool save_partial(const std::string& path, const partial_buffer& part) {
+    const std::uint64_t pixels = part.pixel_count();
+
+    partial_header header{};
+    std::memcpy(header.magic, "RTPART01", 8);
+    header.version = partial_version;
+    header.width = static_cast<std::uint32_t>(part.width);
+    header.height = static_cast<std::uint32_t>(part.height);
+    header.samples_per_pixel = static_cast<std::uint32_t>(part.samples_per_pixel);
+    header.split = static_cast<std::uint32_t>(part.job.split);
+    header.job_index = static_cast<std::uint32_t>(part.job.index);
+    header.job_count = static_cast<std::uint32_t>(part.job.count);
+    header.first_sample = static_cast<std::uint32_t>(part.first_sample);
+    header.last_sample = static_cast<std::uint32_t>(part.last_sample);
+    header.scene_hash = part.scene_hash;
+    header.render_hash = part.render_hash;
+    partial_layout(header);
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        auto write_at = [&](std::uint64_t offset, const void* data, std::uint64_t n) {
+            static const char zeros[64] = {};
+            const auto pos = static_cast<std::uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(offset - pos));
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_at(header.sum_offset, part.sum.data(), pixels * 3 * sizeof(double));
+        write_at(header.count_offset, part.count.data(), pixels * sizeof(std::uint32_t));
+        out.flush();
+        if (!out) return false;
+    }
+    return replace_file(tmp, path);
+}
+
+// Mapeia um parcial e confere o cabeçalho. Os dados ficam em 'file'.
+inline bool open_partial(const std::string& path, mapped_file& file, partial_header& header) {
+    if (!file.open(path) || file.size() < sizeof(partial_header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    partial_header expected = header;
+    partial_layout(expected);
+    return std::memcmp(header.magic, "RTPART01", 8) == 0
+        && header.version == partial_version
+        && header.file_size == file.size()
+        && std::memcmp(&header, &expected, sizeof(header)) == 0
+        && header.first_sample <= header.last_sample
+        && header.last_sample <= header.samples_per_pixel;
+}
+
+// Junta os parciais no framebuffer (com a soma das amostras, como o de render(); grave
+// com escala 1/samples_per_pixel). Os parciais precisam ser da mesma cena, câmera e
+// resolução, e juntos devem cobrir cada pixel exatamente uma vez, com todas as
+// amostras. Eles são somados pela ordem das faixas de amostras e lidos um de cada vez,
+// então a memória usada não cresce com o número de partes.
+inline bool merge_partials(const std::vector<std::string>& paths, framebuffer& fb,
+                           int& samples_per_pixel, std::string& error) {
+    if (paths.empty()) {
+        error = "nenhum arquivo parcial";
+        return false;
+    }
+
+    std::vector<partial_header> headers(paths.size());
+    for (size_t k = 0; k < paths.size(); ++k) {
+        mapped_file file;
+        if (!open_partial(paths[k], file, headers[k])) {
+            error = paths[k] + ": parcial inválido ou truncado";
+            return false;
+        }
+        const auto& a = headers[0];
+        const auto& b = headers[k];
+        if (a.width != b.width || a.height != b.height || a.samples_per_pixel != b.samples_per_pixel
+            || a.scene_hash != b.scene_hash || a.render_hash != b.render_hash) {
+            error = paths[k] + ": parcial de outra cena, câmera ou resolução que " + paths[0];
+            return false;
+        }
+    }
+
+    std::vector<size_t> order(paths.size());
+    for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return headers[a].first_sample < headers[b].first_sample;
+    });
+
+    const int width = static_cast<int>(headers[0].width);
+    const int height = static_cast<int>(headers[0].height);
+    const size_t pixels = static_cast<size_t>(width) * height;
+    samples_per_pixel = static_cast<int>(headers[0].samples_per_pixel);
+
+    std::vector<double> sum(pixels * 3, 0.0);
+    std::vector<std::uint32_t> next(pixels, 0);  // Próxima amostra esperada de cada pixel
+    size_t overlapping = 0;
+
+    for (size_t k : order) {
+        mapped_file file;
+        partial_header header;
+        if (!open_partial(paths[k], file, header)) {
+            error = paths[k] + ": parcial mudou durante a junção";
+            return false;
+        }
+        const auto* part_sum = reinterpret_cast<const double*>(file.data() + header.sum_offset);
+        const auto* part_count = reinterpret_cast<const std::uint32_t*>(file.data() + header.count_offset);
+
+        for (size_t p = 0; p < pixels; ++p) {
+            if (part_count[p] == 0) continue;
+            if (next[p] != header.first_sample) {
+                overlapping++;
+                continue;
+            }
+            sum[p * 3 + 0] += part_sum[p * 3 + 0];
+            sum[p * 3 + 1] += part_sum[p * 3 + 1];
+            sum[p * 3 + 2] += part_sum[p * 3 + 2];
+            next[p] = header.first_sample + part_count[p];
+        }
+    }
+
+    size_t missing = 0;
+    for (size_t p = 0; p < pixels; ++p)
+        if (next[p] != static_cast<std::uint32_t>(samples_per_pixel)) missing++;
+    if (overlapping > 0 || missing > 0) {
+        error = std::to_string(missing) + " pixels sem todas as amostras e "
+              + std::to_string(overlapping) + " com amostras repetidas";
+        return false;
+    }
+
+    fb.resize(width, height);
+    for (size_t p = 0; p < pixels; ++p)
+        fb.set(p, color(sum[p * 3 + 0], sum[p * 3 + 1], sum[p * 3 + 2]));
+    return true;
+}
+
+// Diretório de trabalhos: vários processos, na mesma máquina ou em máquinas que
+// compartilham o diretório, renderizam as partes de uma mesma imagem. Cada processo
+// percorre as partes e reserva a próxima livre criando 'job-<k>.claim' com O_EXCL, que
+// só um processo consegue criar; ao terminar, grava 'part-<k>.rtp'. Uma parte
+// reservada por um processo que morreu fica presa até o seu .claim ser apagado.
+inline std::string job_claim_path(const std::string& dir, int index) {
+    return dir + "/job-" + std::to_string(index) + ".claim";
+}
+
+inline std::string job_partial_path(const std::string& dir, int index) {
+    return dir + "/part-" + std::to_string(index) + ".rtp";
+}
+
+inline bool claim_job(const std::string& dir, int index) {
+    const std::string path = job_claim_path(dir, index);
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd < 0) return false;
+    const std::string owner = std::to_string(::getpid()) + '\n';
+    auto written = ::write(fd, owner.data(), owner.size());  // O conteúdo é só informativo
+    (void)written;
+    ::close(fd);
+    return true;
+#else
+    // Sem O_EXCL portátil a reserva não é atômica; serve para um processo por vez.
+    if (std::ifstream(path)) return false;
+    return static_cast<bool>(std::ofstream(path));
+#endif
+}
+
+#endif
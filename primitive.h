@@ -0,0 +1,59 @@
+#ifndef PRIMITIVE_H
+#define PRIMITIVE_H
+
+#include "rtweekend.h"
+
+#include "hittable.h"
+#include "moving_sphere.h"
+#include "sphere.h"
+#include "sphere_set.h"
+
+#include <variant>
+
+// Primitivo guardado nas folhas da BVH. As esferas (fixas ou em movimento) ficam
+// copiadas por valor, junto das outras da mesma folha, e os conjuntos de esferas são
+// chamados diretamente; como essas classes são 'final', o compilador pode expandir o
+// teste de interseção dentro do laço da travessia. Qualquer outro hittable entra pelo
+// ponteiro e usa a interface virtual, assim como todos os objetos no modo
+// dispatch_mode::virtual_calls. As cópias precisam ser refeitas quando o objeto
+// original muda (ver bvh::refit).
+//
+// Os objetos continuam com posse por shared_ptr em hittable_list, que é por onde
+// malhas, instâncias e animação montam a cena, mas a travessia não toca nesses
+// ponteiros: o vetor de folhas da BVH faz o papel do pool de primitivos, com as esferas
+// contíguas por valor e endereçadas pela posição, e nenhum contador de referência muda
+// durante hit ou occluded.
+using primitive = std::variant<sphere, moving_sphere, const sphere_set*, const hittable*>;
+
+inline primitive make_primitive(const hittable* object, dispatch_mode mode) {
+    if (mode == dispatch_mode::static_variant) {
+        if (auto s = dynamic_cast<const sphere*>(object))
+            return primitive(std::in_place_index<0>, *s);
+        if (auto m = dynamic_cast<const moving_sphere*>(object))
+            return primitive(std::in_place_index<1>, *m);
+        if (auto set = dynamic_cast<const sphere_set*>(object))
+            return primitive(std::in_place_index<2>, set);
+    }
+    return primitive(std::in_place_index<3>, object);
+}
+
+inline bool hit_primitive(const primitive& p, const ray& r, real t_min, real t_max,
+                          hit_record& rec) {
+    switch (p.index()) {
+        case 0:  return std::get_if<0>(&p)->hit(r, t_min, t_max, rec);
+        case 1:  return std::get_if<1>(&p)->hit(r, t_min, t_max, rec);
+        case 2:  return (*std::get_if<2>(&p))->hit(r, t_min, t_max, rec);
+        default: return (*std::get_if<3>(&p))->hit(r, t_min, t_max, rec);
+    }
+}
+
+inline bool occluded_primitive(const primitive& p, const ray& r, real t_min, real t_max) {
+    switch (p.index()) {
+        case 0:  return std::get_if<0>(&p)->occluded(r, t_min, t_max);
+        case 1:  return std::get_if<1>(&p)->occluded(r, t_min, t_max);
+        case 2:  return (*std::get_if<2>(&p))->occluded(r, t_min, t_max);
+        default: return (*std::get_if<3>(&p))->occluded(r, t_min, t_max);
+    }
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef RANDOM_SCENE_H
+#define RANDOM_SCENE_H
+
+#include "rtweekend.h"
+
+#include "scene.h"
+
+// Cena aleatória do livro: o chão, uma bolinha de material sorteado em cada célula da
+// grade [grid_min, grid_max) x [grid_min, grid_max) e as três esferas grandes. A grade
+// padrão gera a cena original; grades maiores servem para testar a cena em escala.
+// Os sorteios usam thread_rng(), então a cena depende do estado do gerador na chamada.
+inline scene_data make_random_scene(int grid_min = -2, int grid_max = 8) {
+    scene_data scene;
+    const size_t cells = static_cast<size_t>(grid_max - grid_min) * (grid_max - grid_min);
+    scene.reserve(cells + 4, cells + 4);
+
+    auto ground_material = scene.add_lambertian(color(0.5, 0.5, 0.5));
+    scene.add_sphere(point3(0,-1000,0), 1000, ground_material);
+
+    for (int a = grid_min; a < grid_max; a+=1) {
+        for (int b = grid_min; b < grid_max; b+=1) {
+            auto choose_mat = random_double();
+            point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
+
+            if ((center - point3(4, 0.2, 0)).length() > 0.9) {
+                std::uint32_t sphere_material;
+
+                if (choose_mat < 0.8) {
+                    // Material difuso
+                    auto albedo = color::random() * color::random();
+                    sphere_material = scene.add_lambertian(albedo);
+                } else if (choose_mat < 0.95) {
+                    // Material metálico
+                    auto albedo = color::random(0.5, 1);
+                    auto fuzz = random_double(0, 0.5);
+                    sphere_material = scene.add_metal(albedo, fuzz);
+                } else {
+                    // Material de vidro
+                    sphere_material = scene.add_dielectric(1.5);
+                }
+                scene.add_sphere(center, 0.2, sphere_material);
+            }
+        }
+    }
+
+    auto material1 = scene.add_dielectric(1.5);
+    scene.add_sphere(point3(0, 1, 0), 1.0, material1);
+
+    auto material2 = scene.add_lambertian(color(0.4, 0.2, 0.1));
+    scene.add_sphere(point3(-4, 1, 0), 1.0, material2);
+
+    auto material3 = scene.add_metal(color(0.7, 0.6, 0.5), 0.0);
+    scene.add_sphere(point3(4, 1, 0), 1.0, material3);
+
+    return scene;
+}
+
+// Sala fechada no estilo da caixa de Cornell, com as paredes feitas de esferas enormes
+// (como no smallpt): parede esquerda vermelha, direita verde, as outras brancas e a de
+// trás da câmera preta. A única luz é uma esfera pequena perto do teto, então nenhum
+// caminho escapa para o céu e toda a iluminação depende de encontrar a lâmpada.
+inline scene_data make_room_scene() {
+    scene_data scene;
+    constexpr double wall = 1e4;  // Raio das esferas das paredes
+
+    const auto white = scene.add_lambertian(color(0.75, 0.75, 0.75));
+    const auto red = scene.add_lambertian(color(0.75, 0.25, 0.25));
+    const auto green = scene.add_lambertian(color(0.25, 0.75, 0.25));
+    const auto black = scene.add_lambertian(color(0, 0, 0));
+    const auto mirror = scene.add_metal(color(0.9, 0.9, 0.9), 0.0);
+    const auto glass = scene.add_dielectric(1.5);
+    const auto lamp = scene.add_light(color(60, 60, 60));
+
+    // A sala vai de -2.5 a 2.5 em x, de 0 a 5 em y e de -5 a 5 em z
+    scene.add_sphere(point3(-wall - 2.5, 2.5, 0), wall, red);
+    scene.add_sphere(point3(wall + 2.5, 2.5, 0), wall, green);
+    scene.add_sphere(point3(0, -wall, 0), wall, white);
+    scene.add_sphere(point3(0, wall + 5, 0), wall, white);
+    scene.add_sphere(point3(0, 2.5, -wall - 5), wall, white);
+    scene.add_sphere(point3(0, 2.5, wall + 5), wall, black);
+
+    scene.add_sphere(point3(-1.2, 0.8, -3), 0.8, mirror);
+    scene.add_sphere(point3(1.1, 0.8, -1.8), 0.8, glass);
+    scene.add_sphere(point3(0, 4.6, -2.5), 0.25, lamp);
+
+    scene.cam.lookfrom[0] = 0; scene.cam.lookfrom[1] = 2.5; scene.cam.lookfrom[2] = 4.5;
+    scene.cam.lookat[0] = 0;   scene.cam.lookat[1] = 2.2;   scene.cam.lookat[2] = -5;
+    scene.cam.vfov = 50;
+    scene.cam.aperture = 0;
+    scene.cam.focus_dist = 7;
+    return scene;
+}
+
+#endif
@@ -3,27 +3,32 @@
 
 #include "vec3.h"
 
-class ray {
+// Raio com origem e direção do tipo escalar T (ver 'real' em vec3.h)
+template <typename T>
+class ray_t {
 public:
-    ray() {} // Construtor padrão vazio
+    using point_type = vec3_t<T>;
+    using vector_type = vec3_t<T>;
+
+    ray_t() {} // Construtor padrão vazio
 
     // Construtor que inicializa o raio com uma origem e direção
-    ray(const point3& origin, const vec3& direction)
+    ray_t(const point_type& origin, const vector_type& direction)
         : orig(origin), dir(direction), tm(0)
     {}
 
     // Construtor que inicializa o raio com uma origem, direção e tempo
-    ray(const point3& origin, const vec3& direction, double time)
+    ray_t(const point_type& origin, const vector_type& direction, double time)
         : orig(origin), dir(direction), tm(time)
     {}
 
     // Função que retorna a origem do raio
-    point3 origin() const {
+    point_type origin() const {
         return orig;
     }
 
     // Função que retorna a direção do raio
-    vec3 direction() const {
+    vector_type direction() const {
         return dir;
     }
 
@@ -33,14 +38,16 @@ public:
     }
 
     // Função que retorna o ponto ao longo do raio em uma distância t
-    point3 at(double t) const {
+    point_type at(T t) const {
         return orig + t * dir;
     }
 
 public:
-    point3 orig; // Origem do raio
-    vec3 dir;    // Direção do raio
-    double tm;   // Tempo do raio
+    point_type orig; // Origem do raio
+    vector_type dir; // Direção do raio
+    double tm;       // Tempo do raio
 };
 
+using ray = ray_t<real>;
+
 #endif
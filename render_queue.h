@@ -0,0 +1,281 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "rtweekend.h"
+
+#include "accumulation.h"
+#include "bvh.h"
+#include "camera.h"
+#include "denoise.h"
+#include "feature_buffer.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "lights.h"
+#include "material.h"
+#include "partial.h"
+#include "renderer.h"
+#include "scheduler.h"
+#include "sphere_set.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Interface para usar o ray tracer como biblioteca. A cena é preparada uma vez
+// (make_render_scene) e pode ser renderizada por vários jobs ao mesmo tempo; submit()
+// retorna na hora com um render_handle, pelo qual se acompanha o progresso, se lê a imagem
+// parcial, se cancela e se espera o resultado:
+//
+//     material_arena materials;
+//     hittable_list objects = build_world(description, materials);
+//     auto scene = make_render_scene(std::move(objects), std::move(materials));
+//     render_handle handle = submit(scene, make_camera(description.cam), settings);
+//     while (!handle.wait_for(1.0)) std::cerr << handle.progress().fraction() << '\n';
+//     write_image("imagem.png", handle.result().image, handle.result().scale);
+//
+// Os tiles de todos os jobs rodam no mesmo worker_pool (por padrão worker_pool::global()),
+// na ordem das prioridades dos jobs; cada job tem só uma thread própria, que coordena as
+// passadas e passa quase todo o tempo esperando o pool. O job pertence aos seus
+// render_handle: quando a última cópia é destruída, o job é cancelado e a sua thread é
+// esperada, então nada dele sobrevive ao handle. Os ponteiros de render_settings (stream
+// e stats) precisam continuar válidos até então. Se o pool for encerrado
+// (worker_pool::shutdown) no meio do job, as passadas seguintes são recusadas e o
+// resultado sai como cancelado.
+
+// Como preparar a cena
+struct scene_options {
+    bool bvh = true;             // false: lista linear de objetos
+    bool sphere_sets = false;    // Agrupa as esferas em sphere_set (ver sphere_set.h)
+    bool sample_lights = true;   // Amostragem direta das luzes da cena (ver lights.h)
+    dispatch_mode dispatch = dispatch_mode::static_variant;
+};
+
+// Cena pronta para renderizar. Não muda depois de criada, então vários jobs a usam juntos.
+struct render_scene {
+    material_arena materials;
+    hittable_list objects;       // Os objetos, como entram na BVH
+    light_list lights;           // Vazia sem amostragem direta
+    shared_ptr<hittable> world;  // A BVH, ou a lista
+};
+
+inline shared_ptr<render_scene> make_render_scene(hittable_list objects, material_arena materials,
+                                                  const scene_options& options = scene_options()) {
+    auto scene = make_shared<render_scene>();
+    scene->materials = std::move(materials);
+    if (options.sample_lights)
+        scene->lights = light_list(objects, scene->materials);
+    scene->objects = options.sphere_sets ? cluster_spheres(objects) : std::move(objects);
+    if (options.bvh)
+        scene->world = make_shared<bvh>(scene->objects, 0, 0, options.dispatch);
+    else
+        scene->world = make_shared<hittable_list>(scene->objects);
+    return scene;
+}
+
+enum class render_mode {
+    tiles,        // Todas as amostras de uma vez (render)
+    adaptive,     // Amostragem adaptativa (render_adaptive)
+    progressive,  // Passadas sobre a imagem inteira (render_progressive)
+    partial,      // Uma parte da imagem, para juntar depois (render_partial)
+};
+
+struct submit_options {
+    render_mode mode = render_mode::tiles;
+    int priority = 0;                // Maior passa na frente no pool
+    worker_pool* pool = nullptr;     // Nulo: worker_pool::global()
+    bool features = false;           // Guarda em result.features os atributos do primeiro ponto (modo tiles)
+    bool denoise = false;            // Filtra a imagem no fim (modo tiles)
+    accumulation_buffer resume;      // Modo progressivo: amostras de onde continuar, por exemplo de um checkpoint
+    render_job job;                  // Modo partial: a parte a renderizar
+    // Modo progressivo: chamada na thread do job ao fim de cada passada, com as amostras até
+    // ali; não pode destruir a última cópia do render_handle
+    std::function<void(const accumulation_buffer&, int)> after_pass;
+};
+
+struct render_result {
+    framebuffer image;           // Soma das amostras de cada pixel, normalizada por 'scale'
+    double scale = 1;            // Como em write_image: 1/amostras no modo tiles sem denoiser, senão 1
+    feature_buffer features;     // Já normalizados, com submit_options::features ou denoise
+    accumulation_buffer acc;     // Modos adaptativo e progressivo
+    partial_buffer part;         // Modo partial, sem 'image' (os hashes ficam para quem grava)
+    int passes = 0;
+    double render_seconds = 0;
+    double denoise_seconds = 0;
+    bool cancelled = false;      // A imagem pode ter tiles em zero ou com menos amostras
+    std::string error;           // Configurações recusadas (nada é renderizado); vazio se não
+};
+
+struct render_progress {
+    int passes = 0;                     // Passadas concluídas
+    std::uint64_t samples_done = 0;
+    std::uint64_t samples_planned = 0;  // No modo adaptativo, o limite (ver render_control)
+    bool finished = false;
+
+    double fraction() const {
+        if (finished) return 1;
+        return samples_planned ? static_cast<double>(samples_done) / samples_planned : 0;
+    }
+};
+
+class render_handle {
+public:
+    render_handle() {}
+
+    bool valid() const { return state != nullptr; }
+
+    render_progress progress() const;
+
+    // Pede o cancelamento; o job termina ao fim dos tiles em andamento e o resultado fica
+    // com o que já foi calculado
+    void cancel() { state->control.cancel(); }
+
+    // Copia a imagem como está agora (a média de cada pixel, escala 1); false se nenhum
+    // tile terminou ainda
+    bool partial(framebuffer& out) const { return state->control.preview(out); }
+
+    bool done() const;
+    void wait() const;
+    bool wait_for(double seconds) const;  // true se terminou dentro do prazo
+
+    // Espera o fim e retorna o resultado
+    const render_result& result() const {
+        wait();
+        return state->result;
+    }
+
+private:
+    struct shared_state {
+        render_control control;
+        render_result result;
+        mutable std::mutex m;
+        mutable std::condition_variable finished_cv;
+        bool finished = false;
+        std::thread driver;  // A thread do job, que usa este estado até terminar
+
+        ~shared_state() {
+            if (driver.joinable()) {
+                control.cancel();
+                driver.join();
+            }
+        }
+    };
+
+    friend render_handle submit(shared_ptr<const render_scene> scene, const camera& cam,
+                             render_settings settings, submit_options options);
+    static void run(shared_state& state, const render_scene& scene, const camera& cam,
+                    render_settings settings, submit_options& options);
+
+    shared_ptr<shared_state> state;
+};
+
+// Põe a renderização na fila e retorna sem esperar. 'settings.threads' é ignorado (quem
+// decide é o tamanho do pool) e 'settings.lights' vem da cena. Descartar o handle
+// retornado cancela o job.
+render_handle submit(shared_ptr<const render_scene> scene, const camera& cam, render_settings settings,
+                  submit_options options = submit_options());
+
+
+inline render_progress render_handle::progress() const {
+    render_progress p;
+    p.passes = state->control.passes();
+    p.samples_done = state->control.samples_done();
+    p.samples_planned = state->control.samples_planned();
+    p.finished = done();
+    return p;
+}
+
+inline bool render_handle::done() const {
+    std::lock_guard<std::mutex> lock(state->m);
+    return state->finished;
+}
+
+inline void render_handle::wait() const {
+    std::unique_lock<std::mutex> lock(state->m);
+    state->finished_cv.wait(lock, [&] { return state->finished; });
+}
+
+inline bool render_handle::wait_for(double seconds) const {
+    std::unique_lock<std::mutex> lock(state->m);
+    return state->finished_cv.wait_for(lock, std::chrono::duration<double>(seconds),
+                                       [&] { return state->finished; });
+}
+
+inline render_handle submit(shared_ptr<const render_scene> scene, const camera& cam, render_settings settings,
+                            submit_options options) {
+    render_handle handle;
+    handle.state = make_shared<render_handle::shared_state>();
+    settings.pool = options.pool ? options.pool : &worker_pool::global();
+    settings.priority = options.priority;
+    settings.control = &handle.state->control;
+    settings.lights = scene->lights.empty() ? nullptr : &scene->lights;
+
+    // A thread não segura o estado (senão ele nunca seria destruído com o último handle);
+    // ele vive até o join no seu destrutor. A cena fica com a thread até o fim.
+    render_handle::shared_state* state = handle.state.get();
+    state->driver = std::thread([state, scene, cam, settings, options = std::move(options)]() mutable {
+        render_handle::run(*state, *scene, cam, settings, options);
+        {
+            std::lock_guard<std::mutex> lock(state->m);
+            state->finished = true;
+        }
+        state->finished_cv.notify_all();
+    });
+    return handle;
+}
+
+inline void render_handle::run(shared_state& state, const render_scene& scene, const camera& cam,
+                               render_settings settings, submit_options& options) {
+    render_result& r = state.result;
+    const hittable& world = *scene.world;
+    const bool want_features = options.mode == render_mode::tiles && (options.features || options.denoise);
+
+    auto start = std::chrono::steady_clock::now();
+    switch (options.mode) {
+        case render_mode::progressive:
+            r.acc = std::move(options.resume);
+            r.passes = render_progressive(world, scene.materials, cam, settings, r.acc, [&](int pass) {
+                if (options.after_pass) options.after_pass(r.acc, pass);
+            });
+            r.acc.resolve(r.image);
+            r.scale = 1;
+            break;
+        case render_mode::partial:
+            render_partial(world, scene.materials, cam, settings, options.job, r.part);
+            r.passes = 1;
+            break;
+        case render_mode::adaptive:
+            r.error = adaptive_settings_error(settings);
+            r.passes = render_adaptive(world, scene.materials, cam, settings, r.acc);
+            r.acc.resolve(r.image);
+            r.scale = 1;
+            break;
+        default:
+            if (want_features) settings.features = &r.features;
+            render(world, scene.materials, cam, settings, r.image);
+            r.scale = 1.0 / settings.samples_per_pixel;
+            r.passes = 1;
+            break;
+    }
+    r.render_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    r.cancelled = state.control.cancelled() || settings.pool->is_shut_down();
+
+    if (want_features) r.features.normalize(r.scale);
+    if (options.denoise && options.mode == render_mode::tiles && !r.cancelled) {
+        start = std::chrono::steady_clock::now();
+        framebuffer denoised;
+        denoise(r.image, r.scale, r.features, denoise_settings(), settings.threads, denoised,
+                settings.pool, settings.priority);
+        r.image = std::move(denoised);
+        r.scale = 1;
+        r.denoise_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // O leitor do stream recebe a imagem filtrada inteira por cima dos tiles
+        if (settings.stream) settings.stream->send_tile(tile{0, 0, r.image.width, r.image.height}, r.image, 1, 1);
+    }
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "rtweekend.h"
+
+#include "accumulation.h"
+#include "camera.h"
+#include "feature_buffer.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "integrator.h"
+#include "lights.h"
+#include "material.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "tile.h"
+#include "tile_stream.h"
+#include "wavefront.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Acompanhamento de uma renderização por outra thread: pedido de cancelamento, progresso
+// e uma prévia da imagem. Os workers copiam cada tile terminado para a prévia, já
+// normalizado, como fazem com o stream, então a prévia pode ser lida a qualquer momento
+// sem esperar a renderização.
+class render_control {
+public:
+    // Os tiles que ainda não começaram são pulados e a renderização volta logo
+    void cancel() { cancel_requested = true; }
+    bool cancelled() const { return cancel_requested.load(std::memory_order_relaxed); }
+
+    // Amostras já traçadas e previstas. No modo adaptativo o previsto é o limite de
+    // max_samples_per_pixel e só vira o total no fim, então a fração fica por baixo.
+    std::uint64_t samples_done() const { return done; }
+    std::uint64_t samples_planned() const { return planned; }
+    int passes() const { return pass_count; }
+
+    // Copia a prévia (a média de cada pixel, escala 1; zero nos pixels sem amostras)
+    bool preview(framebuffer& out) const {
+        std::lock_guard<std::mutex> lock(m);
+        if (image.pixel_count() == 0) return false;
+        out = image;
+        return true;
+    }
+
+    // Chamadas pelo renderizador
+    void begin(int width, int height, std::uint64_t samples) {
+        std::lock_guard<std::mutex> lock(m);
+        if (image.width != width || image.height != height) image.resize(width, height);
+        done = 0;
+        planned = samples;
+    }
+    void set_planned(std::uint64_t samples) { planned = samples; }
+    void tile_finished(const tile& t, const framebuffer& fb, double scale, std::uint64_t samples);
+    void tile_finished(const tile& t, const accumulation_buffer& acc, std::uint64_t samples);
+    void samples_finished(std::uint64_t samples) { done += samples; }  // Sem prévia (render_partial)
+    void pass_finished(int pass) { pass_count = pass; }
+
+private:
+    std::atomic<bool> cancel_requested{false};
+    std::atomic<std::uint64_t> done{0};
+    std::atomic<std::uint64_t> planned{0};
+    std::atomic<int> pass_count{0};
+    mutable std::mutex m;
+    framebuffer image;
+};
+
+// Parâmetros da renderização
+struct render_settings {
+    int image_width = 1200;
+    int image_height = 675;
+    int samples_per_pixel = 10;
+    int max_depth = 50;
+    int threads = default_thread_count();  // Número de threads de renderização
+    int tile_size = 16;       // Lado dos tiles em pixels
+    bool progress = true;     // Mostra o progresso no stderr
+    bool wavefront = false;   // Usa o integrador wavefront em vez do recursivo
+    dispatch_mode dispatch = dispatch_mode::static_variant;  // Chamada dos materiais
+    sampler_mode sampler = sampler_mode::random;  // Sequências de amostras (ver sampler.h)
+    std::uint64_t frame = 0;  // Quadro da animação, que entra na semente das amostras (ver begin_sample)
+    russian_roulette rr;      // Política de término dos caminhos
+    render_stats* stats = nullptr;  // Onde somar as estatísticas (só com RT_STATS, ver stats.h)
+    feature_buffer* features = nullptr;  // Onde somar os atributos do primeiro ponto (só em render)
+    const light_list* lights = nullptr;  // Luzes para a amostragem direta; nulo só coleta a emissão encontrada
+    tile_stream* stream = nullptr;  // Para onde mandar cada tile terminado (ver tile_stream.h)
+    worker_pool* pool = nullptr;    // Se houver, os tiles rodam nele em vez de em 'threads' threads próprias
+    int priority = 0;               // Prioridade dos tiles no pool; maior passa na frente
+    render_control* control = nullptr;  // Cancelamento, progresso e prévia (ver render_control)
+
+    // Amostragem adaptativa (ver render_adaptive)
+    int max_samples_per_pixel = 256;  // Limite de amostras de um pixel
+    int pass_samples = 8;             // Amostras acrescentadas por passada
+    double noise_threshold = 0.01;    // Erro aceito na escala de exibição (ver display_error)
+};
+
+inline void render_control::tile_finished(const tile& t, const framebuffer& fb, double scale, std::uint64_t samples) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        const float s = static_cast<float>(scale);
+        for (int j = t.y0; j < t.y1; ++j) {
+            const size_t row = (static_cast<size_t>(j) * fb.width + t.x0) * 3;
+            for (int k = 0; k < t.width() * 3; ++k)
+                image.rgb[row + k] = fb.rgb[row + k] * s;
+        }
+    }
+    done += samples;
+}
+
+inline void render_control::tile_finished(const tile& t, const accumulation_buffer& acc, std::uint64_t samples) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        for (int j = t.y0; j < t.y1; ++j)
+            for (int i = t.x0; i < t.x1; ++i) {
+                const size_t pixel = static_cast<size_t>(j) * acc.width + i;
+                image.set(pixel, acc.mean(pixel));
+            }
+    }
+    done += samples;
+}
+
+// Traça a amostra s do pixel (i, j) a partir do fluxo aleatório (ou da sequência) dessa amostra.
+inline color trace_sample(const hittable& world, const material_arena& materials, const camera& cam, const render_settings& settings,
+                          int i, int j, int s, path_features* first_hit = nullptr) {
+    begin_sample(settings.sampler, i, j, settings.image_width, s, settings.frame);
+    double du, dv;
+    sample_2d(du, dv);
+    auto u = (i + du) / (settings.image_width-1);
+    auto v = (j + dv) / (settings.image_height-1);
+    ray r = cam.get_ray(u, v);
+    if (settings.dispatch == dispatch_mode::virtual_calls)
+        return ray_color<dispatch_mode::virtual_calls>(r, world, materials, settings.max_depth, settings.rr,
+                                                       first_hit, settings.lights);
+    return ray_color(r, world, materials, settings.max_depth, settings.rr, first_hit, settings.lights);
+}
+
+// Renderiza a imagem dividida em tiles, distribuídos entre as threads por roubo de trabalho.
+// O framebuffer guarda a soma das amostras de cada pixel.
+// Cada amostra usa o seu próprio fluxo aleatório, derivado do pixel e do índice da amostra,
+// então o resultado é o mesmo, byte a byte, para qualquer número de threads.
+// Com settings.features, também soma os atributos do primeiro ponto de cada amostra.
+// Cancelada por settings.control, deixa em zero os pixels dos tiles que não começaram.
+inline void render(const hittable& world, const material_arena& materials, const camera& cam, const render_settings& settings,
+                   framebuffer& fb) {
+    const int width = settings.image_width;
+    const int height = settings.image_height;
+    fb.resize(width, height);
+    feature_buffer* features = settings.features;
+    if (features) features->resize(width, height);
+
+    auto tiles = make_tiles(width, height, settings.tile_size);
+    const int tile_count = static_cast<int>(tiles.size());
+    std::atomic<int> tiles_done(0);
+    std::mutex progress_mutex;
+    const int workers = worker_count(settings.pool, settings.threads);
+    std::vector<wavefront_integrator> wavefronts(settings.wavefront ? workers : 0);
+    stats_collector stats(settings.stats, workers, tiles, width, height);
+    render_control* control = settings.control;
+    if (control) control->begin(width, height, fb.pixel_count() * settings.samples_per_pixel);
+
+    parallel_for(settings.pool, settings.priority, tile_count, settings.threads, [&](int t, int worker) {
+        const tile& tl = tiles[t];
+        if (control && control->cancelled()) return;
+        stats.run_tile(t, worker, [&] {
+            if (settings.wavefront) {
+                wavefronts[worker].render_tile(world, materials, cam, tl, width, height,
+                                               settings.samples_per_pixel, settings.max_depth,
+                                               settings.rr, settings.sampler, settings.frame, settings.lights,
+                                               fb, features);
+            } else for (int j = tl.y0; j < tl.y1; ++j) {
+                for (int i = tl.x0; i < tl.x1; ++i) {
+                    const size_t pixel = static_cast<size_t>(j) * width + i;
+                    color pixel_color(0,0,0);
+                    for (int s = 0; s < settings.samples_per_pixel; ++s) {
+                        if (!features) {
+                            pixel_color += trace_sample(world, materials, cam, settings, i, j, s);
+                            continue;
+                        }
+                        path_features first_hit;
+                        const color sample = trace_sample(world, materials, cam, settings, i, j, s, &first_hit);
+                        pixel_color += sample;
+                        features->add(pixel, first_hit);
+                        features->add_radiance(pixel, sample);
+                    }
+                    fb.set(pixel, pixel_color);
+                }
+            }
+        });
+        if (settings.stream) settings.stream->send_tile(tl, fb, 1.0 / settings.samples_per_pixel, 1);
+        if (control)
+            control->tile_finished(tl, fb, 1.0 / settings.samples_per_pixel,
+                                   static_cast<std::uint64_t>(tl.pixel_count()) * settings.samples_per_pixel);
+
+        int done = ++tiles_done;
+        if (settings.progress) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            std::cerr << "\rTiles restantes: " << tile_count - done << ' ' << std::flush;
+        }
+    });
+    if (settings.stream) settings.stream->end_pass(1);
+    if (control) control->pass_finished(1);
+    stats.finish();
+}
+
+// Motivo pelo qual render_adaptive recusa 'settings', ou vazio se as aceita. Sem amostras
+// novas a cada passada, os pixels ruidosos nunca deixariam de ser amostrados.
+inline std::string adaptive_settings_error(const render_settings& settings) {
+    if (settings.samples_per_pixel < 1) return "são precisas pelo menos 1 amostra por pixel";
+    if (settings.pass_samples < 1) return "cada passada precisa de pelo menos 1 amostra";
+    if (settings.max_samples_per_pixel < settings.samples_per_pixel)
+        return "o limite de amostras por pixel é menor que as amostras iniciais";
+    return std::string();
+}
+
+// Amostragem adaptativa: todos os pixels recebem samples_per_pixel amostras e, a cada
+// passada seguinte, só os pixels cujo erro estimado ainda passa de noise_threshold
+// recebem mais pass_samples amostras, até max_samples_per_pixel. Com poucas amostras a
+// variância de um pixel isolado pode sair subestimada por acaso, então um pixel só
+// para quando nenhum dos vizinhos 3x3 passa do limiar. As amostras de um pixel são
+// sempre as de índices 0, 1, 2..., então o resultado não depende do número de threads.
+// Retorna o número de passadas feitas; cancelada, para ao fim da passada em andamento.
+// Com configurações que adaptive_settings_error recusa, não renderiza nada e retorna 0.
+inline int render_adaptive(const hittable& world, const material_arena& materials, const camera& cam, const render_settings& settings,
+                           accumulation_buffer& acc) {
+    const int width = settings.image_width;
+    const int height = settings.image_height;
+    acc.resize(width, height);
+    if (!adaptive_settings_error(settings).empty()) return 0;
+
+    auto tiles = make_tiles(width, height, settings.tile_size);
+    const int tile_count = static_cast<int>(tiles.size());
+    std::vector<std::uint8_t> noisy(acc.pixel_count(), 1);  // Pixels acima do limiar
+    stats_collector stats(settings.stats, worker_count(settings.pool, settings.threads), tiles, width, height);
+    render_control* control = settings.control;
+    if (control) control->begin(width, height, acc.pixel_count() * settings.max_samples_per_pixel);
+    int passes = 0;
+
+    for (;;) {
+        std::atomic<std::uint64_t> active_pixels(0);
+
+        parallel_for(settings.pool, settings.priority, tile_count, settings.threads, [&](int t, int worker) {
+            const tile& tl = tiles[t];
+            std::uint64_t active = 0, samples = 0;
+            if (control && control->cancelled()) return;
+            stats.run_tile(t, worker, [&] {
+                for (int j = tl.y0; j < tl.y1; ++j) {
+                    for (int i = tl.x0; i < tl.x1; ++i) {
+                        const size_t pixel = static_cast<size_t>(j) * width + i;
+                        const int have = static_cast<int>(acc.count[pixel]);
+                        if (have >= settings.max_samples_per_pixel) continue;
+
+                        bool needs_samples = false;
+                        for (int dj = -1; dj <= 1 && !needs_samples; ++dj)
+                            for (int di = -1; di <= 1 && !needs_samples; ++di) {
+                                int ni = i + di, nj = j + dj;
+                                if (ni >= 0 && ni < width && nj >= 0 && nj < height)
+                                    needs_samples = noisy[static_cast<size_t>(nj) * width + ni] != 0;
+                            }
+                        if (!needs_samples) continue;
+
+                        const int target = have == 0 ? settings.samples_per_pixel
+                                         : std::min(have + settings.pass_samples, settings.max_samples_per_pixel);
+                        for (int s = have; s < target; ++s)
+                            acc.add_sample(pixel, trace_sample(world, materials, cam, settings, i, j, s));
+                        if (target > have) {
+                            samples += target - have;
+                            active++;
+                        }
+                    }
+                }
+            });
+            if (settings.stream && active > 0) settings.stream->send_tile(tl, acc, passes + 1);
+            if (control && active > 0) control->tile_finished(tl, acc, samples);
+            active_pixels += active;
+        });
+
+        passes++;
+        if (settings.progress)
+            std::cerr << "\rPassada " << passes << ": " << active_pixels.load()
+                      << " pixels amostrados " << std::flush;
+        if (active_pixels.load() == 0) break;
+        if (settings.stream) settings.stream->end_pass(passes);
+        if (control) {
+            control->pass_finished(passes);
+            if (control->cancelled()) break;
+        }
+
+        // Reavalia o erro só depois da passada inteira, para que a decisão de cada pixel
+        // não dependa da ordem em que os tiles foram processados.
+        for (size_t k = 0; k < acc.pixel_count(); ++k)
+            noisy[k] = acc.count[k] < static_cast<std::uint32_t>(settings.max_samples_per_pixel)
+                    && acc.display_error(k) > settings.noise_threshold;
+    }
+
+    if (control) control->set_planned(control->samples_done());
+    stats.finish();
+    return passes;
+}
+
+// Renderização progressiva: acrescenta passadas de pass_samples amostras à imagem
+// inteira até cada pixel ter samples_per_pixel amostras, chamando after_pass(passada)
+// ao fim de cada uma (para gravar um checkpoint ou uma prévia). Se 'acc' já tiver
+// amostras, por exemplo vindas de um checkpoint, continua de onde parou; como cada
+// pixel soma as amostras sempre na ordem 0, 1, 2..., o resultado é idêntico ao de uma
+// renderização sem interrupção (inclusive depois de um cancelamento, que para ao fim da
+// passada em andamento sem chamar after_pass). Retorna o número de passadas desta chamada.
+template <typename AfterPass>
+int render_progressive(const hittable& world, const material_arena& materials, const camera& cam, const render_settings& settings,
+                       accumulation_buffer& acc, AfterPass after_pass) {
+    const int width = settings.image_width;
+    const int height = settings.image_height;
+    if (acc.width != width || acc.height != height)
+        acc.resize(width, height);
+
+    auto tiles = make_tiles(width, height, settings.tile_size);
+    const int tile_count = static_cast<int>(tiles.size());
+    stats_collector stats(settings.stats, worker_count(settings.pool, settings.threads), tiles, width, height);
+    render_control* control = settings.control;
+    if (control) {
+        const std::uint64_t target = acc.pixel_count() * static_cast<std::uint64_t>(settings.samples_per_pixel);
+        const std::uint64_t have = acc.total_samples();
+        control->begin(width, height, target > have ? target - have : 0);
+        if (have > 0) control->tile_finished(tile{0, 0, width, height}, acc, 0);  // A prévia começa do checkpoint
+    }
+    int passes = 0;
+
+    for (;;) {
+        std::atomic<std::uint64_t> active_pixels(0);
+
+        parallel_for(settings.pool, settings.priority, tile_count, settings.threads, [&](int t, int worker) {
+            const tile& tl = tiles[t];
+            std::uint64_t active = 0, samples = 0;
+            if (control && control->cancelled()) return;
+            stats.run_tile(t, worker, [&] {
+                for (int j = tl.y0; j < tl.y1; ++j) {
+                    for (int i = tl.x0; i < tl.x1; ++i) {
+                        const size_t pixel = static_cast<size_t>(j) * width + i;
+                        const int have = static_cast<int>(acc.count[pixel]);
+                        const int target = std::min(have + settings.pass_samples, settings.samples_per_pixel);
+                        for (int s = have; s < target; ++s)
+                            acc.add_sample(pixel, trace_sample(world, materials, cam, settings, i, j, s));
+                        if (target > have) {
+                            samples += target - have;
+                            active++;
+                        }
+                    }
+                }
+            });
+            if (settings.stream && active > 0) settings.stream->send_tile(tl, acc, passes + 1);
+            if (control && active > 0) control->tile_finished(tl, acc, samples);
+            active_pixels += active;
+        });
+
+        if (active_pixels.load() == 0) break;
+        passes++;
+        if (settings.stream) settings.stream->end_pass(passes);
+        if (control) {
+            control->pass_finished(passes);
+            if (control->cancelled()) break;
+        }
+        after_pass(passes);
+    }
+
+    stats.finish();
+    return passes;
+}
+
+#endif
@@ -2,10 +2,11 @@
 #define RTWEEKEND_H
 
 #include <cmath>    // Para funções matemáticas
-#include <cstdlib>  // Para geração de números aleatórios
 #include <limits>   // Para limites numéricos
 #include <memory>   // Para gerenciamento de memória
 
+#include "sampler.h"  // Geradores de números aleatórios por thread
+
 // Usings
 using std::shared_ptr;
 using std::make_shared;
@@ -29,9 +30,9 @@ inline double clamp(double x, double min, double max) {
     return x;
 }
 
-// Gera um número aleatório no intervalo [0,1)
+// Gera um número aleatório no intervalo [0,1) a partir do gerador da thread (ver sampler.h)
 inline double random_double() {
-    return rand() / (RAND_MAX + 1.0);
+    return thread_rng().next_double();
 }
 
 // Gera um número aleatório no intervalo [min,max)
@@ -0,0 +1,383 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Gerador PCG32 (O'Neill, pcg-random.org): 64 bits de estado, saída de 32 bits.
+// Cada par (semente, fluxo) define uma sequência independente; o fluxo escolhe o
+// incremento do LCG interno, então fluxos diferentes nunca se sobrepõem.
+class pcg32 {
+public:
+    pcg32() : pcg32(0x853c49e6748fea9bull, 0xda3e39cb94b95bdbull) {}
+
+    pcg32(std::uint64_t seed, std::uint64_t stream) { set_stream(seed, stream); }
+
+    // Reinicia o gerador na sequência (semente, fluxo).
+    void set_stream(std::uint64_t seed, std::uint64_t stream) {
+        state = 0;
+        inc = (stream << 1) | 1u;
+        next_uint();
+        state += seed;
+        next_uint();
+    }
+
+    std::uint32_t next_uint() {
+        std::uint64_t old = state;
+        state = old * multiplier + inc;
+        auto xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        auto rot = static_cast<std::uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // Número em [0,1) com os 32 bits de saída como mantissa.
+    double next_double() {
+        return next_uint() * (1.0 / 4294967296.0);
+    }
+
+    // Avança (ou recua, com delta negativo em complemento de dois) delta passos
+    // em O(log delta), sem gerar os números intermediários.
+    void advance(std::uint64_t delta) {
+        std::uint64_t cur_mult = multiplier, cur_plus = inc;
+        std::uint64_t acc_mult = 1, acc_plus = 0;
+        while (delta > 0) {
+            if (delta & 1) {
+                acc_mult *= cur_mult;
+                acc_plus = acc_plus * cur_mult + cur_plus;
+            }
+            cur_plus = (cur_mult + 1) * cur_plus;
+            cur_mult *= cur_mult;
+            delta >>= 1;
+        }
+        state = acc_mult * state + acc_plus;
+    }
+
+    std::uint64_t state;  // Estado do LCG
+    std::uint64_t inc;    // Incremento (sempre ímpar), determinado pelo fluxo
+
+private:
+    static constexpr std::uint64_t multiplier = 6364136223846793005ull;
+};
+
+// Mistura de 64 bits (finalizador do splitmix64), usada para derivar sementes.
+inline std::uint64_t mix64(std::uint64_t z) {
+    z += 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Como as dimensões de cada amostra são sorteadas (ver sample_1d e sample_2d)
+enum class sampler_mode {
+    random,      // Números independentes do fluxo pcg32 da amostra
+    sobol,       // Sobol com embaralhamento de Owen, independente em cada pixel
+    blue_noise   // A mesma sequência Sobol em todos os pixels, deslocada por uma máscara de ruído azul
+};
+
+// Lê o nome de um modo de amostragem; retorna false se não for conhecido
+inline bool parse_sampler(const std::string& name, sampler_mode& mode) {
+    if (name == "random") mode = sampler_mode::random;
+    else if (name == "sobol") mode = sampler_mode::sobol;
+    else if (name == "blue-noise") mode = sampler_mode::blue_noise;
+    else return false;
+    return true;
+}
+
+// Estado de amostragem da thread: o gerador da amostra corrente e, para as sequências
+// de baixa discrepância, o índice da amostra, a próxima dimensão a consumir e a semente
+// do embaralhamento.
+struct sample_state {
+    pcg32 rng;
+    sampler_mode mode = sampler_mode::random;
+    std::uint32_t index = 0;      // Índice da amostra no pixel
+    std::uint32_t dimension = 0;  // Próxima dimensão da sequência
+    std::uint64_t seed = 0;       // Do pixel no modo sobol, do quadro no modo blue_noise
+    int x = 0, y = 0;             // Pixel, para a máscara de ruído azul
+};
+
+inline sample_state& thread_sample() {
+    thread_local sample_state state;
+    return state;
+}
+
+// Gerador corrente da thread. As funções random_* de rtweekend.h e vec3.h sorteiam
+// sempre a partir dele, então nenhum ponto de chamada precisa receber um gerador.
+inline pcg32& thread_rng() {
+    return thread_sample().rng;
+}
+
+// Posiciona o gerador da thread no fluxo da amostra sample_index do pixel
+// pixel_index no quadro frame. O fluxo depende só desses três números, então a
+// renderização é reproduzível independentemente da thread ou da ordem de execução.
+// A amostragem volta ao modo random.
+inline void begin_sample(std::uint64_t pixel_index, std::uint64_t sample_index,
+                         std::uint64_t frame = 0) {
+    sample_state& state = thread_sample();
+    state.rng.set_stream(mix64(sample_index ^ mix64(frame)), pixel_index);
+    state.mode = sampler_mode::random;
+}
+
+// Como acima, para o pixel (x, y) de uma imagem de largura 'width', preparando também
+// as sequências do modo 'mode' a partir da dimensão 0.
+inline void begin_sample(sampler_mode mode, int x, int y, int width, std::uint32_t sample_index,
+                         std::uint64_t frame = 0) {
+    const auto pixel_index = static_cast<std::uint64_t>(y) * width + x;
+    begin_sample(pixel_index, sample_index, frame);
+    sample_state& state = thread_sample();
+    state.mode = mode;
+    state.index = sample_index;
+    state.dimension = 0;
+    state.seed = mode == sampler_mode::sobol ? mix64(pixel_index ^ mix64(frame)) : mix64(frame);
+    state.x = x;
+    state.y = y;
+}
+
+// Dimensões de cada amostra: 0 e 1 são a posição no pixel, 2 e 3 o ponto na lente, 4 o
+// instante do raio e, a partir daí, cada reflexão usa sete: duas da direção, uma do
+// material, uma da roleta russa e três da amostragem das luzes (ver lights.h). Fixar a
+// dimensão de cada decisão mantém as mesmas dimensões alinhadas entre amostras, mesmo
+// quando um material consome menos que outro.
+constexpr std::uint32_t camera_dimensions = 5;
+constexpr std::uint32_t bounce_dimensions = 7;
+
+inline void set_sample_dimension(std::uint32_t dimension) {
+    thread_sample().dimension = dimension;
+}
+
+// Primeira dimensão da reflexão 'bounce'
+inline std::uint32_t bounce_dimension(int bounce) {
+    return camera_dimensions + bounce_dimensions * static_cast<std::uint32_t>(bounce);
+}
+
+// Sequência de Sobol com embaralhamento de Owen, na formulação de Burley ("Practical
+// Hash-based Owen Scrambling", 2020): o embaralhamento de cada dígito binário depende
+// só dos dígitos mais significativos, o que um hash que propaga bits para cima aplica
+// de uma vez sobre o número com os bits invertidos. Só as duas primeiras dimensões de
+// Sobol são usadas; dimensões mais altas são pares independentes, cada um com a sua
+// semente (padding), o que mantém a estratificação 2D sem tabelas de direção.
+
+inline std::uint32_t reverse_bits(std::uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Permutação de Laine e Karras: cada bit passa a depender só dele e dos bits abaixo
+inline std::uint32_t laine_karras_permutation(std::uint32_t x, std::uint32_t seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// Embaralhamento de Owen de um número com o dígito mais significativo primeiro
+inline std::uint32_t nested_uniform_scramble(std::uint32_t x, std::uint32_t seed) {
+    return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+// Segunda dimensão de Sobol (a primeira é reverse_bits(index)): matriz geradora com as
+// direções v[k] = v[k-1] ^ (v[k-1] >> 1). Como o resultado é linear (XOR) nos bits do
+// índice, é a combinação de quatro tabelas de 256 entradas, uma por byte, em vez de um
+// laço de 32 passos com desvios imprevisíveis. As tabelas guardam os valores já com os
+// bits invertidos, a forma que o embaralhamento consome.
+struct sobol_byte_tables {
+    std::uint32_t table[4][256];
+
+    sobol_byte_tables() {
+        std::uint32_t direction[32];
+        direction[0] = 1u << 31;
+        for (int k = 1; k < 32; ++k)
+            direction[k] = direction[k - 1] ^ (direction[k - 1] >> 1);
+        for (int b = 0; b < 4; ++b)
+            for (int value = 0; value < 256; ++value) {
+                std::uint32_t result = 0;
+                for (int k = 0; k < 8; ++k)
+                    if (value & (1 << k)) result ^= direction[8 * b + k];
+                table[b][value] = reverse_bits(result);
+            }
+    }
+};
+
+// reverse_bits(segunda dimensão de Sobol do índice)
+inline std::uint32_t sobol_second_dimension_reversed(std::uint32_t index) {
+    static const sobol_byte_tables tables;
+    return tables.table[0][index & 0xff] ^ tables.table[1][(index >> 8) & 0xff]
+         ^ tables.table[2][(index >> 16) & 0xff] ^ tables.table[3][index >> 24];
+}
+
+// Duas primeiras dimensões de Sobol da amostra 'index', com o índice e cada dimensão
+// embaralhados por sementes derivadas de 'seed'. Equivale a
+// nested_uniform_scramble(sobol(nested_uniform_scramble(index))), com as inversões de
+// bits que se cancelam já removidas.
+inline std::uint32_t owen_sobol_index(std::uint32_t index, std::uint32_t seed) {
+    return nested_uniform_scramble(index, seed);
+}
+
+inline std::uint32_t owen_sobol_first(std::uint32_t shuffled, std::uint32_t seed) {
+    return reverse_bits(laine_karras_permutation(shuffled, seed ^ 0xa511e9b3u));
+}
+
+inline std::uint32_t owen_sobol_second(std::uint32_t shuffled, std::uint32_t seed) {
+    return reverse_bits(laine_karras_permutation(sobol_second_dimension_reversed(shuffled),
+                                                 seed ^ 0x63d83595u));
+}
+
+inline double to_unit_interval(std::uint32_t x) {
+    return x * (1.0 / 4294967296.0);
+}
+
+// Semente de 32 bits da dimensão 'dimension' a partir da semente da amostra
+inline std::uint32_t dimension_seed(std::uint64_t seed, std::uint32_t dimension) {
+    return static_cast<std::uint32_t>(mix64(seed ^ (static_cast<std::uint64_t>(dimension) << 40)));
+}
+
+// Máscara de ruído azul de lado blue_noise_size, gerada pelo método void-and-cluster
+// de Ulichney: cada valor é a ordem em que o pixel entrou num padrão binário que se
+// mantém sempre o mais espalhado possível, então qualquer limiar da máscara dá pontos
+// sem aglomerados e sem buracos. Valores em (0,1), todos distintos.
+constexpr int blue_noise_size = 64;
+
+inline std::vector<float> make_blue_noise_mask() {
+    constexpr int size = blue_noise_size, n = size * size, radius = 8;
+    constexpr double sigma = 1.5;
+    auto wrap = [](int k) { return k & (size - 1); };
+
+    // "Energia" de cada pixel: soma de gaussianas centradas nos pixels ligados, em um toro
+    std::vector<float> kernel((2 * radius + 1) * (2 * radius + 1));
+    for (int dy = -radius; dy <= radius; ++dy)
+        for (int dx = -radius; dx <= radius; ++dx)
+            kernel[(dy + radius) * (2 * radius + 1) + dx + radius] =
+                static_cast<float>(std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma)));
+
+    struct pattern {
+        std::vector<std::uint8_t> on = std::vector<std::uint8_t>(n, 0);
+        std::vector<float> energy = std::vector<float>(n, 0.0f);
+        int ones = 0;
+    };
+    auto toggle = [&](pattern& p, int k) {
+        const float sign = p.on[k] ? -1.0f : 1.0f;
+        p.on[k] ^= 1;
+        p.ones += p.on[k] ? 1 : -1;
+        const int x = k % size, y = k / size;
+        for (int dy = -radius; dy <= radius; ++dy)
+            for (int dx = -radius; dx <= radius; ++dx)
+                p.energy[wrap(y + dy) * size + wrap(x + dx)] +=
+                    sign * kernel[(dy + radius) * (2 * radius + 1) + dx + radius];
+    };
+    // Pixel ligado mais aglomerado (state = 1) ou desligado no maior vazio (state = 0)
+    auto extreme = [&](const pattern& p, std::uint8_t state) {
+        int best = -1;
+        for (int k = 0; k < n; ++k)
+            if (p.on[k] == state && (best < 0 || (state ? p.energy[k] > p.energy[best]
+                                                          : p.energy[k] < p.energy[best])))
+                best = k;
+        return best;
+    };
+
+    // Padrão inicial: 10% dos pixels sorteados, redistribuídos movendo o pixel mais
+    // aglomerado para o maior vazio até que ele volte para onde estava
+    pattern initial;
+    pcg32 rng(0x626c7565ull, 0x6e6f697365ull);
+    while (initial.ones < n / 10) {
+        const int k = static_cast<int>(rng.next_uint() % n);
+        if (!initial.on[k]) toggle(initial, k);
+    }
+    for (;;) {
+        const int cluster = extreme(initial, 1);
+        toggle(initial, cluster);
+        const int void_ = extreme(initial, 0);
+        toggle(initial, void_);
+        if (void_ == cluster) break;
+    }
+
+    std::vector<int> rank(n);
+    // Fase 1: os pixels do padrão inicial recebem as ordens mais baixas, removendo-os
+    // do mais aglomerado ao menos aglomerado
+    pattern p = initial;
+    while (p.ones > 0) {
+        const int k = extreme(p, 1);
+        toggle(p, k);
+        rank[k] = p.ones;
+    }
+    // Fases 2 e 3: os demais entram sempre no maior vazio. Passada a metade, o maior
+    // vazio dos ligados é o aglomerado mais denso dos desligados, então a mesma regra
+    // serve até o fim.
+    p = initial;
+    while (p.ones < n) {
+        const int k = extreme(p, 0);
+        rank[k] = p.ones;
+        toggle(p, k);
+    }
+
+    std::vector<float> mask(n);
+    for (int k = 0; k < n; ++k)
+        mask[k] = (rank[k] + 0.5f) / n;
+    return mask;
+}
+
+inline const std::vector<float>& blue_noise_mask() {
+    static const std::vector<float> mask = make_blue_noise_mask();
+    return mask;
+}
+
+// Valor da máscara de ruído azul no pixel da amostra corrente, com um deslocamento
+// toroidal próprio de cada dimensão, para que dimensões diferentes não fiquem correlacionadas
+inline double blue_noise_offset(const sample_state& state, std::uint32_t dimension) {
+    const std::uint32_t h = dimension_seed(state.seed ^ 0x5bd1e995ull, dimension);
+    const int x = (state.x + static_cast<int>(h)) & (blue_noise_size - 1);
+    const int y = (state.y + static_cast<int>(h >> 8)) & (blue_noise_size - 1);
+    return blue_noise_mask()[y * blue_noise_size + x];
+}
+
+// Soma com volta em [0,1) (deslocamento de Cranley-Patterson)
+inline double wrap_unit(double x) {
+    return x - std::floor(x);
+}
+
+// Próxima dimensão da amostra corrente, em [0,1). No modo random é o próximo número do
+// gerador da thread, exatamente como random_double().
+inline double sample_1d() {
+    sample_state& state = thread_sample();
+    if (state.mode == sampler_mode::random) return state.rng.next_double();
+
+    const std::uint32_t d = state.dimension++;
+    const std::uint32_t seed = dimension_seed(state.seed, d);
+    const double x = to_unit_interval(owen_sobol_first(owen_sobol_index(state.index, seed), seed));
+    if (state.mode == sampler_mode::sobol) return x;
+    return wrap_unit(x + blue_noise_offset(state, d));
+}
+
+// Próximo par de dimensões da amostra corrente, estratificado em 2D
+inline void sample_2d(double& u, double& v) {
+    sample_state& state = thread_sample();
+    if (state.mode == sampler_mode::random) {
+        u = state.rng.next_double();
+        v = state.rng.next_double();
+        return;
+    }
+
+    const std::uint32_t d = state.dimension;
+    state.dimension += 2;
+    const std::uint32_t seed = dimension_seed(state.seed, d);
+    const std::uint32_t index = owen_sobol_index(state.index, seed);
+    u = to_unit_interval(owen_sobol_first(index, seed));
+    v = to_unit_interval(owen_sobol_second(index, seed));
+    if (state.mode == sampler_mode::blue_noise) {
+        u = wrap_unit(u + blue_noise_offset(state, d));
+        v = wrap_unit(v + blue_noise_offset(state, d + 1));
+    }
+}
+
+// Número em [min,max) a partir da próxima dimensão
+inline double sample_1d(double min, double max) {
+    return min + (max - min) * sample_1d();
+}
+
+#endif
@@ -0,0 +1,867 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "rtweekend.h"
+
+#include "camera.h"
+#include "hittable_list.h"
+#include "mapped_file.h"
+#include "material.h"
+#include "mesh_io.h"
+#include "sphere.h"
+#include "texture_cache.h"
+#include "triangle_mesh.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Descrição de uma cena em arrays planos: os materiais, as esferas (que apontam para os
+// materiais pelo índice), as malhas de triângulos, as texturas e os parâmetros do
+// construtor da câmera. É o que os arquivos de cena guardam; build_world transforma a
+// descrição nos objetos do ray tracer.
+//
+// Há dois formatos de arquivo:
+//  - texto (.scn), um comando por linha, para editar à mão:
+//        camera lookfrom 13 2 3 lookat 0 0 0 vup 0 1 0 vfov 20 aspect 1.7778 aperture 0.1 focus 10
+//        lambertian chao 0.5 0.5 0.5
+//        metal espelho 0.7 0.6 0.5 0.0
+//        dielectric vidro 1.5
+//        light lampada 8 8 8
+//        texture terra texturas/terra.rtt
+//        lambertian globo texture terra
+//        metal bronze texture terra 0.2
+//        sphere 0 -1000 0 1000 chao
+//        mesh modelos/coelho.ply chao
+//    '#' começa um comentário; os campos omitidos de 'camera' ficam com o valor padrão.
+//    Uma esfera ou malha usa um material já definido pelo nome ou pelo número de ordem
+//    (0, 1, ...); por isso nomes de material não começam com dígito. Se um nome se
+//    repete, vale o primeiro. O caminho de uma malha (OBJ ou PLY binário, ver mesh_io.h)
+//    não tem espaços e, se relativo, é relativo ao diretório do arquivo de cena. O mesmo
+//    vale para as texturas (arquivos .rtt, ver texture_cache.h), que os materiais
+//    lambertian e metal usam no lugar da cor, também pelo nome ou pelo número;
+//  - binário (.scnb), um cabeçalho seguido pelos arrays exatamente como ficam na memória,
+//    cada um começando em um deslocamento múltiplo de 64 bytes. O arquivo é mapeado e
+//    os arrays são usados direto do mapeamento, sem cópia nem conversão. As malhas ficam
+//    nos próprios arquivos e o binário guarda só o caminho e o material de cada uma; das
+//    texturas, só o caminho.
+//
+// As malhas são lidas ao carregar a cena; várias referências ao mesmo arquivo
+// compartilham a mesma geometria. As texturas só são abertas por open_textures, em um
+// texture_cache, e os tiles são lidos do disco durante a renderização.
+
+// Parâmetros do construtor da câmera
+struct scene_camera {
+    double lookfrom[3] = {13, 2, 3};
+    double lookat[3] = {0, 0, 0};
+    double vup[3] = {0, 1, 0};
+    double vfov = 20;                  // Campo de visão vertical em graus
+    double aspect_ratio = 16.0 / 9.0;
+    double aperture = 0.1;
+    double focus_dist = 10;
+};
+
+struct scene_material {
+    std::uint32_t kind;       // material_kind: lambertian, metal, dielectric ou diffuse_light
+    std::uint32_t texture;    // lambertian e metal: 0 ou a textura k como k + 1, usada no lugar de albedo
+    double albedo[3];         // lambertian e metal; a radiância emitida em diffuse_light
+    double fuzz;              // metal
+    double ir;                // dielectric
+};
+
+struct scene_sphere {
+    double center[3];
+    double radius;
+    std::uint32_t material;   // Índice em materials()
+    std::uint32_t reserved;
+};
+
+// Malha de triângulos lida de um arquivo
+struct scene_mesh {
+    std::string path;                        // Como aparece no arquivo de cena
+    std::uint32_t material;                  // Índice em materials()
+    shared_ptr<const mesh_data> geometry;    // Vazio até a malha ser lida
+};
+
+// Textura de imagem guardada em um arquivo .rtt
+struct scene_texture {
+    std::string path;                        // Como aparece no arquivo de cena
+    shared_ptr<const texture> image;         // Vazio até a textura ser aberta
+};
+
+static_assert(std::is_trivially_copyable<scene_camera>::value, "scene_camera vai direto para o arquivo");
+static_assert(sizeof(scene_material) == 48, "layout do formato binário");
+static_assert(sizeof(scene_sphere) == 40, "layout do formato binário");
+
+
+class scene_data {
+public:
+    scene_data() {}
+
+    // Acrescentam um material e retornam o seu índice
+    std::uint32_t add_lambertian(const color& albedo);
+    std::uint32_t add_metal(const color& albedo, double fuzz);
+    std::uint32_t add_dielectric(double ir);
+    std::uint32_t add_light(const color& emit);
+    std::uint32_t add_material(const scene_material& m);
+
+    void add_sphere(const point3& center, double radius, std::uint32_t material);
+    void add_mesh(const std::string& path, std::uint32_t material,
+                  shared_ptr<const mesh_data> geometry = nullptr);
+    // Acrescenta uma textura e retorna o seu índice; um material a usa com texture = índice + 1
+    std::uint32_t add_texture(const std::string& path);
+
+    void reserve(size_t materials, size_t spheres);
+    void clear();
+
+    size_t material_count() const { return file.data() ? mapped_material_count : own_materials.size(); }
+    size_t sphere_count() const { return file.data() ? mapped_sphere_count : own_spheres.size(); }
+    const scene_material* materials() const { return file.data() ? mapped_materials : own_materials.data(); }
+    const scene_sphere* spheres() const { return file.data() ? mapped_spheres : own_spheres.data(); }
+    size_t mesh_count() const { return own_meshes.size(); }
+    const scene_mesh* meshes() const { return own_meshes.data(); }
+    size_t texture_count() const { return own_textures.size(); }
+    const scene_texture* textures() const { return own_textures.data(); }
+
+    // Lê a geometria das malhas que ainda não a têm. Caminhos relativos são resolvidos
+    // a partir do diretório de 'scene_path'.
+    bool load_meshes(const std::string& scene_path, std::string& error);
+
+    // Abre as texturas que ainda não foram abertas em 'cache', com os caminhos relativos
+    // resolvidos como em load_meshes. Até lá, os materiais com textura usam a cor albedo.
+    bool open_textures(const std::string& scene_path, const shared_ptr<texture_cache>& cache,
+                       std::string& error);
+
+    // Passa a usar os arrays de um arquivo binário já validado
+    void attach(mapped_file&& f, const scene_material* m, size_t material_n,
+                const scene_sphere* s, size_t sphere_n);
+
+public:
+    scene_camera cam;
+
+private:
+    // Copia os arrays mapeados para a memória própria antes de uma alteração
+    void detach();
+
+    std::vector<scene_material> own_materials;
+    std::vector<scene_sphere> own_spheres;
+    std::vector<scene_mesh> own_meshes;      // Nunca mapeadas: os caminhos têm tamanho variável
+    std::vector<scene_texture> own_textures; // Idem
+
+    mapped_file file;
+    const scene_material* mapped_materials = nullptr;
+    const scene_sphere* mapped_spheres = nullptr;
+    size_t mapped_material_count = 0;
+    size_t mapped_sphere_count = 0;
+};
+
+
+inline std::uint32_t scene_data::add_lambertian(const color& albedo) {
+    scene_material m{};
+    m.kind = static_cast<std::uint32_t>(material_kind::lambertian);
+    for (int k = 0; k < 3; ++k) m.albedo[k] = albedo[k];
+    return add_material(m);
+}
+
+inline std::uint32_t scene_data::add_metal(const color& albedo, double fuzz) {
+    scene_material m{};
+    m.kind = static_cast<std::uint32_t>(material_kind::metal);
+    for (int k = 0; k < 3; ++k) m.albedo[k] = albedo[k];
+    m.fuzz = fuzz;
+    return add_material(m);
+}
+
+inline std::uint32_t scene_data::add_dielectric(double ir) {
+    scene_material m{};
+    m.kind = static_cast<std::uint32_t>(material_kind::dielectric);
+    m.ir = ir;
+    return add_material(m);
+}
+
+inline std::uint32_t scene_data::add_light(const color& emit) {
+    scene_material m{};
+    m.kind = static_cast<std::uint32_t>(material_kind::diffuse_light);
+    for (int k = 0; k < 3; ++k) m.albedo[k] = emit[k];
+    return add_material(m);
+}
+
+inline std::uint32_t scene_data::add_material(const scene_material& m) {
+    detach();
+    own_materials.push_back(m);
+    return static_cast<std::uint32_t>(own_materials.size() - 1);
+}
+
+inline void scene_data::add_sphere(const point3& center, double radius, std::uint32_t material) {
+    detach();
+    scene_sphere s{};
+    for (int k = 0; k < 3; ++k) s.center[k] = center[k];
+    s.radius = radius;
+    s.material = material;
+    own_spheres.push_back(s);
+}
+
+inline void scene_data::add_mesh(const std::string& path, std::uint32_t material,
+                                 shared_ptr<const mesh_data> geometry) {
+    own_meshes.push_back({path, material, std::move(geometry)});
+}
+
+inline std::uint32_t scene_data::add_texture(const std::string& path) {
+    own_textures.push_back({path, nullptr});
+    return static_cast<std::uint32_t>(own_textures.size() - 1);
+}
+
+inline bool scene_data::load_meshes(const std::string& scene_path, std::string& error) {
+    const auto slash = scene_path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "" : scene_path.substr(0, slash + 1);
+    std::unordered_map<std::string, shared_ptr<const mesh_data>> loaded;
+    for (scene_mesh& m : own_meshes) {
+        if (m.geometry) continue;
+        const std::string path = m.path.empty() || m.path[0] == '/' ? m.path : directory + m.path;
+        auto& geometry = loaded[path];
+        if (!geometry) {
+            auto data = make_shared<mesh_data>();
+            if (!load_mesh(path, *data, error)) return false;
+            geometry = std::move(data);
+        }
+        m.geometry = geometry;
+    }
+    return true;
+}
+
+inline bool scene_data::open_textures(const std::string& scene_path, const shared_ptr<texture_cache>& cache,
+                                      std::string& error) {
+    const auto slash = scene_path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "" : scene_path.substr(0, slash + 1);
+    for (scene_texture& t : own_textures) {
+        if (t.image) continue;
+        const std::string path = t.path.empty() || t.path[0] == '/' ? t.path : directory + t.path;
+        const int index = cache->open(path, error);
+        if (index < 0) return false;
+        t.image = make_shared<image_texture>(cache, index);
+    }
+    return true;
+}
+
+inline void scene_data::reserve(size_t materials, size_t spheres) {
+    detach();
+    own_materials.reserve(materials);
+    own_spheres.reserve(spheres);
+}
+
+inline void scene_data::clear() {
+    file.close();
+    own_materials.clear();
+    own_spheres.clear();
+    own_meshes.clear();
+    own_textures.clear();
+    mapped_material_count = mapped_sphere_count = 0;
+    cam = scene_camera();
+}
+
+inline void scene_data::attach(mapped_file&& f, const scene_material* m, size_t material_n,
+                               const scene_sphere* s, size_t sphere_n) {
+    own_materials.clear();
+    own_spheres.clear();
+    file = std::move(f);
+    mapped_materials = m;
+    mapped_material_count = material_n;
+    mapped_spheres = s;
+    mapped_sphere_count = sphere_n;
+}
+
+inline void scene_data::detach() {
+    if (!file.data()) return;
+    own_materials.assign(mapped_materials, mapped_materials + mapped_material_count);
+    own_spheres.assign(mapped_spheres, mapped_spheres + mapped_sphere_count);
+    file.close();
+}
+
+
+// Confere os parâmetros da câmera; retorna a descrição do problema, ou nulo. Um aspecto
+// nulo, por exemplo, faria a altura da imagem ser uma divisão por zero.
+inline const char* camera_error(const scene_camera& c) {
+    for (int k = 0; k < 3; ++k)
+        if (!std::isfinite(c.lookfrom[k]) || !std::isfinite(c.lookat[k]) || !std::isfinite(c.vup[k]))
+            return "posição ou orientação da câmera não é um número finito";
+    if (!(c.vfov > 0 && c.vfov < 180)) return "'vfov' precisa estar entre 0 e 180 graus";
+    if (!(c.aspect_ratio > 0) || !std::isfinite(c.aspect_ratio)) return "'aspect' precisa ser positivo";
+    if (!(c.aperture >= 0) || !std::isfinite(c.aperture)) return "'aperture' não pode ser negativa";
+    if (!(c.focus_dist > 0) || !std::isfinite(c.focus_dist)) return "'focus' precisa ser positivo";
+    return nullptr;
+}
+
+// Confere a câmera, as esferas, os índices e os tipos de material. 'error' recebe a
+// descrição do problema.
+inline bool validate_scene(const scene_data& scene, std::string& error) {
+    if (const char* problem = camera_error(scene.cam)) {
+        error = problem;
+        return false;
+    }
+    const scene_material* materials = scene.materials();
+    for (size_t k = 0; k < scene.material_count(); ++k) {
+        if (materials[k].kind > static_cast<std::uint32_t>(material_kind::diffuse_light)) {
+            error = "material " + std::to_string(k) + " com tipo desconhecido";
+            return false;
+        }
+        if (materials[k].texture > scene.texture_count()) {
+            error = "material " + std::to_string(k) + " usa uma textura inexistente";
+            return false;
+        }
+    }
+    const scene_sphere* spheres = scene.spheres();
+    const auto material_count = scene.material_count();
+    for (size_t k = 0; k < scene.sphere_count(); ++k) {
+        if (spheres[k].material >= material_count) {
+            error = "esfera " + std::to_string(k) + " usa um material inexistente";
+            return false;
+        }
+        const scene_sphere& sphere = spheres[k];
+        if (!(sphere.radius > 0) || !std::isfinite(sphere.radius) || !std::isfinite(sphere.center[0])
+            || !std::isfinite(sphere.center[1]) || !std::isfinite(sphere.center[2])) {
+            error = "esfera " + std::to_string(k) + " com centro ou raio inválido";
+            return false;
+        }
+    }
+    for (size_t k = 0; k < scene.mesh_count(); ++k) {
+        if (scene.meshes()[k].material >= material_count) {
+            error = "malha " + std::to_string(k) + " usa um material inexistente";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Cria os materiais da cena na arena e retorna o índice do primeiro; o material k da
+// cena fica no índice base + k.
+inline std::uint32_t build_materials(const scene_data& scene, material_arena& materials) {
+    const auto base = static_cast<std::uint32_t>(materials.size());
+    for (size_t k = 0; k < scene.material_count(); ++k) {
+        const scene_material& m = scene.materials()[k];
+        const color albedo(m.albedo[0], m.albedo[1], m.albedo[2]);
+        shared_ptr<const texture> image = m.texture ? scene.textures()[m.texture - 1].image : nullptr;
+        switch (static_cast<material_kind>(m.kind)) {
+            case material_kind::lambertian:
+                if (image) materials.make<lambertian>(std::move(image));
+                else materials.make<lambertian>(albedo);
+                break;
+            case material_kind::metal:
+                if (image) materials.make<metal>(std::move(image), m.fuzz);
+                else materials.make<metal>(albedo, m.fuzz);
+                break;
+            case material_kind::diffuse_light: materials.make<diffuse_light>(albedo); break;
+            default:                        materials.make<dielectric>(m.ir); break;
+        }
+    }
+    return base;
+}
+
+// Acrescenta a 'world' as malhas cuja geometria já foi lida
+inline void add_scene_meshes(const scene_data& scene, std::uint32_t base, hittable_list& world) {
+    for (size_t k = 0; k < scene.mesh_count(); ++k) {
+        const scene_mesh& m = scene.meshes()[k];
+        if (m.geometry && m.geometry->triangle_count() > 0)
+            world.add(make_shared<triangle_mesh>(m.geometry, base + m.material));
+    }
+}
+
+// Cria os objetos da cena. Os materiais da descrição são acrescentados à arena, na
+// mesma ordem, e cada esfera guarda o índice do seu material na arena.
+inline hittable_list build_world(const scene_data& scene, material_arena& materials) {
+    const auto base = build_materials(scene, materials);
+
+    hittable_list world;
+    world.objects.reserve(scene.sphere_count() + scene.mesh_count());
+    for (size_t k = 0; k < scene.sphere_count(); ++k) {
+        const scene_sphere& s = scene.spheres()[k];
+        world.add(make_shared<sphere>(point3(s.center[0], s.center[1], s.center[2]), s.radius,
+                                      base + s.material));
+    }
+    add_scene_meshes(scene, base, world);
+    return world;
+}
+
+// 'time0' e 'time1' são os tempos de abertura e fechamento do obturador
+inline camera make_camera(const scene_camera& c, double time0 = 0, double time1 = 0) {
+    return camera(point3(c.lookfrom[0], c.lookfrom[1], c.lookfrom[2]),
+                  point3(c.lookat[0], c.lookat[1], c.lookat[2]),
+                  vec3(c.vup[0], c.vup[1], c.vup[2]),
+                  c.vfov, c.aspect_ratio, c.aperture, c.focus_dist, time0, time1);
+}
+
+
+// Formato binário ----------------------------------------------------------------------
+
+struct scene_file_header {
+    char magic[8];                  // "RTSCENE1"
+    std::uint32_t version;          // Versão do formato
+    std::uint32_t reserved;
+    scene_camera cam;               // Parâmetros da câmera
+    std::uint64_t material_count;
+    std::uint64_t sphere_count;
+    std::uint64_t material_offset;  // scene_material[material_count]
+    std::uint64_t sphere_offset;    // scene_sphere[sphere_count]
+    std::uint64_t file_size;        // Tamanho total, para detectar arquivos truncados
+    std::uint64_t mesh_count;
+    std::uint64_t mesh_offset;      // scene_mesh_record[mesh_count]
+    std::uint64_t texture_count;
+    std::uint64_t texture_offset;   // scene_texture_record[texture_count]
+};
+
+// Malha no arquivo binário: o material e o caminho, sem o terminador
+struct scene_mesh_record {
+    std::uint32_t material;
+    std::uint32_t path_length;
+    char path[248];
+};
+
+// Textura no arquivo binário: o caminho, sem o terminador
+struct scene_texture_record {
+    std::uint32_t path_length;
+    std::uint32_t reserved;
+    char path[248];
+};
+
+static_assert(sizeof(scene_mesh_record) == 256, "layout do formato binário");
+static_assert(sizeof(scene_texture_record) == 256, "layout do formato binário");
+
+// A versão 2 acrescentou as malhas e as texturas; a versão 1 não é mais lida
+constexpr std::uint32_t scene_file_version = 2;
+
+// Preenche os deslocamentos das seções e o tamanho do arquivo a partir das contagens
+inline void scene_file_layout(scene_file_header& header) {
+    auto align64 = [](std::uint64_t x) { return (x + 63) & ~std::uint64_t(63); };
+    header.material_offset = align64(sizeof(scene_file_header));
+    header.sphere_offset = align64(header.material_offset + header.material_count * sizeof(scene_material));
+    header.mesh_offset = align64(header.sphere_offset + header.sphere_count * sizeof(scene_sphere));
+    header.texture_offset = align64(header.mesh_offset + header.mesh_count * sizeof(scene_mesh_record));
+    header.file_size = header.texture_offset + header.texture_count * sizeof(scene_texture_record);
+}
+
+inline bool save_scene_binary(const std::string& path, const scene_data& scene) {
+    scene_file_header header{};
+    std::memcpy(header.magic, "RTSCENE1", 8);
+    header.version = scene_file_version;
+    header.cam = scene.cam;
+    header.material_count = scene.material_count();
+    header.sphere_count = scene.sphere_count();
+    header.mesh_count = scene.mesh_count();
+    header.texture_count = scene.texture_count();
+    scene_file_layout(header);
+
+    std::vector<scene_mesh_record> records(scene.mesh_count());
+    for (size_t k = 0; k < records.size(); ++k) {
+        const scene_mesh& m = scene.meshes()[k];
+        if (m.path.size() > sizeof(records[k].path)) return false;
+        records[k].material = m.material;
+        records[k].path_length = static_cast<std::uint32_t>(m.path.size());
+        std::memcpy(records[k].path, m.path.data(), m.path.size());
+    }
+    std::vector<scene_texture_record> texture_records(scene.texture_count());
+    for (size_t k = 0; k < texture_records.size(); ++k) {
+        const scene_texture& t = scene.textures()[k];
+        if (t.path.size() > sizeof(texture_records[k].path)) return false;
+        texture_records[k].path_length = static_cast<std::uint32_t>(t.path.size());
+        std::memcpy(texture_records[k].path, t.path.data(), t.path.size());
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    auto write_at = [&](std::uint64_t offset, const void* data, std::uint64_t n) {
+        static const char zeros[64] = {};
+        const auto pos = static_cast<std::uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(offset - pos));
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(n));
+    };
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_at(header.material_offset, scene.materials(), header.material_count * sizeof(scene_material));
+    write_at(header.sphere_offset, scene.spheres(), header.sphere_count * sizeof(scene_sphere));
+    write_at(header.mesh_offset, records.data(), records.size() * sizeof(scene_mesh_record));
+    write_at(header.texture_offset, texture_records.data(),
+             texture_records.size() * sizeof(scene_texture_record));
+    return static_cast<bool>(out.flush());
+}
+
+// Mapeia um arquivo binário; os arrays da cena passam a apontar para o mapeamento
+inline bool load_scene_binary(const std::string& path, scene_data& scene, std::string& error) {
+    mapped_file file;
+    if (!file.open(path)) {
+        error = "não foi possível abrir " + path;
+        return false;
+    }
+    scene_file_header header;
+    if (file.size() < sizeof(header)) {
+        error = path + ": arquivo truncado";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, "RTSCENE1", 8) != 0 || header.version != scene_file_version) {
+        error = path + ": formato ou versão desconhecidos";
+        return false;
+    }
+
+    scene_file_header expected = header;
+    const std::uint64_t max_count = file.size() / sizeof(scene_sphere);
+    if (header.material_count <= max_count && header.sphere_count <= max_count
+        && header.mesh_count <= max_count && header.texture_count <= max_count)
+        scene_file_layout(expected);
+    if (header.material_count > max_count || header.sphere_count > max_count
+        || header.mesh_count > max_count || header.texture_count > max_count
+        || std::memcmp(&header, &expected, sizeof(header)) != 0 || header.file_size != file.size()) {
+        error = path + ": arquivo truncado ou corrompido";
+        return false;
+    }
+
+    const char* base = file.data();
+    scene.clear();
+    scene.cam = header.cam;
+    scene.attach(std::move(file),
+                 reinterpret_cast<const scene_material*>(base + header.material_offset),
+                 static_cast<size_t>(header.material_count),
+                 reinterpret_cast<const scene_sphere*>(base + header.sphere_offset),
+                 static_cast<size_t>(header.sphere_count));
+    for (std::uint64_t k = 0; k < header.mesh_count; ++k) {
+        scene_mesh_record record;
+        std::memcpy(&record, base + header.mesh_offset + k * sizeof(record), sizeof(record));
+        if (record.path_length > sizeof(record.path)) {
+            error = path + ": malha " + std::to_string(k) + " com caminho inválido";
+            scene.clear();
+            return false;
+        }
+        scene.add_mesh(std::string(record.path, record.path_length), record.material);
+    }
+    for (std::uint64_t k = 0; k < header.texture_count; ++k) {
+        scene_texture_record record;
+        std::memcpy(&record, base + header.texture_offset + k * sizeof(record), sizeof(record));
+        if (record.path_length > sizeof(record.path)) {
+            error = path + ": textura " + std::to_string(k) + " com caminho inválido";
+            scene.clear();
+            return false;
+        }
+        scene.add_texture(std::string(record.path, record.path_length));
+    }
+    if (!validate_scene(scene, error) || !scene.load_meshes(path, error)) {
+        error = path + ": " + error;
+        scene.clear();
+        return false;
+    }
+    return true;
+}
+
+
+// Formato texto ------------------------------------------------------------------------
+
+// Acrescenta um double com o menor número de dígitos que o relê exatamente
+inline void append_double(std::string& out, double x) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), x);
+    out.append(buffer, result.ptr);
+}
+
+inline bool save_scene_text(const std::string& path, const scene_data& scene) {
+    std::string out;
+    out.reserve(64 + scene.material_count() * 48 + scene.sphere_count() * 56);
+    out += "# Cena do ray tracer\n";
+
+    auto triple = [&](const char* key, const double* v) {
+        out += ' '; out += key;
+        for (int k = 0; k < 3; ++k) { out += ' '; append_double(out, v[k]); }
+    };
+    auto single = [&](const char* key, double v) {
+        out += ' '; out += key; out += ' ';
+        append_double(out, v);
+    };
+
+    const scene_camera& c = scene.cam;
+    out += "camera";
+    triple("lookfrom", c.lookfrom);
+    triple("lookat", c.lookat);
+    triple("vup", c.vup);
+    single("vfov", c.vfov);
+    single("aspect", c.aspect_ratio);
+    single("aperture", c.aperture);
+    single("focus", c.focus_dist);
+    out += '\n';
+
+    // As texturas e os materiais são nomeados pelo índice (t0, m0, ...) e quem os usa
+    // dá o número
+    for (size_t k = 0; k < scene.texture_count(); ++k) {
+        out += "texture t";
+        out += std::to_string(k);
+        out += ' ';
+        out += scene.textures()[k].path;
+        out += '\n';
+    }
+
+    for (size_t k = 0; k < scene.material_count(); ++k) {
+        const scene_material& m = scene.materials()[k];
+        switch (static_cast<material_kind>(m.kind)) {
+            case material_kind::lambertian: out += "lambertian"; break;
+            case material_kind::metal:      out += "metal"; break;
+            case material_kind::diffuse_light: out += "light"; break;
+            default:                        out += "dielectric"; break;
+        }
+        out += " m";
+        out += std::to_string(k);
+        if (static_cast<material_kind>(m.kind) == material_kind::dielectric) {
+            out += ' ';
+            append_double(out, m.ir);
+        } else if (m.texture && static_cast<material_kind>(m.kind) != material_kind::diffuse_light) {
+            out += " texture ";
+            out += std::to_string(m.texture - 1);
+            if (static_cast<material_kind>(m.kind) == material_kind::metal) {
+                out += ' ';
+                append_double(out, m.fuzz);
+            }
+        } else {
+            for (int i = 0; i < 3; ++i) { out += ' '; append_double(out, m.albedo[i]); }
+            if (static_cast<material_kind>(m.kind) == material_kind::metal) {
+                out += ' ';
+                append_double(out, m.fuzz);
+            }
+        }
+        out += '\n';
+    }
+
+    for (size_t k = 0; k < scene.sphere_count(); ++k) {
+        const scene_sphere& s = scene.spheres()[k];
+        out += "sphere";
+        for (int i = 0; i < 3; ++i) { out += ' '; append_double(out, s.center[i]); }
+        out += ' ';
+        append_double(out, s.radius);
+        out += ' ';
+        out += std::to_string(s.material);
+        out += '\n';
+    }
+
+    for (size_t k = 0; k < scene.mesh_count(); ++k) {
+        const scene_mesh& m = scene.meshes()[k];
+        out += "mesh ";
+        out += m.path;
+        out += ' ';
+        out += std::to_string(m.material);
+        out += '\n';
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    return file.write(out.data(), static_cast<std::streamsize>(out.size())) && file.flush();
+}
+
+// Lê o formato texto. O arquivo é mapeado e percorrido linha a linha; os números são
+// convertidos com from_chars, sem passar por streams.
+inline bool load_scene_text(const std::string& path, scene_data& scene, std::string& error) {
+    mapped_file file;
+    if (!file.open(path)) {
+        error = "não foi possível abrir " + path;
+        return false;
+    }
+
+    scene.clear();
+    // O mapa de nomes só é montado quando alguma esfera usa um nome; arquivos que
+    // referenciam os materiais pelo número (como os gravados por save_scene_text) não
+    // pagam o custo de um milhão de inserções.
+    std::vector<std::string_view> material_names;               // Apontam para o mapeamento
+    std::unordered_map<std::string_view, std::uint32_t> names;
+    size_t named = 0;                                            // Nomes já inseridos no mapa
+    std::vector<std::string_view> texture_names;                 // Poucas: busca linear
+
+    const char* p = file.data();
+    const char* end = p + file.size();
+    size_t line_number = 0;
+
+    constexpr int max_tokens = 32;
+    std::string_view tokens[max_tokens];
+
+    auto fail = [&](const std::string& message) {
+        error = path + ":" + std::to_string(line_number) + ": " + message;
+        scene.clear();
+        return false;
+    };
+
+    while (p < end) {
+        ++line_number;
+        const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!line_end) line_end = end;
+
+        // Separa a linha em palavras, ignorando comentários
+        int n = 0;
+        const char* q = p;
+        while (q < line_end && *q != '#') {
+            if (*q == ' ' || *q == '\t' || *q == '\r') { ++q; continue; }
+            const char* start = q;
+            while (q < line_end && *q != ' ' && *q != '\t' && *q != '\r' && *q != '#') ++q;
+            if (n == max_tokens) return fail("linha longa demais");
+            tokens[n++] = std::string_view(start, q - start);
+        }
+        p = line_end + 1;
+        if (n == 0) continue;
+
+        auto number = [&](int index, double& value) {
+            const std::string_view t = tokens[index];
+            const char* first = t.data();
+            if (!t.empty() && t[0] == '+') ++first;
+            auto result = std::from_chars(first, t.data() + t.size(), value);
+            return result.ec == std::errc() && result.ptr == t.data() + t.size() && std::isfinite(value);
+        };
+        auto numbers = [&](int first, int count, double* values) {
+            for (int k = 0; k < count; ++k)
+                if (!number(first + k, values[k])) return false;
+            return true;
+        };
+        auto define = [&](std::string_view name, const scene_material& m) {
+            if (name[0] >= '0' && name[0] <= '9') return false;
+            scene.add_material(m);
+            material_names.push_back(name);
+            return true;
+        };
+        auto resolve = [&](std::string_view name, std::uint32_t& index) {
+            if (name[0] >= '0' && name[0] <= '9') {
+                auto result = std::from_chars(name.data(), name.data() + name.size(), index);
+                return result.ec == std::errc() && result.ptr == name.data() + name.size()
+                    && index < material_names.size();
+            }
+            for (; named < material_names.size(); ++named)
+                names.emplace(material_names[named], static_cast<std::uint32_t>(named));
+            auto it = names.find(name);
+            if (it == names.end()) return false;
+            index = it->second;
+            return true;
+        };
+
+        auto resolve_texture = [&](std::string_view name, std::uint32_t& index) {
+            if (name[0] >= '0' && name[0] <= '9') {
+                auto result = std::from_chars(name.data(), name.data() + name.size(), index);
+                return result.ec == std::errc() && result.ptr == name.data() + name.size()
+                    && index < texture_names.size();
+            }
+            for (size_t k = 0; k < texture_names.size(); ++k) {
+                if (texture_names[k] == name) {
+                    index = static_cast<std::uint32_t>(k);
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        const std::string_view command = tokens[0];
+        if (command == "sphere") {
+            double v[4];
+            if (n != 6 || !numbers(1, 4, v))
+                return fail("esperado 'sphere x y z raio material'");
+            std::uint32_t material;
+            if (!resolve(tokens[5], material))
+                return fail("material '" + std::string(tokens[5]) + "' não definido");
+            if (v[3] <= 0)
+                return fail("o raio da esfera precisa ser positivo");
+            scene.add_sphere(point3(v[0], v[1], v[2]), v[3], material);
+        } else if (command == "mesh") {
+            if (n != 3)
+                return fail("esperado 'mesh caminho material'");
+            std::uint32_t material;
+            if (!resolve(tokens[2], material))
+                return fail("material '" + std::string(tokens[2]) + "' não definido");
+            scene.add_mesh(std::string(tokens[1]), material);
+        } else if (command == "texture") {
+            if (n != 3)
+                return fail("esperado 'texture nome caminho'");
+            if (tokens[1][0] >= '0' && tokens[1][0] <= '9')
+                return fail("nome de textura não pode começar com dígito");
+            scene.add_texture(std::string(tokens[2]));
+            texture_names.push_back(tokens[1]);
+        } else if ((command == "lambertian" || command == "metal") && n >= 3 && tokens[2] == "texture") {
+            const bool is_metal = command == "metal";
+            scene_material m{};
+            m.kind = static_cast<std::uint32_t>(is_metal ? material_kind::metal : material_kind::lambertian);
+            std::uint32_t image;
+            if (n != (is_metal ? 5 : 4) || (is_metal && !number(4, m.fuzz)))
+                return fail(is_metal ? "esperado 'metal nome texture textura fuzz'"
+                                     : "esperado 'lambertian nome texture textura'");
+            if (!resolve_texture(tokens[3], image))
+                return fail("textura '" + std::string(tokens[3]) + "' não definida");
+            m.texture = image + 1;
+            if (!define(tokens[1], m))
+                return fail("nome de material não pode começar com dígito");
+        } else if (command == "lambertian" || command == "metal" || command == "light") {
+            const bool is_metal = command == "metal";
+            const int expected = is_metal ? 6 : 5;
+            scene_material m{};
+            m.kind = static_cast<std::uint32_t>(is_metal ? material_kind::metal
+                                              : command == "light" ? material_kind::diffuse_light
+                                              : material_kind::lambertian);
+            if (n != expected || !numbers(2, 3, m.albedo) || (is_metal && !number(5, m.fuzz)))
+                return fail(is_metal ? "esperado 'metal nome r g b fuzz'"
+                                     : "esperado '" + std::string(command) + " nome r g b'");
+            if (!define(tokens[1], m))
+                return fail("nome de material não pode começar com dígito");
+        } else if (command == "dielectric") {
+            scene_material m{};
+            m.kind = static_cast<std::uint32_t>(material_kind::dielectric);
+            if (n != 3 || !number(2, m.ir))
+                return fail("esperado 'dielectric nome índice_de_refração'");
+            if (!define(tokens[1], m))
+                return fail("nome de material não pode começar com dígito");
+        } else if (command == "camera") {
+            scene_camera& c = scene.cam;
+            for (int k = 1; k < n; ) {
+                const std::string_view key = tokens[k];
+                double* target = nullptr;
+                int count = 1;
+                if (key == "lookfrom")      { target = c.lookfrom; count = 3; }
+                else if (key == "lookat")   { target = c.lookat; count = 3; }
+                else if (key == "vup")      { target = c.vup; count = 3; }
+                else if (key == "vfov")     target = &c.vfov;
+                else if (key == "aspect")   target = &c.aspect_ratio;
+                else if (key == "aperture") target = &c.aperture;
+                else if (key == "focus")    target = &c.focus_dist;
+                else return fail("parâmetro de câmera desconhecido '" + std::string(key) + "'");
+                if (k + count >= n || !numbers(k + 1, count, target))
+                    return fail("valor inválido para '" + std::string(key) + "'");
+                k += 1 + count;
+            }
+            if (const char* problem = camera_error(c))
+                return fail(problem);
+        } else {
+            return fail("comando desconhecido '" + std::string(command) + "'");
+        }
+    }
+    if (!scene.load_meshes(path, error)) {
+        error = path + ": " + error;
+        scene.clear();
+        return false;
+    }
+    return true;
+}
+
+// Escolhe o formato pelo conteúdo: arquivos que começam com "RTSCENE1" são binários
+inline bool load_scene(const std::string& path, scene_data& scene, std::string& error) {
+    char magic[8] = {};
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "não foi possível abrir " + path;
+        return false;
+    }
+    in.read(magic, sizeof(magic));
+    if (in.gcount() == sizeof(magic) && std::memcmp(magic, "RTSCENE1", 8) == 0)
+        return load_scene_binary(path, scene, error);
+    return load_scene_text(path, scene, error);
+}
+
+// Escolhe o formato pela extensão: .scnb grava o binário, o resto grava texto
+inline bool save_scene(const std::string& path, const scene_data& scene) {
+    const std::string ext = ".scnb";
+    if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+        return save_scene_binary(path, scene);
+    return save_scene_text(path, scene);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fila dupla de tarefas de um worker. O dono consome pela frente (mantendo a ordem
+// de Morton dos tiles) e os outros workers roubam pelo fundo, ou seja, a região da
+// imagem mais distante daquela em que o dono está trabalhando.
+class work_stealing_deque {
+public:
+    void push(int task) {
+        std::lock_guard<std::mutex> lock(m);
+        tasks.push_back(task);
+    }
+
+    // Retira a próxima tarefa do próprio worker.
+    bool pop(int& task) {
+        std::lock_guard<std::mutex> lock(m);
+        if (tasks.empty()) return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+    // Rouba uma tarefa de outro worker.
+    bool steal(int& task) {
+        std::lock_guard<std::mutex> lock(m);
+        if (tasks.empty()) return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+private:
+    std::deque<int> tasks;
+    std::mutex m;
+};
+
+// Número de threads padrão: todos os núcleos disponíveis.
+inline int default_thread_count() {
+    auto n = static_cast<int>(std::thread::hardware_concurrency());
+    return n > 0 ? n : 1;
+}
+
+// Executa body(tarefa, worker) para cada tarefa em [0, task_count) usando thread_count
+// workers. Cada worker recebe inicialmente um bloco contíguo de tarefas e, quando o seu
+// acaba, passa a roubar dos outros. Como nenhuma tarefa gera novas tarefas, o worker
+// termina quando não encontra nada para roubar.
+template <typename Body>
+void parallel_for_work_stealing(int task_count, int thread_count, Body body) {
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > task_count) thread_count = task_count > 0 ? task_count : 1;
+
+    if (thread_count == 1) {
+        for (int t = 0; t < task_count; ++t)
+            body(t, 0);
+        return;
+    }
+
+    std::vector<work_stealing_deque> queues(thread_count);
+    for (int w = 0; w < thread_count; ++w) {
+        int begin = static_cast<int>(static_cast<long long>(task_count) * w / thread_count);
+        int end = static_cast<int>(static_cast<long long>(task_count) * (w + 1) / thread_count);
+        for (int t = begin; t < end; ++t)
+            queues[w].push(t);
+    }
+
+    auto worker = [&](int id) {
+        int task;
+        for (;;) {
+            if (queues[id].pop(task)) {
+                body(task, id);
+                continue;
+            }
+
+            bool stolen = false;
+            for (int k = 1; k < thread_count && !stolen; ++k)
+                stolen = queues[(id + k) % thread_count].steal(task);
+            if (!stolen) return;
+            body(task, id);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (int w = 1; w < thread_count; ++w)
+        threads.emplace_back(worker, w);
+    worker(0);  // A thread chamadora também trabalha
+    for (auto& th : threads)
+        th.join();
+}
+
+// Pool de workers permanentes, compartilhado por várias renderizações ao mesmo tempo. Cada
+// chamada de run() entra como um lote de tarefas com uma prioridade; um worker livre pega
+// a próxima tarefa do lote de maior prioridade e, entre lotes de mesma prioridade, do mais
+// antigo, então os jobs de mesma prioridade terminam na ordem em que chegaram e um job
+// urgente passa na frente dos outros a partir do próximo tile.
+//
+// Dentro de um lote as tarefas saem em ordem, de um contador: os tiles estão em ordem de
+// Morton, então workers que pegam tarefas seguidas ficam em regiões vizinhas da imagem.
+class worker_pool {
+public:
+    explicit worker_pool(int thread_count = default_thread_count());
+    ~worker_pool();
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    int size() const { return static_cast<int>(threads.size()); }
+
+    // Executa body(tarefa, worker) para cada tarefa em [0, task_count), com worker em
+    // [0, size()), e retorna quando todas terminaram. Quem chama só espera; não pode ser
+    // uma tarefa do próprio pool. Depois de shutdown() o lote é recusado: nenhuma tarefa
+    // roda e o retorno é false.
+    bool run(int task_count, int priority, const std::function<void(int, int)>& body);
+
+    // Para de aceitar lotes, espera os já aceitos terminarem e encerra os workers. Pode
+    // ser chamada mais de uma vez, mas não de uma tarefa do próprio pool; o destrutor
+    // também chama.
+    void shutdown();
+    bool is_shut_down() const;
+
+    // Pool usado quando ninguém indica outro, criado no primeiro uso com um worker por
+    // núcleo. Não é destruído: no fim do programa só é encerrado (shutdown), para que um
+    // job ainda rodando durante a destruição dos estáticos receba recusas em vez de usar
+    // um pool que já não existe.
+    static worker_pool& global() {
+        static worker_pool* pool = [] {
+            auto created = new worker_pool;
+            std::atexit([] { global().shutdown(); });
+            return created;
+        }();
+        return *pool;
+    }
+
+private:
+    struct batch {
+        int priority;
+        std::uint64_t order;      // Ordem de chegada, para desempatar
+        int task_count;
+        int next = 0;             // Próxima tarefa a começar
+        int remaining;            // Tarefas ainda não terminadas
+        const std::function<void(int, int)>* body;
+        std::condition_variable finished;
+    };
+
+    void worker_loop(int id);
+
+    std::vector<std::thread> threads;
+    mutable std::mutex m;
+    std::condition_variable work;
+    std::vector<batch*> pending;  // Lotes com tarefas ainda não começadas
+    std::uint64_t arrivals = 0;
+    bool stopping = false;
+};
+
+// Laço paralelo no pool, se houver, ou em thread_count threads criadas só para ele.
+// Retorna false se o pool recusou o lote (ver worker_pool::shutdown).
+template <typename Body>
+bool parallel_for(worker_pool* pool, int priority, int task_count, int thread_count, Body body) {
+    if (pool)
+        return pool->run(task_count, priority, body);
+    parallel_for_work_stealing(task_count, thread_count, body);
+    return true;
+}
+
+// Quantos índices de worker o corpo de parallel_for pode receber
+inline int worker_count(const worker_pool* pool, int thread_count) {
+    return pool ? pool->size() : std::max(thread_count, 1);
+}
+
+
+inline worker_pool::worker_pool(int thread_count) {
+    threads.reserve(std::max(thread_count, 1));
+    for (int w = 0; w < std::max(thread_count, 1); ++w)
+        threads.emplace_back([this, w] { worker_loop(w); });
+}
+
+inline worker_pool::~worker_pool() {
+    shutdown();
+}
+
+inline void worker_pool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    work.notify_all();
+    // Os workers só saem com a fila vazia, então os lotes aceitos terminam antes
+    for (auto& th : threads)
+        if (th.joinable()) th.join();
+}
+
+inline bool worker_pool::is_shut_down() const {
+    std::lock_guard<std::mutex> lock(m);
+    return stopping;
+}
+
+inline bool worker_pool::run(int task_count, int priority, const std::function<void(int, int)>& body) {
+    if (task_count <= 0) return true;
+    batch b;
+    b.priority = priority;
+    b.task_count = task_count;
+    b.remaining = task_count;
+    b.body = &body;
+
+    std::unique_lock<std::mutex> lock(m);
+    if (stopping) return false;
+    b.order = arrivals++;
+    pending.push_back(&b);
+    work.notify_all();
+    b.finished.wait(lock, [&] { return b.remaining == 0; });
+    return true;
+}
+
+inline void worker_pool::worker_loop(int id) {
+    std::unique_lock<std::mutex> lock(m);
+    for (;;) {
+        work.wait(lock, [&] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+
+        auto best = std::min_element(pending.begin(), pending.end(), [](const batch* a, const batch* b) {
+            return a->priority != b->priority ? a->priority > b->priority : a->order < b->order;
+        });
+        batch& b = **best;
+        const int task = b.next++;
+        if (b.next == b.task_count) pending.erase(best);
+
+        lock.unlock();
+        (*b.body)(task, id);
+        lock.lock();
+        // Quem espera em run() só acorda depois que a trava for solta, e o lote (que
+        // vive na pilha dele) não é mais tocado depois disso
+        if (--b.remaining == 0) b.finished.notify_all();
+    }
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define RT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Conjuntos de instruções disponíveis para os testes em lote (ver sphere_set e
+// triangle_mesh). As versões vetoriais são compiladas com atributos 'target' e
+// escolhidas em tempo de execução, sem exigir -mavx2 no programa inteiro.
+enum class simd_level { scalar, avx2, avx512 };
+
+inline const char* simd_level_name(simd_level level) {
+    switch (level) {
+        case simd_level::avx512: return "avx512";
+        case simd_level::avx2:   return "avx2";
+        default:                 return "escalar";
+    }
+}
+
+// Melhor conjunto de instruções suportado pela CPU em que o programa está rodando.
+inline simd_level detect_simd_level() {
+#ifdef RT_SIMD_X86
+    if (__builtin_cpu_supports("avx512f")) return simd_level::avx512;
+    if (__builtin_cpu_supports("avx2")) return simd_level::avx2;
+#endif
+    return simd_level::scalar;
+}
+
+#endif
@@ -4,40 +4,76 @@
 #include "rtweekend.h"  // Inclui o cabeçalho "rtweekend.h"
 
 #include "hittable.h"  // Inclui o cabeçalho "hittable.h"
+#include "stats.h"     // Contadores opcionais (RT_STATS)
 
-class sphere : public hittable {
+#include <type_traits>  // Para escolher as fórmulas de float ou double
+#include <utility>      // Para std::swap
+
+class sphere final : public hittable {
 public:
     sphere() {}  // Construtor padrão
 
     // Construtor da esfera com centro, raio e material
-    sphere(point3 cen, double r, shared_ptr<material> m)
-        : center(cen), radius(r), mat_ptr(m) {};
+    sphere(point3 cen, real r, std::uint32_t m)
+        : center(cen), radius(r), mat_id(m) {};
 
     // Implementação da função de interseção da esfera
-    virtual bool hit(const ray& r, double t_min, double t_max, hit_record& rec) const override;
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+
+    // Caixa delimitadora da esfera
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override;
 
 public:
     point3 center;  // Centro da esfera
-    double radius;  // Raio da esfera
-    shared_ptr<material> mat_ptr;  // Ponteiro para o material da esfera
+    real radius;    // Raio da esfera
+    std::uint32_t mat_id;  // Índice do material da esfera na material_arena
 };
 
-// Implementação da função de interseção da esfera
-bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) const {
+// Parâmetros t em que o raio entra e sai da esfera de centro 'center' e raio 'radius';
+// false se o raio passa longe.
+inline bool sphere_roots(const point3& center, real radius, const ray& r,
+                         real& near_root, real& far_root) {
+    RT_STAT(primitive_tests++);
     vec3 oc = r.origin() - center;  // Vetor entre a origem do raio e o centro da esfera
     auto a = r.direction().length_squared();  // Coeficiente a da equação de interseção
     auto half_b = dot(oc, r.direction());  // Coeficiente b/2 da equação de interseção
     auto c = oc.length_squared() - radius * radius;  // Coeficiente c da equação de interseção
 
-    auto discriminant = half_b * half_b - a * c;  // Discriminante da equação de interseção
-    if (discriminant < 0) return false;  // Se o discriminante for negativo, não há interseção
+    if constexpr (std::is_same<real, float>::value) {
+        // Em float, half_b² - a·c e -half_b ± sqrtd perdem dígitos por cancelamento em
+        // esferas grandes ou distantes. O discriminante sai da componente de oc
+        // perpendicular ao raio, a·(r² - |l|²), e cada raiz é calculada pela forma que
+        // não subtrai números próximos.
+        vec3 l = oc - (half_b / a) * r.direction();
+        auto discriminant = a * (radius * radius - l.length_squared());
+        if (discriminant < 0) return false;
+        auto q = -(half_b + std::copysign(sqrt(discriminant), half_b));
+        near_root = c / q;
+        far_root = q / a;
+        if (far_root < near_root) std::swap(near_root, far_root);
+    } else {
+        auto discriminant = half_b * half_b - a * c;  // Discriminante da equação de interseção
+        if (discriminant < 0) return false;  // Se o discriminante for negativo, não há interseção
+
+        auto sqrtd = sqrt(discriminant);  // Raiz quadrada do discriminante
+        near_root = (-half_b - sqrtd) / a;
+        far_root = (-half_b + sqrtd) / a;
+    }
+    return true;
+}
 
-    auto sqrtd = sqrt(discriminant);  // Raiz quadrada do discriminante
+// Interseção de um raio com a esfera de centro 'center' e raio 'radius'. Compartilhada
+// pela esfera fixa e pela esfera em movimento, que passa o centro no tempo do raio.
+inline bool hit_sphere(const point3& center, real radius, std::uint32_t mat_id,
+                       const ray& r, real t_min, real t_max, hit_record& rec) {
+    real near_root, far_root;
+    if (!sphere_roots(center, radius, r, near_root, far_root)) return false;
 
     // Encontra a raiz mais próxima que está dentro do intervalo aceitável
-    auto root = (-half_b - sqrtd) / a;
+    auto root = near_root;
     if (root < t_min || t_max < root) {
-        root = (-half_b + sqrtd) / a;
+        root = far_root;
         if (root < t_min || t_max < root)
             return false;
     }
@@ -46,9 +82,35 @@ bool sphere::hit(const ray& r, double t_min, double t_max, hit_record& rec) cons
     rec.p = r.at(rec.t);  // Ponto de interseção
     vec3 outward_normal = (rec.p - center) / radius;  // Vetor normal à superfície da esfera
     rec.set_face_normal(r, outward_normal);  // Define o sentido normal da superfície com base no raio e no vetor normal
-    rec.mat_ptr = mat_ptr;  // Define o material da esfera para o registro de interseção
+    rec.mat_id = mat_id;  // Define o material da esfera para o registro de interseção
+    rec.local_normal = outward_normal;  // As coordenadas de textura saem dela (sphere_uv)
+    rec.uv_length = real(pi) * radius;   // v percorre meia circunferência
 
     return true;  // Há interseção
 }
 
+// Oclusão: basta uma das raízes cair no intervalo
+inline bool sphere_occludes(const point3& center, real radius, const ray& r, real t_min, real t_max) {
+    real near_root, far_root;
+    if (!sphere_roots(center, radius, r, near_root, far_root)) return false;
+    return (t_min <= near_root && near_root <= t_max) || (t_min <= far_root && far_root <= t_max);
+}
+
+// Implementação da função de interseção da esfera
+inline bool sphere::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    return hit_sphere(center, radius, mat_id, r, t_min, t_max, rec);
+}
+
+inline bool sphere::occluded(const ray& r, real t_min, real t_max) const {
+    return sphere_occludes(center, radius, r, t_min, t_max);
+}
+
+// A caixa da esfera é o cubo de lado 2*radius centrado em center
+inline bool sphere::bounding_box(double time0, double time1, aabb& output_box) const {
+    output_box = aabb(
+        center - vec3(radius, radius, radius),
+        center + vec3(radius, radius, radius));
+    return true;
+}
+
 #endif
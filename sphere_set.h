@@ -0,0 +1,595 @@
+#ifndef SPHERE_SET_H
+#define SPHERE_SET_H
+
+#include "rtweekend.h"
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "simd.h"
+#include "sphere.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Conjunto de esferas guardado como estrutura de arrays (SoA): centros, raios e
+// índices de material ficam em vetores contíguos e são testados 4 (AVX2) ou 8
+// (AVX-512) de cada vez, ou 8 e 16 quando compilado com -DRT_FLOAT. O resultado é
+// idêntico, bit a bit, ao de uma hittable_list com as mesmas esferas na mesma ordem.
+class sphere_set final : public hittable {
+public:
+    sphere_set() {}
+
+    // Adiciona uma esfera ao conjunto
+    void add(const point3& center, real radius, std::uint32_t mat_id);
+
+    int size() const { return count; }
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override;
+
+    // Força um conjunto de instruções (para comparações); por padrão usa o melhor disponível.
+    static simd_level& kernel() {
+        static simd_level level = detect_simd_level();
+        return level;
+    }
+
+public:
+    // Os arrays têm tamanho múltiplo da maior largura de vetor (8 doubles ou 16 floats)
+    static constexpr int lane_padding = 64 / sizeof(real);
+
+private:
+    // Encontra a esfera mais próxima; devolve seu índice (ou -1) e a raiz em t_hit. Com
+    // any_hit, para na primeira esfera atingida no intervalo, que não é a mais próxima.
+    template <bool any_hit>
+    int closest_scalar(const ray& r, real t_min, real t_max, real& t_hit) const;
+#ifdef RT_SIMD_X86
+    template <bool any_hit>
+    int closest_avx2(const ray& r, real t_min, real t_max, real& t_hit) const;
+    template <bool any_hit>
+    int closest_avx512(const ray& r, real t_min, real t_max, real& t_hit) const;
+#endif
+
+    template <bool any_hit>
+    int find(const ray& r, real t_min, real t_max, real& t_hit) const;
+
+private:
+    int count = 0;
+    std::vector<real> cx, cy, cz;                    // Centros
+    std::vector<real> radius;                        // Raios
+    std::vector<std::uint32_t> mat_id;               // Índices dos materiais na material_arena
+    aabb box;                                        // Caixa de todas as esferas
+};
+
+
+inline void sphere_set::add(const point3& center, real r, std::uint32_t m) {
+    // Remove o preenchimento, insere a esfera e completa de novo até múltiplo de lane_padding.
+    // O preenchimento usa centros NaN, que nunca produzem interseção.
+    cx.resize(count); cy.resize(count); cz.resize(count); radius.resize(count);
+
+    cx.push_back(center.x());
+    cy.push_back(center.y());
+    cz.push_back(center.z());
+    radius.push_back(r);
+
+    mat_id.push_back(m);
+
+    count++;
+    const int padded = (count + lane_padding - 1) / lane_padding * lane_padding;
+    const real nan = std::numeric_limits<real>::quiet_NaN();
+    cx.resize(padded, nan); cy.resize(padded, nan); cz.resize(padded, nan); radius.resize(padded, 0);
+
+    box = surrounding_box(box, aabb(center - vec3(r, r, r), center + vec3(r, r, r)));
+}
+
+template <bool any_hit>
+int sphere_set::find(const ray& r, real t_min, real t_max, real& t_hit) const {
+    switch (kernel()) {
+#ifdef RT_SIMD_X86
+        case simd_level::avx512: return closest_avx512<any_hit>(r, t_min, t_max, t_hit);
+        case simd_level::avx2:   return closest_avx2<any_hit>(r, t_min, t_max, t_hit);
+#endif
+        default:                 return closest_scalar<any_hit>(r, t_min, t_max, t_hit);
+    }
+}
+
+inline bool sphere_set::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    RT_STAT(primitive_tests += count);
+    real t_hit;
+    const int index = find<false>(r, t_min, t_max, t_hit);
+    if (index < 0) return false;
+
+    // Preenche o registro exatamente como sphere::hit
+    const point3 center(cx[index], cy[index], cz[index]);
+    rec.t = t_hit;
+    rec.p = r.at(rec.t);
+    vec3 outward_normal = (rec.p - center) / radius[index];
+    rec.set_face_normal(r, outward_normal);
+    rec.mat_id = mat_id[index];
+    rec.local_normal = outward_normal;
+    rec.uv_length = real(pi) * radius[index];
+    return true;
+}
+
+// Raio de sombra: basta uma esfera no intervalo, então os kernels param no primeiro grupo
+// de lanes com interseção em vez de percorrer o conjunto todo
+inline bool sphere_set::occluded(const ray& r, real t_min, real t_max) const {
+    RT_STAT(primitive_tests += count);
+    real t_hit;
+    return find<true>(r, t_min, t_max, t_hit) >= 0;
+}
+
+inline bool sphere_set::bounding_box(double time0, double time1, aabb& output_box) const {
+    if (count == 0) return false;
+    output_box = box;
+    return true;
+}
+
+// Versão escalar. As expressões seguem a mesma ordem de sphere::hit, inclusive a forma
+// robusta usada em float, para que os arredondamentos sejam os mesmos. Em empates vence
+// a última esfera, como na lista.
+template <bool any_hit>
+int sphere_set::closest_scalar(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const point3 o = r.origin();
+    const real a = d.length_squared();
+    int best = -1;
+
+    for (int i = 0; i < count; ++i) {
+        const real ocx = o.x() - cx[i], ocy = o.y() - cy[i], ocz = o.z() - cz[i];
+        const real half_b = ocx*d.x() + ocy*d.y() + ocz*d.z();
+        const real c = (ocx*ocx + ocy*ocy + ocz*ocz) - radius[i]*radius[i];
+
+        real near_root, far_root;
+        if constexpr (std::is_same<real, float>::value) {
+            const real k = half_b / a;
+            const real lx = ocx - k*d.x(), ly = ocy - k*d.y(), lz = ocz - k*d.z();
+            const real discriminant = a * (radius[i]*radius[i] - (lx*lx + ly*ly + lz*lz));
+            if (discriminant < 0) continue;
+            const real q = -(half_b + std::copysign(sqrt(discriminant), half_b));
+            near_root = c / q;
+            far_root = q / a;
+            if (far_root < near_root) std::swap(near_root, far_root);
+        } else {
+            const real discriminant = half_b*half_b - a*c;
+            if (discriminant < 0) continue;
+            const real sqrtd = sqrt(discriminant);
+            near_root = (-half_b - sqrtd) / a;
+            far_root = (-half_b + sqrtd) / a;
+        }
+
+        real root = near_root;
+        if (root < t_min || t_max < root) {
+            root = far_root;
+            if (root < t_min || t_max < root)
+                continue;
+        }
+
+        if constexpr (any_hit) {
+            t_hit = root;
+            return i;
+        }
+        t_max = root;
+        best = i;
+    }
+
+    t_hit = t_max;
+    return best;
+}
+
+#ifdef RT_SIMD_X86
+
+// Cada lane guarda a melhor raiz e o índice da melhor esfera entre as que passaram por
+// ela; a redução final escolhe a menor raiz e, em empate, o maior índice. A contração
+// de multiplicação e soma em FMA fica desligada para manter os arredondamentos escalares.
+#ifndef RT_FLOAT
+
+template <bool any_hit>
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+inline int sphere_set::closest_avx2(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const point3 o = r.origin();
+    const double a_s = d.length_squared();
+
+    const __m256d ox = _mm256_set1_pd(o.x()), oy = _mm256_set1_pd(o.y()), oz = _mm256_set1_pd(o.z());
+    const __m256d dx = _mm256_set1_pd(d.x()), dy = _mm256_set1_pd(d.y()), dz = _mm256_set1_pd(d.z());
+    const __m256d a = _mm256_set1_pd(a_s);
+    const __m256d tmin = _mm256_set1_pd(t_min), tmax = _mm256_set1_pd(t_max);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d four = _mm256_set1_pd(4.0);
+
+    __m256d best_t = tmax;
+    __m256d best_i = _mm256_set1_pd(-1.0);
+    __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+    for (int i = 0; i < count; i += 4, idx = _mm256_add_pd(idx, four)) {
+        const __m256d ocx = _mm256_sub_pd(ox, _mm256_loadu_pd(&cx[i]));
+        const __m256d ocy = _mm256_sub_pd(oy, _mm256_loadu_pd(&cy[i]));
+        const __m256d ocz = _mm256_sub_pd(oz, _mm256_loadu_pd(&cz[i]));
+        const __m256d rad = _mm256_loadu_pd(&radius[i]);
+
+        const __m256d half_b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, dx), _mm256_mul_pd(ocy, dy)),
+                                             _mm256_mul_pd(ocz, dz));
+        const __m256d len2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)),
+                                           _mm256_mul_pd(ocz, ocz));
+        const __m256d c = _mm256_sub_pd(len2, _mm256_mul_pd(rad, rad));
+        const __m256d disc = _mm256_sub_pd(_mm256_mul_pd(half_b, half_b), _mm256_mul_pd(a, c));
+
+        const __m256d valid = _mm256_cmp_pd(disc, zero, _CMP_GE_OQ);
+        if (_mm256_movemask_pd(valid) == 0) continue;
+
+        const __m256d sqrtd = _mm256_sqrt_pd(disc);
+        const __m256d neg_b = _mm256_xor_pd(half_b, _mm256_set1_pd(-0.0));
+        const __m256d root1 = _mm256_div_pd(_mm256_sub_pd(neg_b, sqrtd), a);
+        const __m256d root2 = _mm256_div_pd(_mm256_add_pd(neg_b, sqrtd), a);
+
+        // !(root < t_min) && !(t_max < root), na mesma forma do teste escalar
+        const __m256d ok1 = _mm256_and_pd(_mm256_cmp_pd(root1, tmin, _CMP_NLT_UQ),
+                                          _mm256_cmp_pd(root1, tmax, _CMP_NGT_UQ));
+        const __m256d ok2 = _mm256_and_pd(_mm256_cmp_pd(root2, tmin, _CMP_NLT_UQ),
+                                          _mm256_cmp_pd(root2, tmax, _CMP_NGT_UQ));
+        const __m256d root = _mm256_blendv_pd(root2, root1, ok1);
+        const __m256d better = _mm256_and_pd(_mm256_and_pd(valid, _mm256_or_pd(ok1, ok2)),
+                                             _mm256_cmp_pd(root, best_t, _CMP_LE_OQ));
+        if constexpr (any_hit) {
+            if (const int mask = _mm256_movemask_pd(better)) {
+                const int lane = __builtin_ctz(mask);
+                alignas(32) double lane_t[4];
+                _mm256_store_pd(lane_t, root);
+                t_hit = lane_t[lane];
+                return i + lane;
+            }
+        }
+
+        best_t = _mm256_blendv_pd(best_t, root, better);
+        best_i = _mm256_blendv_pd(best_i, idx, better);
+    }
+
+    alignas(32) double lane_t[4], lane_i[4];
+    _mm256_store_pd(lane_t, best_t);
+    _mm256_store_pd(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 4; ++l) {
+        if (lane_i[l] < 0) continue;
+        if (best < 0 || lane_t[l] < t_hit || (lane_t[l] == t_hit && lane_i[l] > best)) {
+            t_hit = lane_t[l];
+            best = static_cast<int>(lane_i[l]);
+        }
+    }
+    return best;
+}
+
+template <bool any_hit>
+__attribute__((target("avx512f,avx512dq"), optimize("fp-contract=off")))
+inline int sphere_set::closest_avx512(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const point3 o = r.origin();
+    const double a_s = d.length_squared();
+
+    const __m512d ox = _mm512_set1_pd(o.x()), oy = _mm512_set1_pd(o.y()), oz = _mm512_set1_pd(o.z());
+    const __m512d dx = _mm512_set1_pd(d.x()), dy = _mm512_set1_pd(d.y()), dz = _mm512_set1_pd(d.z());
+    const __m512d a = _mm512_set1_pd(a_s);
+    const __m512d tmin = _mm512_set1_pd(t_min), tmax = _mm512_set1_pd(t_max);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d eight = _mm512_set1_pd(8.0);
+
+    __m512d best_t = tmax;
+    __m512d best_i = _mm512_set1_pd(-1.0);
+    __m512d idx = _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+
+    for (int i = 0; i < count; i += 8, idx = _mm512_add_pd(idx, eight)) {
+        const __m512d ocx = _mm512_sub_pd(ox, _mm512_loadu_pd(&cx[i]));
+        const __m512d ocy = _mm512_sub_pd(oy, _mm512_loadu_pd(&cy[i]));
+        const __m512d ocz = _mm512_sub_pd(oz, _mm512_loadu_pd(&cz[i]));
+        const __m512d rad = _mm512_loadu_pd(&radius[i]);
+
+        const __m512d half_b = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ocx, dx), _mm512_mul_pd(ocy, dy)),
+                                             _mm512_mul_pd(ocz, dz));
+        const __m512d len2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(ocx, ocx), _mm512_mul_pd(ocy, ocy)),
+                                           _mm512_mul_pd(ocz, ocz));
+        const __m512d c = _mm512_sub_pd(len2, _mm512_mul_pd(rad, rad));
+        const __m512d disc = _mm512_sub_pd(_mm512_mul_pd(half_b, half_b), _mm512_mul_pd(a, c));
+
+        const __mmask8 valid = _mm512_cmp_pd_mask(disc, zero, _CMP_GE_OQ);
+        if (valid == 0) continue;
+
+        const __m512d sqrtd = _mm512_mask_sqrt_pd(zero, valid, disc);  // Só nas lanes válidas
+        const __m512d neg_b = _mm512_xor_pd(half_b, _mm512_set1_pd(-0.0));
+        const __m512d root1 = _mm512_div_pd(_mm512_sub_pd(neg_b, sqrtd), a);
+        const __m512d root2 = _mm512_div_pd(_mm512_add_pd(neg_b, sqrtd), a);
+
+        const __mmask8 ok1 = _mm512_cmp_pd_mask(root1, tmin, _CMP_NLT_UQ)
+                           & _mm512_cmp_pd_mask(root1, tmax, _CMP_NGT_UQ);
+        const __mmask8 ok2 = _mm512_cmp_pd_mask(root2, tmin, _CMP_NLT_UQ)
+                           & _mm512_cmp_pd_mask(root2, tmax, _CMP_NGT_UQ);
+        const __m512d root = _mm512_mask_blend_pd(ok1, root2, root1);
+        const __mmask8 better = valid & (ok1 | ok2) & _mm512_cmp_pd_mask(root, best_t, _CMP_LE_OQ);
+        if constexpr (any_hit) {
+            if (better) {
+                const int lane = __builtin_ctz(better);
+                alignas(64) double lane_t[8];
+                _mm512_store_pd(lane_t, root);
+                t_hit = lane_t[lane];
+                return i + lane;
+            }
+        }
+
+        best_t = _mm512_mask_blend_pd(better, best_t, root);
+        best_i = _mm512_mask_blend_pd(better, best_i, idx);
+    }
+
+    alignas(64) double lane_t[8], lane_i[8];
+    _mm512_store_pd(lane_t, best_t);
+    _mm512_store_pd(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 8; ++l) {
+        if (lane_i[l] < 0) continue;
+        if (best < 0 || lane_t[l] < t_hit || (lane_t[l] == t_hit && lane_i[l] > best)) {
+            t_hit = lane_t[l];
+            best = static_cast<int>(lane_i[l]);
+        }
+    }
+    return best;
+}
+
+#else // RT_FLOAT
+
+// Versões em float: o dobro de lanes e a forma robusta de sphere::hit, com a raiz
+// próxima em c/q e a distante em q/a.
+template <bool any_hit>
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+inline int sphere_set::closest_avx2(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const point3 o = r.origin();
+    const float a_s = d.length_squared();
+
+    const __m256 ox = _mm256_set1_ps(o.x()), oy = _mm256_set1_ps(o.y()), oz = _mm256_set1_ps(o.z());
+    const __m256 dx = _mm256_set1_ps(d.x()), dy = _mm256_set1_ps(d.y()), dz = _mm256_set1_ps(d.z());
+    const __m256 a = _mm256_set1_ps(a_s);
+    const __m256 tmin = _mm256_set1_ps(t_min), tmax = _mm256_set1_ps(t_max);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 eight = _mm256_set1_ps(8.0f);
+
+    __m256 best_t = tmax;
+    __m256 best_i = _mm256_set1_ps(-1.0f);
+    __m256 idx = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+    for (int i = 0; i < count; i += 8, idx = _mm256_add_ps(idx, eight)) {
+        const __m256 ocx = _mm256_sub_ps(ox, _mm256_loadu_ps(&cx[i]));
+        const __m256 ocy = _mm256_sub_ps(oy, _mm256_loadu_ps(&cy[i]));
+        const __m256 ocz = _mm256_sub_ps(oz, _mm256_loadu_ps(&cz[i]));
+        const __m256 rad = _mm256_loadu_ps(&radius[i]);
+        const __m256 rad2 = _mm256_mul_ps(rad, rad);
+
+        const __m256 half_b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)),
+                                            _mm256_mul_ps(ocz, dz));
+        const __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)),
+                                          _mm256_mul_ps(ocz, ocz));
+        const __m256 c = _mm256_sub_ps(len2, rad2);
+
+        // Componente de oc perpendicular ao raio
+        const __m256 k = _mm256_div_ps(half_b, a);
+        const __m256 lx = _mm256_sub_ps(ocx, _mm256_mul_ps(k, dx));
+        const __m256 ly = _mm256_sub_ps(ocy, _mm256_mul_ps(k, dy));
+        const __m256 lz = _mm256_sub_ps(ocz, _mm256_mul_ps(k, dz));
+        const __m256 l2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(lx, lx), _mm256_mul_ps(ly, ly)),
+                                        _mm256_mul_ps(lz, lz));
+        const __m256 disc = _mm256_mul_ps(a, _mm256_sub_ps(rad2, l2));
+
+        const __m256 valid = _mm256_cmp_ps(disc, zero, _CMP_GE_OQ);
+        if (_mm256_movemask_ps(valid) == 0) continue;
+
+        // q = -(half_b + copysign(sqrtd, half_b)); sqrtd não tem sinal, basta copiar o bit
+        const __m256 sqrtd = _mm256_sqrt_ps(disc);
+        const __m256 signed_sqrtd = _mm256_or_ps(sqrtd, _mm256_and_ps(half_b, sign));
+        const __m256 q = _mm256_xor_ps(_mm256_add_ps(half_b, signed_sqrtd), sign);
+        const __m256 near_q = _mm256_div_ps(c, q);
+        const __m256 far_q = _mm256_div_ps(q, a);
+        const __m256 swap = _mm256_cmp_ps(far_q, near_q, _CMP_LT_OQ);
+        const __m256 root1 = _mm256_blendv_ps(near_q, far_q, swap);
+        const __m256 root2 = _mm256_blendv_ps(far_q, near_q, swap);
+
+        const __m256 ok1 = _mm256_and_ps(_mm256_cmp_ps(root1, tmin, _CMP_NLT_UQ),
+                                         _mm256_cmp_ps(root1, tmax, _CMP_NGT_UQ));
+        const __m256 ok2 = _mm256_and_ps(_mm256_cmp_ps(root2, tmin, _CMP_NLT_UQ),
+                                         _mm256_cmp_ps(root2, tmax, _CMP_NGT_UQ));
+        const __m256 root = _mm256_blendv_ps(root2, root1, ok1);
+        const __m256 better = _mm256_and_ps(_mm256_and_ps(valid, _mm256_or_ps(ok1, ok2)),
+                                            _mm256_cmp_ps(root, best_t, _CMP_LE_OQ));
+        if constexpr (any_hit) {
+            if (const int mask = _mm256_movemask_ps(better)) {
+                const int lane = __builtin_ctz(mask);
+                alignas(32) float lane_t[8];
+                _mm256_store_ps(lane_t, root);
+                t_hit = lane_t[lane];
+                return i + lane;
+            }
+        }
+
+        best_t = _mm256_blendv_ps(best_t, root, better);
+        best_i = _mm256_blendv_ps(best_i, idx, better);
+    }
+
+    alignas(32) float lane_t[8], lane_i[8];
+    _mm256_store_ps(lane_t, best_t);
+    _mm256_store_ps(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 8; ++l) {
+        if (lane_i[l] < 0) continue;
+        if (best < 0 || lane_t[l] < t_hit || (lane_t[l] == t_hit && lane_i[l] > best)) {
+            t_hit = lane_t[l];
+            best = static_cast<int>(lane_i[l]);
+        }
+    }
+    return best;
+}
+
+template <bool any_hit>
+__attribute__((target("avx512f,avx512dq"), optimize("fp-contract=off")))
+inline int sphere_set::closest_avx512(const ray& r, real t_min, real t_max, real& t_hit) const {
+    const vec3 d = r.direction();
+    const point3 o = r.origin();
+    const float a_s = d.length_squared();
+
+    const __m512 ox = _mm512_set1_ps(o.x()), oy = _mm512_set1_ps(o.y()), oz = _mm512_set1_ps(o.z());
+    const __m512 dx = _mm512_set1_ps(d.x()), dy = _mm512_set1_ps(d.y()), dz = _mm512_set1_ps(d.z());
+    const __m512 a = _mm512_set1_ps(a_s);
+    const __m512 tmin = _mm512_set1_ps(t_min), tmax = _mm512_set1_ps(t_max);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 sign = _mm512_set1_ps(-0.0f);
+    const __m512 sixteen = _mm512_set1_ps(16.0f);
+
+    __m512 best_t = tmax;
+    __m512 best_i = _mm512_set1_ps(-1.0f);
+    __m512 idx = _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f,
+                               7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+
+    for (int i = 0; i < count; i += 16, idx = _mm512_add_ps(idx, sixteen)) {
+        const __m512 ocx = _mm512_sub_ps(ox, _mm512_loadu_ps(&cx[i]));
+        const __m512 ocy = _mm512_sub_ps(oy, _mm512_loadu_ps(&cy[i]));
+        const __m512 ocz = _mm512_sub_ps(oz, _mm512_loadu_ps(&cz[i]));
+        const __m512 rad = _mm512_loadu_ps(&radius[i]);
+        const __m512 rad2 = _mm512_mul_ps(rad, rad);
+
+        const __m512 half_b = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, dx), _mm512_mul_ps(ocy, dy)),
+                                            _mm512_mul_ps(ocz, dz));
+        const __m512 len2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, ocx), _mm512_mul_ps(ocy, ocy)),
+                                          _mm512_mul_ps(ocz, ocz));
+        const __m512 c = _mm512_sub_ps(len2, rad2);
+
+        const __m512 k = _mm512_div_ps(half_b, a);
+        const __m512 lx = _mm512_sub_ps(ocx, _mm512_mul_ps(k, dx));
+        const __m512 ly = _mm512_sub_ps(ocy, _mm512_mul_ps(k, dy));
+        const __m512 lz = _mm512_sub_ps(ocz, _mm512_mul_ps(k, dz));
+        const __m512 l2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(lx, lx), _mm512_mul_ps(ly, ly)),
+                                        _mm512_mul_ps(lz, lz));
+        const __m512 disc = _mm512_mul_ps(a, _mm512_sub_ps(rad2, l2));
+
+        const __mmask16 valid = _mm512_cmp_ps_mask(disc, zero, _CMP_GE_OQ);
+        if (valid == 0) continue;
+
+        const __m512 sqrtd = _mm512_mask_sqrt_ps(zero, valid, disc);  // Só nas lanes válidas
+        const __m512 signed_sqrtd = _mm512_or_ps(sqrtd, _mm512_and_ps(half_b, sign));
+        const __m512 q = _mm512_xor_ps(_mm512_add_ps(half_b, signed_sqrtd), sign);
+        const __m512 near_q = _mm512_div_ps(c, q);
+        const __m512 far_q = _mm512_div_ps(q, a);
+        const __mmask16 swap = _mm512_cmp_ps_mask(far_q, near_q, _CMP_LT_OQ);
+        const __m512 root1 = _mm512_mask_blend_ps(swap, near_q, far_q);
+        const __m512 root2 = _mm512_mask_blend_ps(swap, far_q, near_q);
+
+        const __mmask16 ok1 = _mm512_cmp_ps_mask(root1, tmin, _CMP_NLT_UQ)
+                            & _mm512_cmp_ps_mask(root1, tmax, _CMP_NGT_UQ);
+        const __mmask16 ok2 = _mm512_cmp_ps_mask(root2, tmin, _CMP_NLT_UQ)
+                            & _mm512_cmp_ps_mask(root2, tmax, _CMP_NGT_UQ);
+        const __m512 root = _mm512_mask_blend_ps(ok1, root2, root1);
+        const __mmask16 better = valid & (ok1 | ok2) & _mm512_cmp_ps_mask(root, best_t, _CMP_LE_OQ);
+        if constexpr (any_hit) {
+            if (better) {
+                const int lane = __builtin_ctz(better);
+                alignas(64) float lane_t[16];
+                _mm512_store_ps(lane_t, root);
+                t_hit = lane_t[lane];
+                return i + lane;
+            }
+        }
+
+        best_t = _mm512_mask_blend_ps(better, best_t, root);
+        best_i = _mm512_mask_blend_ps(better, best_i, idx);
+    }
+
+    alignas(64) float lane_t[16], lane_i[16];
+    _mm512_store_ps(lane_t, best_t);
+    _mm512_store_ps(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 16; ++l) {
+        if (lane_i[l] < 0) continue;
+        if (best < 0 || lane_t[l] < t_hit || (lane_t[l] == t_hit && lane_i[l] > best)) {
+            t_hit = lane_t[l];
+            best = static_cast<int>(lane_i[l]);
+        }
+    }
+    return best;
+}
+
+#endif // RT_FLOAT
+
+#endif
+
+// Agrupa as esferas da lista em conjuntos de até cluster_size esferas vizinhas,
+// ordenadas pela curva de Morton dos centros, para servirem de folhas de uma BVH.
+// Esferas muito maiores que a mediana (como o chão de random_scene()) e objetos que
+// não são esferas continuam sozinhos, para não inflar as caixas dos grupos.
+inline hittable_list cluster_spheres(const hittable_list& list, int cluster_size = 8) {
+    hittable_list result;
+    std::vector<shared_ptr<sphere>> spheres;
+
+    for (const auto& object : list.objects) {
+        if (auto s = std::dynamic_pointer_cast<sphere>(object))
+            spheres.push_back(s);
+        else
+            result.add(object);
+    }
+    if (spheres.empty()) return result;
+
+    std::vector<double> radii;
+    for (const auto& s : spheres) radii.push_back(s->radius);
+    std::nth_element(radii.begin(), radii.begin() + radii.size() / 2, radii.end());
+    const double large_radius = 10 * radii[radii.size() / 2];
+
+    std::vector<shared_ptr<sphere>> small;
+    aabb bounds;
+    for (const auto& s : spheres) {
+        if (s->radius > large_radius) {
+            result.add(s);
+        } else {
+            small.push_back(s);
+            bounds = surrounding_box(bounds, aabb(s->center, s->center));
+        }
+    }
+
+    // Código de Morton 3D com 10 bits por eixo
+    auto spread = [](std::uint32_t x) {
+        x &= 0x3ff;
+        x = (x | (x << 16)) & 0x030000ff;
+        x = (x | (x << 8)) & 0x0300f00f;
+        x = (x | (x << 4)) & 0x030c30c3;
+        x = (x | (x << 2)) & 0x09249249;
+        return x;
+    };
+    auto code = [&](const point3& p) {
+        std::uint32_t q[3];
+        for (int a = 0; a < 3; ++a) {
+            double extent = bounds.max()[a] - bounds.min()[a];
+            double f = extent > 0 ? (p[a] - bounds.min()[a]) / extent : 0;
+            q[a] = static_cast<std::uint32_t>(clamp(f, 0.0, 1.0) * 1023);
+        }
+        return spread(q[0]) | (spread(q[1]) << 1) | (spread(q[2]) << 2);
+    };
+
+    std::stable_sort(small.begin(), small.end(), [&](const auto& a, const auto& b) {
+        return code(a->center) < code(b->center);
+    });
+
+    for (size_t first = 0; first < small.size(); first += cluster_size) {
+        auto set = make_shared<sphere_set>();
+        size_t last = std::min(small.size(), first + cluster_size);
+        for (size_t k = first; k < last; ++k)
+            set->add(small[k]->center, small[k]->radius, small[k]->mat_id);
+        result.add(set);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "framebuffer.h"
+#include "image_io.h"
+#include "material.h"
+#include "tile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Estatísticas de uma renderização: raios, testes de interseção, como os caminhos
+// terminam, o que cada classe de material fez com os raios e o tempo de cada tile.
+// A coleta só existe quando o programa é compilado com -DRT_STATS; sem essa opção
+// RT_STAT não gera código e stats_collector é vazio, então o caminho quente não muda.
+
+// Como um caminho terminou
+enum class path_end { escaped, absorbed, roulette, max_depth };
+constexpr int path_end_count = 4;
+
+struct render_stats {
+    static constexpr int length_bins = 64;  // O último intervalo junta os caminhos mais longos
+
+    std::uint64_t primary_rays = 0;
+    std::uint64_t secondary_rays = 0;
+    std::uint64_t shadow_rays = 0;       // Consultas de oclusão da amostragem das luzes
+    std::uint64_t box_tests = 0;         // Caixas da BVH testadas
+    std::uint64_t primitive_tests = 0;   // Esferas testadas (cada esfera de um sphere_set conta)
+    std::uint64_t instance_transforms = 0;  // Raios levados para o espaço de um objeto instanciado
+    std::uint64_t path_ends[path_end_count] = {};
+    std::uint64_t path_length[length_bins] = {};  // Caminhos por número de raios traçados
+    std::uint64_t scattered[material_kind_count] = {};
+    std::uint64_t absorbed[material_kind_count] = {};  // Raios que o material não espalhou
+
+    // Dados por tile, preenchidos por stats_collector
+    int image_width = 0, image_height = 0;
+    std::vector<tile> tiles;
+    std::vector<double> tile_seconds;
+    std::vector<std::uint64_t> tile_rays;
+
+    std::uint64_t rays() const { return primary_rays + secondary_rays; }
+
+    void end_path(path_end reason, int length, std::uint64_t paths = 1) {
+        path_ends[static_cast<int>(reason)] += paths;
+        path_length[std::min(length, length_bins - 1)] += paths;
+    }
+
+    void record_scatter(material_kind kind, bool scatters) {
+        (scatters ? scattered : absorbed)[static_cast<int>(kind)]++;
+    }
+
+    // Soma os contadores de outro conjunto (os dados por tile não são somados).
+    void merge(const render_stats& other) {
+        primary_rays += other.primary_rays;
+        secondary_rays += other.secondary_rays;
+        shadow_rays += other.shadow_rays;
+        box_tests += other.box_tests;
+        primitive_tests += other.primitive_tests;
+        instance_transforms += other.instance_transforms;
+        for (int k = 0; k < path_end_count; ++k) path_ends[k] += other.path_ends[k];
+        for (int k = 0; k < length_bins; ++k) path_length[k] += other.path_length[k];
+        for (int k = 0; k < material_kind_count; ++k) {
+            scattered[k] += other.scattered[k];
+            absorbed[k] += other.absorbed[k];
+        }
+    }
+};
+
+#ifdef RT_STATS
+
+// Contadores da thread corrente; nulo fora de uma renderização com estatísticas.
+inline render_stats*& thread_stats() {
+    thread_local render_stats* current = nullptr;
+    return current;
+}
+
+// Executa uma operação sobre os contadores da thread, por exemplo RT_STAT(box_tests++).
+#define RT_STAT(op) do { if (render_stats* rt_stats_ = thread_stats()) rt_stats_->op; } while (0)
+
+// Coleta as estatísticas de uma renderização em tiles. Cada worker conta no seu próprio
+// render_stats, sem sincronização, e finish() soma tudo no destino. Cada tile é
+// processado por um único worker por vez, então o tempo e os raios do tile podem ser
+// acumulados direto no vetor compartilhado.
+class stats_collector {
+public:
+    stats_collector(render_stats* target, int workers, const std::vector<tile>& tiles,
+                    int image_width, int image_height)
+        : target(target), per_worker(target ? std::max(workers, 1) : 0)
+    {
+        if (!target) return;
+        if (target->tiles.size() != tiles.size()) {
+            target->tiles = tiles;
+            target->tile_seconds.assign(tiles.size(), 0);
+            target->tile_rays.assign(tiles.size(), 0);
+        }
+        target->image_width = image_width;
+        target->image_height = image_height;
+    }
+
+    // Executa body() contando nos contadores do worker e mede o tempo do tile t.
+    template <typename Body>
+    void run_tile(int t, int worker, Body&& body) {
+        if (!target) { body(); return; }
+
+        render_stats& local = per_worker[worker];
+        render_stats* saved = thread_stats();
+        thread_stats() = &local;
+        const std::uint64_t rays_before = local.rays();
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        target->tile_seconds[t] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        target->tile_rays[t] += local.rays() - rays_before;
+        thread_stats() = saved;
+    }
+
+    void finish() {
+        for (const auto& local : per_worker) target->merge(local);
+        per_worker.assign(per_worker.size(), render_stats());
+    }
+
+private:
+    render_stats* target;
+    std::vector<render_stats> per_worker;
+};
+
+#else
+
+#define RT_STAT(op) do {} while (0)
+
+class stats_collector {
+public:
+    stats_collector(render_stats*, int, const std::vector<tile>&, int, int) {}
+
+    template <typename Body>
+    void run_tile(int, int, Body&& body) { body(); }
+
+    void finish() {}
+};
+
+#endif
+
+// Indica se o programa foi compilado com a coleta de estatísticas.
+constexpr bool stats_enabled() {
+#ifdef RT_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline const char* path_end_name(int k) {
+    static const char* names[path_end_count] = {"escaped", "absorbed", "roulette", "max_depth"};
+    return names[k];
+}
+
+inline const char* material_kind_name(int k) {
+    static const char* names[material_kind_count] = {"lambertian", "metal", "dielectric", "diffuse_light", "other"};
+    return names[k];
+}
+
+// Grava as estatísticas em JSON.
+inline bool write_stats_json(const std::string& path, const render_stats& s, double seconds) {
+    std::ofstream out(path);
+    const double rays = static_cast<double>(s.rays());
+    auto per_ray = [&](std::uint64_t n) { return rays > 0 ? n / rays : 0.0; };
+
+    out << "{\n";
+    out << "  \"width\": " << s.image_width << ",\n";
+    out << "  \"height\": " << s.image_height << ",\n";
+    out << "  \"seconds\": " << seconds << ",\n";
+    out << "  \"primary_rays\": " << s.primary_rays << ",\n";
+    out << "  \"secondary_rays\": " << s.secondary_rays << ",\n";
+    out << "  \"shadow_rays\": " << s.shadow_rays << ",\n";
+    out << "  \"box_tests\": " << s.box_tests << ",\n";
+    out << "  \"primitive_tests\": " << s.primitive_tests << ",\n";
+    out << "  \"instance_transforms\": " << s.instance_transforms << ",\n";
+    out << "  \"box_tests_per_ray\": " << per_ray(s.box_tests) << ",\n";
+    out << "  \"primitive_tests_per_ray\": " << per_ray(s.primitive_tests) << ",\n";
+
+    out << "  \"path_ends\": {";
+    for (int k = 0; k < path_end_count; ++k)
+        out << (k ? ", " : "") << '"' << path_end_name(k) << "\": " << s.path_ends[k];
+    out << "},\n";
+
+    // Histograma sem os intervalos vazios do fim
+    int last = render_stats::length_bins - 1;
+    while (last > 0 && s.path_length[last] == 0) --last;
+    out << "  \"path_length\": [";
+    for (int k = 0; k <= last; ++k) out << (k ? ", " : "") << s.path_length[k];
+    out << "],\n";
+
+    out << "  \"materials\": {";
+    for (int k = 0; k < material_kind_count; ++k)
+        out << (k ? ", " : "") << '"' << material_kind_name(k) << "\": {\"scattered\": " << s.scattered[k]
+            << ", \"absorbed\": " << s.absorbed[k] << '}';
+    out << "},\n";
+    out << "  \"metal_absorbed\": " << s.absorbed[static_cast<int>(material_kind::metal)] << ",\n";
+
+    out << "  \"tiles\": [\n";
+    for (size_t t = 0; t < s.tiles.size(); ++t) {
+        const tile& tl = s.tiles[t];
+        out << "    {\"x\": " << tl.x0 << ", \"y\": " << tl.y0 << ", \"w\": " << tl.width()
+            << ", \"h\": " << tl.height() << ", \"ms\": " << s.tile_seconds[t] * 1e3
+            << ", \"rays\": " << s.tile_rays[t] << '}' << (t + 1 < s.tiles.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+// Grava um mapa de calor do tempo gasto por pixel em cada tile (tempo do tile dividido
+// pelo número de pixels), do preto (mais rápido) ao branco (mais lento) passando por
+// vermelho e amarelo. A escala vai até o tile mais lento.
+inline bool write_stats_heatmap(const std::string& path, const render_stats& s) {
+    framebuffer fb;
+    fb.resize(s.image_width, s.image_height);
+
+    double slowest = 0;
+    for (size_t t = 0; t < s.tiles.size(); ++t)
+        slowest = std::max(slowest, s.tile_seconds[t] / s.tiles[t].pixel_count());
+
+    for (size_t t = 0; t < s.tiles.size(); ++t) {
+        const tile& tl = s.tiles[t];
+        const double x = slowest > 0 ? s.tile_seconds[t] / tl.pixel_count() / slowest : 0;
+        // Rampa preto -> vermelho -> amarelo -> branco; os valores vão ao quadrado porque
+        // write_image aplica a correção gama (raiz quadrada)
+        const double r = clamp(3 * x, 0.0, 1.0);
+        const double g = clamp(3 * x - 1, 0.0, 1.0);
+        const double b = clamp(3 * x - 2, 0.0, 1.0);
+        const color c(r * r, g * g, b * b);
+        for (int j = tl.y0; j < tl.y1; ++j)
+            for (int i = tl.x0; i < tl.x1; ++i)
+                fb.set(static_cast<size_t>(j) * s.image_width + i, c);
+    }
+    return write_image(path, fb, 1.0);
+}
+
+#endif
@@ -0,0 +1,160 @@
+// Lê o stream de tiles de uma renderização em andamento (ver tile_stream.h) e remonta a
+// imagem, regravando-a a cada passada e no máximo a cada --interval segundos enquanto
+// chegam tiles, para acompanhar renderizações longas e interromper as que saíram erradas.
+//
+//     g++ -O2 -std=c++17 stream_view.cpp -o output/stream_view
+//     ./output/main --stream - | ./output/stream_view --output previa.png
+//     ./output/stream_view --listen /tmp/rt.sock --output previa.png &
+//     ./output/main --progressive --stream /tmp/rt.sock
+
+#include "rtweekend.h"
+
+#include "image_io.h"
+#include "tile_stream.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Lê exatamente 'size' bytes; false no fim do stream ou em erro
+static bool read_all(int fd, void* out, size_t size) {
+    auto* data = static_cast<std::uint8_t*>(out);
+    while (size > 0) {
+        const ssize_t n = ::read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Espera a conexão do renderizador no socket 'path'; retorna o descritor ou -1
+static int accept_one(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int server = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) return -1;
+    ::unlink(path.c_str());
+    if (::bind(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(server, 1) != 0) {
+        ::close(server);
+        return -1;
+    }
+    std::cerr << "Esperando o renderizador em " << path << '\n';
+    const int fd = ::accept(server, nullptr, nullptr);
+    ::close(server);
+    ::unlink(path.c_str());
+    return fd;
+}
+
+// Grava num arquivo temporário e o renomeia, para que um visualizador nunca leia a
+// imagem pela metade
+static bool write_preview(const std::string& path, const framebuffer& fb) {
+    const std::string temporary = path + ".tmp" + std::filesystem::path(path).extension().string();
+    if (!write_image(temporary, fb, 1.0)) return false;
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    return !ec;
+}
+
+int main(int argc, char** argv) {
+    std::string output_path = "./output/preview.ppm";
+    std::string listen_path;
+    double interval = 1.0;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        if (arg == "--output" && has_value) output_path = argv[++a];
+        else if (arg == "--listen" && has_value) listen_path = argv[++a];
+        else if (arg == "--interval" && has_value) interval = std::atof(argv[++a]);
+        else {
+            std::cerr << "Uso: " << argv[0]
+                      << " [--output arquivo.ppm|.pfm|.png] [--listen socket] [--interval S]\n";
+            return 1;
+        }
+    }
+
+    int fd = STDIN_FILENO;
+    if (!listen_path.empty()) {
+        fd = accept_one(listen_path);
+        if (fd < 0) {
+            std::cerr << "Não foi possível escutar em " << listen_path << ": " << std::strerror(errno) << '\n';
+            return 1;
+        }
+    }
+
+    stream_header header;
+    if (!read_all(fd, &header, sizeof(header)) || std::memcmp(header.magic, "RTSTRM01", 8) != 0
+        || header.version != stream_version || header.width == 0 || header.height == 0) {
+        std::cerr << "A entrada não é um stream de tiles\n";
+        return 1;
+    }
+    framebuffer fb(static_cast<int>(header.width), static_cast<int>(header.height));
+    std::cerr << "Imagem " << header.width << "x" << header.height << '\n';
+
+    const auto start = std::chrono::steady_clock::now();
+    auto last_write = start;
+    std::uint64_t tiles = 0, writes = 0;
+    bool finished = false, dirty = false;
+    std::vector<float> pixels;
+    auto flush = [&] {
+        if (!write_preview(output_path, fb))
+            std::cerr << "\nNão foi possível gravar " << output_path << '\n';
+        writes++;
+        dirty = false;
+        last_write = std::chrono::steady_clock::now();
+    };
+
+    stream_message message;
+    while (!finished && read_all(fd, &message, sizeof(message))) {
+        switch (static_cast<stream_message_type>(message.type)) {
+        case stream_message_type::tile: {
+            if (message.x0 + static_cast<std::uint64_t>(message.width) > header.width
+                || message.y0 + static_cast<std::uint64_t>(message.height) > header.height) {
+                std::cerr << "\nTile fora da imagem\n";
+                return 1;
+            }
+            pixels.resize(static_cast<size_t>(message.width) * message.height * 3);
+            if (!read_all(fd, pixels.data(), pixels.size() * sizeof(float))) break;
+            const size_t row = static_cast<size_t>(message.width) * 3;
+            for (std::uint32_t y = 0; y < message.height; ++y)
+                std::memcpy(&fb.rgb[((static_cast<size_t>(message.y0) + y) * fb.width + message.x0) * 3],
+                            &pixels[y * row], row * sizeof(float));
+            tiles++;
+            dirty = true;
+            std::chrono::duration<double> since = std::chrono::steady_clock::now() - last_write;
+            if (since.count() >= interval) flush();
+            break;
+        }
+        case stream_message_type::pass:
+            flush();
+            std::cerr << "\rPassada " << message.pass << ": " << tiles << " tiles recebidos " << std::flush;
+            break;
+        case stream_message_type::end:
+            finished = true;
+            break;
+        default:
+            std::cerr << "\nMensagem desconhecida: " << message.type << '\n';
+            return 1;
+        }
+    }
+    if (dirty || writes == 0) flush();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cerr << '\n' << tiles << " tiles em " << elapsed.count() << " s, " << writes
+              << " gravações de " << output_path << '\n';
+    if (!finished) {
+        std::cerr << "O stream terminou antes do fim da renderização\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "rtweekend.h"
+
+#include "hittable.h"
+
+#include <cmath>
+
+// Textura: a cor de uma superfície que varia de ponto a ponto, consultada pelos
+// materiais no lugar do albedo constante.
+class texture {
+public:
+    virtual ~texture() = default;
+
+    // Cor no ponto 'rec' atingido pelo raio 'r_in'
+    virtual color value(const ray& r_in, const hit_record& rec) const = 0;
+};
+
+// Coordenadas de textura de um ponto 'n' da esfera unitária centrada na origem: u é o
+// ângulo em torno do eixo y, de 0 em -x passando por +z, +x e -z até 1; v vai de 0 no
+// polo sul a 1 no polo norte.
+inline void sphere_uv(const vec3& n, real& u, real& v) {
+    const real y = n.y() < -1 ? real(-1) : n.y() > 1 ? real(1) : n.y();
+    u = (std::atan2(-n.z(), n.x()) + real(pi)) / real(2 * pi);
+    v = std::acos(-y) / real(pi);
+}
+
+// Coordenadas de textura do ponto atingido. Só as esferas têm parametrização; nos
+// outros objetos dá sempre o mesmo ponto da textura.
+inline void surface_uv(const hit_record& rec, real& u, real& v) {
+    sphere_uv(rec.local_normal, u, v);
+}
+
+// Largura, em unidades de (u, v), da região da superfície que uma amostra cobre: o cone
+// de um pixel, de abertura 'pixel_angle' radianos, cortado à distância percorrida pelo
+// raio. Nos raios secundários só conta o último trecho, então a largura sai menor que a
+// real. Sem parametrização, a largura é infinita e uma textura filtrada dá a sua média.
+inline real sample_width(const ray& r_in, const hit_record& rec, double pixel_angle) {
+    if (rec.uv_length <= 0) return infinity;
+    return real(pixel_angle) * rec.t * r_in.direction().length() / rec.uv_length;
+}
+
+#endif
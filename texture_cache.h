@@ -0,0 +1,472 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "rtweekend.h"
+
+#include "texture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TEXTURE_CACHE_PREAD 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Texturas de imagem maiores que a memória disponível. Cada textura fica num arquivo
+// .rtt (gerado por make_texture) com o mip-map inteiro dividido em tiles quadrados de
+// tamanho fixo, e o texture_cache só lê do disco os tiles que as amostras tocam,
+// guardando-os até um limite de bytes e descartando os usados há mais tempo (LRU).
+//
+// Cada thread tem o seu próprio cache pequeno, de mapeamento direto, consultado sem
+// trava; só quando o tile não está nele a thread vai ao cache compartilhado, dividido
+// em partes com uma trava cada, e a leitura do disco acontece fora da trava. O limite
+// de bytes vale para a soma das partes (cada parte descarta na ordem LRU própria, então
+// a ordem global é aproximada), e só é ultrapassado se um único tile for maior que ele.
+// Um tile descartado do cache compartilhado continua válido enquanto alguma thread o
+// tiver no seu cache, então as threads podem segurar até texture_thread_slots tiles
+// fora do limite cada uma.
+//
+// Formato do arquivo (little-endian): um texture_file_header, um texture_file_level por
+// nível e os tiles de cada nível, linha a linha de tiles, com os texels em RGB de 8 bits
+// com correção gama 2 (como as imagens gravadas), linhas de cima para baixo. Os tiles
+// das bordas são completados repetindo o último texel.
+
+struct texture_file_header {
+    char magic[8];            // "RTTEX001"
+    std::uint32_t version;
+    std::uint32_t width;      // Tamanho do nível 0
+    std::uint32_t height;
+    std::uint32_t tile_size;  // Lado dos tiles em texels
+    std::uint32_t levels;     // Níveis do mip-map, do 0 até 1x1
+    std::uint32_t reserved;
+};
+
+struct texture_file_level {
+    std::uint32_t width, height;
+    std::uint32_t tiles_x, tiles_y;
+    std::uint64_t offset;     // Primeiro tile do nível
+};
+
+static_assert(sizeof(texture_file_header) == 32, "layout do formato .rtt");
+static_assert(sizeof(texture_file_level) == 24, "layout do formato .rtt");
+
+constexpr std::uint32_t texture_file_version = 1;
+constexpr int texture_thread_slots = 64;   // Tiles no cache de cada thread
+constexpr int texture_cache_shards = 16;   // Partes do cache compartilhado
+
+class texture_cache {
+public:
+    // 'budget' é o limite, em bytes, dos tiles guardados no cache compartilhado (os caches
+    // das threads ficam fora dele)
+    explicit texture_cache(std::uint64_t budget);
+    ~texture_cache();
+
+    texture_cache(const texture_cache&) = delete;
+    texture_cache& operator=(const texture_cache&) = delete;
+
+    // Abre um arquivo .rtt, lendo só o cabeçalho, e retorna o índice da textura; em
+    // caso de erro retorna -1 e descreve o problema em 'error'
+    int open(const std::string& path, std::string& error);
+
+    // Cor em (u, v) (repetida fora de [0, 1]) para uma amostra que cobre 'width' unidades
+    // de (u, v): filtro bilinear nos dois níveis do mip-map cujos texels têm o tamanho
+    // mais próximo de 'width', misturados linearmente (filtro trilinear)
+    color sample(int texture, real u, real v, real width) const;
+
+    // Abertura do cone de um pixel, em radianos, usada por image_texture (ver sample_width)
+    void set_pixel_angle(double radians) { angle = radians; }
+    double pixel_angle() const { return angle; }
+
+    std::uint64_t budget() const { return budget_bytes; }
+    size_t size() const { return files.size(); }
+
+    // Maior tile das texturas abertas, em bytes; cada thread guarda até
+    // texture_thread_slots deles fora do limite
+    std::uint64_t max_tile_bytes() const {
+        std::uint64_t bytes = 0;
+        for (const auto& f : files) bytes = std::max(bytes, f->tile_bytes);
+        return bytes;
+    }
+
+    struct statistics {
+        std::uint64_t lookups = 0;       // Tiles consultados (quatro por nível em cada amostra)
+        std::uint64_t thread_hits = 0;   // Encontrados no cache da própria thread
+        std::uint64_t shared_hits = 0;   // Encontrados no cache compartilhado
+        std::uint64_t loads = 0;         // Lidos do disco
+        std::uint64_t evictions = 0;     // Descartados pelo limite de bytes
+        std::uint64_t read_errors = 0;   // Leituras que falharam (o tile fica preto)
+        std::uint64_t resident_bytes = 0;
+        std::uint64_t peak_bytes = 0;
+
+        // Fração das consultas que não foram ao disco
+        double hit_rate() const { return lookups ? 1.0 - static_cast<double>(loads) / lookups : 1.0; }
+    };
+    statistics stats() const;
+
+private:
+    using tile_data = std::vector<std::uint8_t>;
+
+    struct texture_file {
+        std::string path;
+        texture_file_header header;
+        std::vector<texture_file_level> levels;
+        std::uint64_t tile_bytes;
+#ifdef TEXTURE_CACHE_PREAD
+        int fd = -1;
+#else
+        std::ifstream in;
+        std::mutex m;
+#endif
+    };
+
+    struct alignas(64) shard {
+        std::mutex m;
+        std::list<std::uint64_t> lru;  // Mais recente na frente
+        struct entry {
+            shared_ptr<const tile_data> data;
+            std::list<std::uint64_t>::iterator position;
+        };
+        std::unordered_map<std::uint64_t, entry> tiles;
+        std::uint64_t bytes = 0;
+        std::uint64_t hits = 0, loads = 0, evictions = 0;
+    };
+
+    // Contadores de uma thread; só ela escreve, então não precisam de instruções atômicas
+    // de leitura e escrita, só de leituras e escritas atômicas
+    struct alignas(64) thread_counters {
+        std::atomic<std::uint64_t> lookups{0};
+        std::atomic<std::uint64_t> hits{0};
+    };
+
+    // Cache de cada thread, comum a todos os texture_cache: cada posição lembra de qual
+    // cache (pelo número de série) veio o tile
+    struct thread_cache {
+        struct slot {
+            std::uint64_t owner = 0;
+            std::uint64_t key = 0;
+            shared_ptr<const tile_data> data;
+        };
+        slot slots[texture_thread_slots];
+        std::uint64_t counters_owner = 0;
+        shared_ptr<thread_counters> counters;
+    };
+
+    static thread_cache& local_cache() {
+        thread_local thread_cache cache;
+        return cache;
+    }
+
+    // Chave de um tile: textura, nível e índice do tile no nível
+    static std::uint64_t tile_key(int texture, int level, std::uint64_t tile) {
+        return static_cast<std::uint64_t>(texture) << 40 | static_cast<std::uint64_t>(level) << 35 | tile;
+    }
+
+    color texel(int texture, int level, int x, int y) const;
+    color bilinear(int texture, int level, real u, real v) const;
+    const std::uint8_t* find_tile(std::uint64_t key) const;
+    shared_ptr<const tile_data> shared_tile(std::uint64_t key) const;
+    void evict(shard& s, size_t keep) const;
+    shared_ptr<const tile_data> load_tile(std::uint64_t key) const;
+    void attach_counters(thread_cache& local) const;
+
+    std::uint64_t serial;         // Distingue os tiles deste cache nos caches das threads
+    std::uint64_t budget_bytes;
+    double angle = 0;
+    std::vector<std::unique_ptr<texture_file>> files;
+    float decode[256];            // Texel de 8 bits -> valor linear
+
+    mutable std::unique_ptr<shard[]> shards;
+    mutable std::atomic<std::uint64_t> resident{0};
+    mutable std::atomic<std::uint64_t> peak{0};
+    mutable std::atomic<std::uint64_t> read_errors{0};
+
+    mutable std::mutex registry_mutex;
+    mutable std::vector<shared_ptr<thread_counters>> registry;  // Contadores das threads vivas
+    mutable std::uint64_t retired_lookups = 0, retired_hits = 0;   // Das threads que já terminaram
+};
+
+// Textura de imagem lida pelo texture_cache, aplicada pelas coordenadas de textura do
+// ponto atingido
+class image_texture final : public texture {
+public:
+    image_texture(shared_ptr<const texture_cache> cache, int index) : cache(std::move(cache)), index(index) {}
+
+    virtual color value(const ray& r_in, const hit_record& rec) const override {
+        real u, v;
+        surface_uv(rec, u, v);
+        return cache->sample(index, u, v, sample_width(r_in, rec, cache->pixel_angle()));
+    }
+
+private:
+    shared_ptr<const texture_cache> cache;
+    int index;
+};
+
+
+inline texture_cache::texture_cache(std::uint64_t budget)
+    : budget_bytes(budget), shards(new shard[texture_cache_shards]) {
+    static std::atomic<std::uint64_t> next_serial{1};
+    serial = next_serial++;
+    // Inverso da conversão de tonemap_to_u8: o centro do intervalo de cada valor, ao quadrado
+    for (int k = 0; k < 256; ++k)
+        decode[k] = ((k + 0.5f) / 256.0f) * ((k + 0.5f) / 256.0f);
+}
+
+inline texture_cache::~texture_cache() {
+#ifdef TEXTURE_CACHE_PREAD
+    for (auto& f : files)
+        if (f->fd >= 0) ::close(f->fd);
+#endif
+}
+
+inline int texture_cache::open(const std::string& path, std::string& error) {
+    auto file = std::make_unique<texture_file>();
+    file->path = path;
+    std::ifstream in(path, std::ios::binary);
+    texture_file_header& h = file->header;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h))) {
+        error = "não foi possível ler " + path;
+        return -1;
+    }
+    if (std::memcmp(h.magic, "RTTEX001", 8) != 0 || h.version != texture_file_version
+        || h.width == 0 || h.height == 0 || h.tile_size == 0 || h.tile_size > 4096
+        || h.levels == 0 || h.levels > 32) {
+        error = path + ": não é uma textura .rtt válida";
+        return -1;
+    }
+    file->levels.resize(h.levels);
+    if (!in.read(reinterpret_cast<char*>(file->levels.data()), h.levels * sizeof(texture_file_level))) {
+        error = path + ": arquivo truncado";
+        return -1;
+    }
+    file->tile_bytes = static_cast<std::uint64_t>(h.tile_size) * h.tile_size * 3;
+    in.seekg(0, std::ios::end);
+    const auto file_size = static_cast<std::uint64_t>(in.tellg());
+    for (const auto& level : file->levels) {
+        const std::uint64_t tiles = static_cast<std::uint64_t>(level.tiles_x) * level.tiles_y;
+        if (level.width == 0 || level.height == 0
+            || level.tiles_x != (level.width + h.tile_size - 1) / h.tile_size
+            || level.tiles_y != (level.height + h.tile_size - 1) / h.tile_size
+            || tiles >= (std::uint64_t(1) << 35) || level.offset + tiles * file->tile_bytes > file_size) {
+            error = path + ": arquivo truncado ou corrompido";
+            return -1;
+        }
+    }
+    if (files.size() >= (std::size_t(1) << 24)) {
+        error = "texturas demais";
+        return -1;
+    }
+
+#ifdef TEXTURE_CACHE_PREAD
+    file->fd = ::open(path.c_str(), O_RDONLY);
+    if (file->fd < 0) {
+        error = "não foi possível abrir " + path;
+        return -1;
+    }
+#else
+    file->in = std::move(in);
+#endif
+    files.push_back(std::move(file));
+    return static_cast<int>(files.size() - 1);
+}
+
+inline color texture_cache::sample(int texture, real u, real v, real width) const {
+    const texture_file& file = *files[texture];
+    const int last = static_cast<int>(file.levels.size()) - 1;
+    // Nível em que um texel tem a largura da amostra
+    const double texels = static_cast<double>(width) * std::max(file.header.width, file.header.height);
+    const double lod = texels > 1 ? std::min(std::log2(texels), static_cast<double>(last)) : 0.0;
+    const int level = static_cast<int>(lod);
+    const real f = static_cast<real>(lod - level);
+
+    color c = bilinear(texture, level, u, v);
+    if (f > 0 && level < last)
+        c = (1 - f) * c + f * bilinear(texture, level + 1, u, v);
+    return c;
+}
+
+inline color texture_cache::bilinear(int texture, int level, real u, real v) const {
+    const texture_file_level& l = files[texture]->levels[level];
+    // Centros dos texels nos meios inteiros; v = 1 é a linha de cima
+    const real x = (u - std::floor(u)) * l.width - real(0.5);
+    const real y = (1 - (v - std::floor(v))) * l.height - real(0.5);
+    const real x0 = std::floor(x), y0 = std::floor(y);
+    const real fx = x - x0, fy = y - y0;
+    const int ix = static_cast<int>(x0), iy = static_cast<int>(y0);
+    return (1 - fy) * ((1 - fx) * texel(texture, level, ix, iy) + fx * texel(texture, level, ix + 1, iy))
+         + fy * ((1 - fx) * texel(texture, level, ix, iy + 1) + fx * texel(texture, level, ix + 1, iy + 1));
+}
+
+inline color texture_cache::texel(int texture, int level, int x, int y) const {
+    const texture_file& file = *files[texture];
+    const texture_file_level& l = file.levels[level];
+    const int w = static_cast<int>(l.width), h = static_cast<int>(l.height);
+    // A textura se repete nas duas direções
+    x = x < 0 ? x + w : x >= w ? x - w : x;
+    y = y < 0 ? y + h : y >= h ? y - h : y;
+
+    const int size = static_cast<int>(file.header.tile_size);
+    const std::uint64_t tile = static_cast<std::uint64_t>(y / size) * l.tiles_x + x / size;
+    const std::uint8_t* data = find_tile(tile_key(texture, level, tile));
+    const std::uint8_t* p = data + (static_cast<size_t>(y % size) * size + x % size) * 3;
+    return color(decode[p[0]], decode[p[1]], decode[p[2]]);
+}
+
+inline const std::uint8_t* texture_cache::find_tile(std::uint64_t key) const {
+    thread_cache& local = local_cache();
+    if (local.counters_owner != serial) attach_counters(local);
+    thread_counters& counters = *local.counters;
+    counters.lookups.store(counters.lookups.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    auto& slot = local.slots[(key * 0x9e3779b97f4a7c15ull) >> 58];  // 64 posições
+    if (slot.owner == serial && slot.key == key) {
+        counters.hits.store(counters.hits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return slot.data->data();
+    }
+    slot.data = shared_tile(key);
+    slot.owner = serial;
+    slot.key = key;
+    return slot.data->data();
+}
+
+inline shared_ptr<const texture_cache::tile_data> texture_cache::shared_tile(std::uint64_t key) const {
+    shard& s = shards[(key * 0xbf58476d1ce4e5b9ull >> 32) % texture_cache_shards];
+    {
+        std::lock_guard<std::mutex> lock(s.m);
+        auto it = s.tiles.find(key);
+        if (it != s.tiles.end()) {
+            s.lru.splice(s.lru.begin(), s.lru, it->second.position);
+            s.hits++;
+            return it->second.data;
+        }
+    }
+
+    // A leitura acontece sem a trava; se outra thread ler o mesmo tile ao mesmo tempo,
+    // fica valendo o que entrou primeiro
+    auto data = load_tile(key);
+    const int home = static_cast<int>(&s - shards.get());
+    {
+        std::lock_guard<std::mutex> lock(s.m);
+        s.loads++;
+        auto it = s.tiles.find(key);
+        if (it != s.tiles.end()) return it->second.data;
+
+        s.lru.push_front(key);
+        s.tiles.emplace(key, shard::entry{data, s.lru.begin()});
+        s.bytes += data->size();
+        resident += data->size();
+        // O tile recém-lido nunca é descartado, mesmo que sozinho passe do limite
+        evict(s, 1);
+    }
+
+    // O limite vale para a soma das partes: se a desta não bastou, as outras descartam
+    // os seus tiles mais antigos, uma trava de cada vez
+    for (int k = 1; k < texture_cache_shards && resident.load() > budget_bytes; ++k) {
+        shard& other = shards[(home + k) % texture_cache_shards];
+        std::lock_guard<std::mutex> lock(other.m);
+        evict(other, 0);
+    }
+    const std::uint64_t now = resident.load();
+    std::uint64_t previous = peak.load();
+    while (now > previous && !peak.compare_exchange_weak(previous, now)) {}
+    return data;
+}
+
+inline void texture_cache::evict(shard& s, size_t keep) const {
+    while (resident.load() > budget_bytes && s.lru.size() > keep) {
+        auto victim = s.tiles.find(s.lru.back());
+        s.bytes -= victim->second.data->size();
+        resident -= victim->second.data->size();
+        s.tiles.erase(victim);
+        s.lru.pop_back();
+        s.evictions++;
+    }
+}
+
+inline shared_ptr<const texture_cache::tile_data> texture_cache::load_tile(std::uint64_t key) const {
+    texture_file& file = *files[key >> 40];
+    const texture_file_level& level = file.levels[(key >> 35) & 31];
+    const std::uint64_t offset = level.offset + (key & ((std::uint64_t(1) << 35) - 1)) * file.tile_bytes;
+    auto data = make_shared<tile_data>(file.tile_bytes);
+    bool ok;
+#ifdef TEXTURE_CACHE_PREAD
+    // pread não mexe na posição do arquivo, então as threads leem ao mesmo tempo
+    size_t done = 0;
+    ok = true;
+    while (done < data->size()) {
+        const ssize_t n = ::pread(file.fd, data->data() + done, data->size() - done,
+                                  static_cast<off_t>(offset + done));
+        if (n <= 0) { ok = false; break; }
+        done += static_cast<size_t>(n);
+    }
+#else
+    {
+        std::lock_guard<std::mutex> lock(file.m);
+        file.in.clear();
+        file.in.seekg(static_cast<std::streamoff>(offset));
+        ok = static_cast<bool>(file.in.read(reinterpret_cast<char*>(data->data()),
+                                            static_cast<std::streamsize>(data->size())));
+    }
+#endif
+    if (!ok) {
+        std::fill(data->begin(), data->end(), std::uint8_t(0));
+        read_errors++;
+    }
+    return data;
+}
+
+inline void texture_cache::attach_counters(thread_cache& local) const {
+    local.counters = make_shared<thread_counters>();
+    local.counters_owner = serial;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // Os contadores das threads que já terminaram (só o registro os segura) são somados
+    // e liberados, para que o registro não cresça com as threads de cada renderização
+    auto keep = registry.begin();
+    for (auto& c : registry) {
+        if (c.use_count() == 1) {
+            retired_lookups += c->lookups.load();
+            retired_hits += c->hits.load();
+        } else {
+            *keep++ = std::move(c);
+        }
+    }
+    registry.erase(keep, registry.end());
+    registry.push_back(local.counters);
+}
+
+inline texture_cache::statistics texture_cache::stats() const {
+    statistics result;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        result.lookups = retired_lookups;
+        result.thread_hits = retired_hits;
+        for (const auto& c : registry) {
+            result.lookups += c->lookups.load();
+            result.thread_hits += c->hits.load();
+        }
+    }
+    for (int k = 0; k < texture_cache_shards; ++k) {
+        std::lock_guard<std::mutex> lock(shards[k].m);
+        result.shared_hits += shards[k].hits;
+        result.loads += shards[k].loads;
+        result.evictions += shards[k].evictions;
+        result.resident_bytes += shards[k].bytes;
+    }
+    result.read_errors = read_errors.load();
+    result.peak_bytes = peak.load();
+    return result;
+}
+
+#endif
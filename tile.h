@@ -0,0 +1,66 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Retângulo de pixels [x0,x1) x [y0,y1) renderizado como uma unidade de trabalho.
+struct tile {
+    int x0, y0;  // Canto inicial (inclusivo)
+    int x1, y1;  // Canto final (exclusivo)
+
+    int width() const { return x1 - x0; }
+    int height() const { return y1 - y0; }
+    int pixel_count() const { return width() * height(); }
+};
+
+// Espalha os 16 bits menos significativos de x, deixando um zero entre cada bit.
+inline std::uint32_t morton_part1by1(std::uint32_t x) {
+    x &= 0x0000ffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// Código de Morton (curva Z) de uma coordenada 2D de tile.
+inline std::uint32_t morton_encode(std::uint32_t x, std::uint32_t y) {
+    return morton_part1by1(x) | (morton_part1by1(y) << 1);
+}
+
+// Divide a imagem em tiles de tile_size x tile_size pixels (os das bordas podem ser menores)
+// e os ordena pela curva de Morton, para que tiles consecutivos sejam vizinhos na imagem
+// e os raios primários de um mesmo worker continuem acessando a mesma região da cena.
+inline std::vector<tile> make_tiles(int image_width, int image_height, int tile_size) {
+    assert(tile_size >= 1 && image_width >= 0 && image_height >= 0);
+    const int tiles_x = (image_width + tile_size - 1) / tile_size;
+    const int tiles_y = (image_height + tile_size - 1) / tile_size;
+
+    std::vector<std::pair<std::uint32_t, tile>> keyed;
+    keyed.reserve(static_cast<size_t>(tiles_x) * tiles_y);
+
+    for (int ty = 0; ty < tiles_y; ++ty) {
+        for (int tx = 0; tx < tiles_x; ++tx) {
+            tile t;
+            t.x0 = tx * tile_size;
+            t.y0 = ty * tile_size;
+            t.x1 = std::min(t.x0 + tile_size, image_width);
+            t.y1 = std::min(t.y0 + tile_size, image_height);
+            keyed.emplace_back(morton_encode(tx, ty), t);
+        }
+    }
+
+    std::sort(keyed.begin(), keyed.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<tile> tiles;
+    tiles.reserve(keyed.size());
+    for (const auto& k : keyed)
+        tiles.push_back(k.second);
+    return tiles;
+}
+
+#endif
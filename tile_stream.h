@@ -0,0 +1,304 @@
+#ifndef TILE_STREAM_H
+#define TILE_STREAM_H
+
+#include "rtweekend.h"
+
+#include "accumulation.h"
+#include "framebuffer.h"
+#include "tile.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TILE_STREAM_POSIX 1
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Saída contínua da renderização: cada tile terminado vira uma mensagem binária com o
+// retângulo e a radiância média dos pixels, mandada para a saída padrão, um socket Unix
+// ou um FIFO enquanto a imagem ainda está sendo calculada. O programa stream_view junta
+// as mensagens na imagem e a regrava de tempos em tempos.
+//
+// Os workers não esperam pela escrita: cada um serializa o seu tile e o deixa numa fila,
+// esvaziada por uma thread própria. Se o leitor for lento, um tile que ainda está na fila
+// quando chega a versão seguinte (a passada seguinte da renderização progressiva) é
+// substituído no lugar, então a fila nunca passa de um quadro inteiro.
+//
+// Formato (little-endian, como os outros formatos binários): um stream_header e uma
+// sequência de mensagens, cada uma um stream_message seguido, nos tiles, de
+// largura*altura*3 floats, linha a linha a partir de y0, com as linhas na ordem do
+// framebuffer (j = 0 embaixo). A radiância já está dividida pelas amostras do pixel.
+
+struct stream_header {
+    char magic[8];          // "RTSTRM01"
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t reserved;
+};
+
+enum class stream_message_type : std::uint32_t {
+    tile = 1,   // Pixels de um retângulo
+    pass = 2,   // A passada 'pass' terminou: a imagem recebida é uma prévia completa
+    end = 3,    // Fim da renderização
+};
+
+struct stream_message {
+    std::uint32_t type;     // stream_message_type
+    std::uint32_t pass;     // Passada a que os pixels pertencem (a partir de 1)
+    std::uint32_t x0, y0;   // Retângulo [x0, x0+width) x [y0, y0+height); zero fora dos tiles
+    std::uint32_t width, height;
+};
+
+constexpr std::uint32_t stream_version = 1;
+
+class tile_stream {
+public:
+    tile_stream() {}
+    ~tile_stream() { close(); }
+
+    tile_stream(const tile_stream&) = delete;
+    tile_stream& operator=(const tile_stream&) = delete;
+
+    // Abre o destino e começa a thread de escrita. 'target' é "-" para a saída padrão,
+    // o caminho de um socket Unix em que um leitor já escuta (stream_view --listen) ou
+    // qualquer outro arquivo, por exemplo um FIFO. Em caso de erro retorna false e
+    // descreve o problema em 'error'.
+    bool open(const std::string& target, int width, int height, std::string& error);
+
+    // Manda as mensagens que ainda estão na fila, a de fim e fecha o destino. Retorna
+    // false se alguma escrita falhou (por exemplo, o leitor fechou a conexão).
+    bool close();
+
+    bool is_open() const { return writer.joinable(); }
+
+    // Chamadas pelos workers, de qualquer thread. O framebuffer guarda somas de amostras,
+    // normalizadas por 'scale'; o buffer de acumulação dá a média de cada pixel.
+    void send_tile(const tile& t, const framebuffer& fb, double scale, std::uint32_t pass);
+    void send_tile(const tile& t, const accumulation_buffer& acc, std::uint32_t pass);
+    void end_pass(std::uint32_t pass);
+
+    // Totais para o relatório
+    std::uint64_t messages_sent() const { return sent; }
+    std::uint64_t messages_replaced() const { return replaced; }
+    std::uint64_t bytes_sent() const { return bytes; }
+
+private:
+    struct message {
+        std::uint64_t key;                // Tile (x0, y0), ou ~0 nas mensagens sem pixels
+        std::vector<std::uint8_t> data;   // stream_message seguido dos pixels
+    };
+
+    static std::vector<std::uint8_t> make_message(stream_message_type type, std::uint32_t pass, const tile& t);
+    void enqueue(std::uint64_t key, std::vector<std::uint8_t> data);
+    void write_loop();
+    bool write_all(const std::uint8_t* data, size_t size);
+
+    int fd = -1;
+    bool owns_fd = false;
+    std::thread writer;
+
+    std::mutex m;
+    std::condition_variable ready;
+    std::deque<message> queue;
+    std::unordered_map<std::uint64_t, std::uint64_t> queued;  // Tile -> posição absoluta na fila
+    std::uint64_t popped = 0;   // Mensagens já retiradas da fila
+    bool closing = false;
+    std::uint64_t replaced = 0;
+
+    // Só a thread de escrita mexe nestes até close()
+    bool failed = false;
+    std::uint64_t sent = 0;
+    std::uint64_t bytes = 0;
+};
+
+
+inline bool tile_stream::open(const std::string& target, int width, int height, std::string& error) {
+#ifdef TILE_STREAM_POSIX
+    close();
+    if (target == "-") {
+        fd = STDOUT_FILENO;
+        owns_fd = false;
+    } else {
+        struct stat st;
+        if (::stat(target.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            if (target.size() >= sizeof(address.sun_path)) {
+                error = "caminho de socket longo demais: " + target;
+                return false;
+            }
+            std::memcpy(address.sun_path, target.c_str(), target.size() + 1);
+            fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+                error = "não foi possível conectar a " + target + ": " + std::strerror(errno);
+                if (fd >= 0) ::close(fd);
+                fd = -1;
+                return false;
+            }
+        } else {
+            fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                error = "não foi possível abrir " + target + ": " + std::strerror(errno);
+                return false;
+            }
+        }
+        owns_fd = true;
+    }
+    // Um leitor que fecha o pipe não deve derrubar a renderização: a escrita falha e o
+    // resto do stream é descartado
+    std::signal(SIGPIPE, SIG_IGN);
+
+    stream_header header{};
+    std::memcpy(header.magic, "RTSTRM01", 8);
+    header.version = stream_version;
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    std::vector<std::uint8_t> data(sizeof(header));
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    closing = false;
+    failed = false;
+    popped = sent = replaced = bytes = 0;
+    enqueue(~std::uint64_t(0), std::move(data));
+    writer = std::thread([this] { write_loop(); });
+    return true;
+#else
+    (void)target; (void)width; (void)height;
+    error = "o stream de tiles só existe em sistemas POSIX";
+    return false;
+#endif
+}
+
+inline bool tile_stream::close() {
+    if (!writer.joinable()) return true;
+    enqueue(~std::uint64_t(0), make_message(stream_message_type::end, 0, tile{0, 0, 0, 0}));
+    {
+        std::lock_guard<std::mutex> lock(m);
+        closing = true;
+    }
+    ready.notify_one();
+    writer.join();
+#ifdef TILE_STREAM_POSIX
+    if (owns_fd) ::close(fd);
+#endif
+    fd = -1;
+    return !failed;
+}
+
+inline std::vector<std::uint8_t> tile_stream::make_message(stream_message_type type, std::uint32_t pass, const tile& t) {
+    stream_message head{};
+    head.type = static_cast<std::uint32_t>(type);
+    head.pass = pass;
+    head.x0 = static_cast<std::uint32_t>(t.x0);
+    head.y0 = static_cast<std::uint32_t>(t.y0);
+    head.width = static_cast<std::uint32_t>(t.width());
+    head.height = static_cast<std::uint32_t>(t.height());
+    std::vector<std::uint8_t> data(sizeof(head) + static_cast<size_t>(t.pixel_count()) * 3 * sizeof(float));
+    std::memcpy(data.data(), &head, sizeof(head));
+    return data;
+}
+
+inline void tile_stream::send_tile(const tile& t, const framebuffer& fb, double scale, std::uint32_t pass) {
+    auto data = make_message(stream_message_type::tile, pass, t);
+    float* dst = reinterpret_cast<float*>(data.data() + sizeof(stream_message));
+    const float s = static_cast<float>(scale);
+    for (int j = t.y0; j < t.y1; ++j) {
+        const float* src = &fb.rgb[(static_cast<size_t>(j) * fb.width + t.x0) * 3];
+        for (int k = 0; k < t.width() * 3; ++k)
+            *dst++ = src[k] * s;
+    }
+    enqueue(static_cast<std::uint64_t>(t.y0) << 32 | static_cast<std::uint32_t>(t.x0), std::move(data));
+}
+
+inline void tile_stream::send_tile(const tile& t, const accumulation_buffer& acc, std::uint32_t pass) {
+    auto data = make_message(stream_message_type::tile, pass, t);
+    float* dst = reinterpret_cast<float*>(data.data() + sizeof(stream_message));
+    for (int j = t.y0; j < t.y1; ++j) {
+        for (int i = t.x0; i < t.x1; ++i) {
+            const color c = acc.mean(static_cast<size_t>(j) * acc.width + i);
+            *dst++ = static_cast<float>(c.x());
+            *dst++ = static_cast<float>(c.y());
+            *dst++ = static_cast<float>(c.z());
+        }
+    }
+    enqueue(static_cast<std::uint64_t>(t.y0) << 32 | static_cast<std::uint32_t>(t.x0), std::move(data));
+}
+
+inline void tile_stream::end_pass(std::uint32_t pass) {
+    enqueue(~std::uint64_t(0), make_message(stream_message_type::pass, pass, tile{0, 0, 0, 0}));
+}
+
+inline void tile_stream::enqueue(std::uint64_t key, std::vector<std::uint8_t> data) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (key != ~std::uint64_t(0)) {
+            auto it = queued.find(key);
+            if (it != queued.end() && it->second >= popped) {
+                // A versão anterior do tile ainda não saiu: a nova toma o lugar dela
+                queue[it->second - popped].data.swap(data);
+                replaced++;
+                return;
+            }
+            queued[key] = popped + queue.size();
+        }
+        queue.push_back(message{key, std::move(data)});
+    }
+    ready.notify_one();
+}
+
+inline void tile_stream::write_loop() {
+    for (;;) {
+        message next;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            ready.wait(lock, [&] { return !queue.empty() || closing; });
+            if (queue.empty()) return;
+            next = std::move(queue.front());
+            queue.pop_front();
+            auto it = queued.find(next.key);
+            if (it != queued.end() && it->second == popped) queued.erase(it);
+            popped++;
+        }
+        // Depois de uma falha o resto é descartado, mas a fila continua sendo esvaziada
+        if (failed) continue;
+        if (!write_all(next.data.data(), next.data.size())) {
+            failed = true;
+            continue;
+        }
+        sent++;
+        bytes += next.data.size();
+    }
+}
+
+inline bool tile_stream::write_all(const std::uint8_t* data, size_t size) {
+#ifdef TILE_STREAM_POSIX
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+#else
+    (void)data; (void)size;
+    return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "rtweekend.h"
+
+#include "aabb.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Transformação afim x -> A x + b, com A uma matriz 3x3 qualquer (rotação, escala,
+// cisalhamento) e b uma translação. Os coeficientes ficam em double para que
+// composições de vários níveis não acumulem o erro do float; a aplicação aos pontos e
+// vetores é feita no tipo 'real' da geometria.
+class affine_transform {
+public:
+    // Identidade
+    affine_transform() : m{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}} {}
+
+    static affine_transform translate(const vec3& offset);
+    static affine_transform scale(double sx, double sy, double sz);
+    // Rotação de 'degrees' graus em torno de 'axis' (regra da mão direita). Múltiplos
+    // de 90 graus dão senos e cossenos exatos.
+    static affine_transform rotate(const vec3& axis, double degrees);
+    // Leva os eixos x, y e z para as colunas 'x', 'y' e 'z' e a origem para 'origin'
+    static affine_transform basis(const vec3& x, const vec3& y, const vec3& z, const point3& origin);
+
+    // Composição: aplicar o resultado é aplicar 'inner' e depois esta transformação
+    affine_transform operator*(const affine_transform& inner) const;
+
+    // Transformação inversa. A parte linear não pode ser singular.
+    affine_transform inverse() const;
+
+    // Determinante da parte linear: o fator de escala dos volumes
+    double determinant() const {
+        return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+             + m[0][1] * (m[1][2] * m[2][0] - m[1][0] * m[2][2])
+             + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    }
+
+    point3 apply_point(const point3& p) const {
+        return point3(real(m[0][0] * p[0] + m[0][1] * p[1] + m[0][2] * p[2] + m[0][3]),
+                      real(m[1][0] * p[0] + m[1][1] * p[1] + m[1][2] * p[2] + m[1][3]),
+                      real(m[2][0] * p[0] + m[2][1] * p[1] + m[2][2] * p[2] + m[2][3]));
+    }
+
+    vec3 apply_vector(const vec3& v) const {
+        return vec3(real(m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2]),
+                    real(m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2]),
+                    real(m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]));
+    }
+
+    // Aplica a transposta da parte linear. Chamada na inversa, transforma normais: a
+    // normal de uma superfície transformada por A é (A^-1)^T n.
+    vec3 apply_transposed(const vec3& v) const {
+        return vec3(real(m[0][0] * v[0] + m[1][0] * v[1] + m[2][0] * v[2]),
+                    real(m[0][1] * v[0] + m[1][1] * v[1] + m[2][1] * v[2]),
+                    real(m[0][2] * v[0] + m[1][2] * v[1] + m[2][2] * v[2]));
+    }
+
+    // Menor caixa alinhada aos eixos que contém a imagem de 'box' (Arvo, "Transforming
+    // Axis-Aligned Bounding Boxes", 1990): em cada eixo, cada coluna contribui com o
+    // menor e o maior dos seus dois produtos.
+    aabb apply_box(const aabb& box) const;
+
+public:
+    double m[3][4];  // Linhas [A | b]
+};
+
+
+inline affine_transform affine_transform::translate(const vec3& offset) {
+    affine_transform t;
+    for (int i = 0; i < 3; ++i) t.m[i][3] = offset[i];
+    return t;
+}
+
+inline affine_transform affine_transform::scale(double sx, double sy, double sz) {
+    affine_transform t;
+    t.m[0][0] = sx;
+    t.m[1][1] = sy;
+    t.m[2][2] = sz;
+    return t;
+}
+
+inline affine_transform affine_transform::rotate(const vec3& axis, double degrees) {
+    double c, s;
+    const double quarters = degrees / 90;
+    if (quarters == std::floor(quarters)) {
+        const int q = static_cast<int>(((static_cast<long long>(quarters) % 4) + 4) % 4);
+        const double cosines[4] = {1, 0, -1, 0};
+        c = cosines[q];
+        s = cosines[(q + 3) % 4];
+    } else {
+        c = std::cos(degrees_to_radians(degrees));
+        s = std::sin(degrees_to_radians(degrees));
+    }
+    const double length = std::sqrt(static_cast<double>(axis.length_squared()));
+    const double x = axis.x() / length, y = axis.y() / length, z = axis.z() / length;
+    // Fórmula de Rodrigues
+    affine_transform t;
+    t.m[0][0] = c + x * x * (1 - c);     t.m[0][1] = x * y * (1 - c) - z * s; t.m[0][2] = x * z * (1 - c) + y * s;
+    t.m[1][0] = y * x * (1 - c) + z * s; t.m[1][1] = c + y * y * (1 - c);     t.m[1][2] = y * z * (1 - c) - x * s;
+    t.m[2][0] = z * x * (1 - c) - y * s; t.m[2][1] = z * y * (1 - c) + x * s; t.m[2][2] = c + z * z * (1 - c);
+    return t;
+}
+
+inline affine_transform affine_transform::basis(const vec3& x, const vec3& y, const vec3& z, const point3& origin) {
+    affine_transform t;
+    for (int i = 0; i < 3; ++i) {
+        t.m[i][0] = x[i];
+        t.m[i][1] = y[i];
+        t.m[i][2] = z[i];
+        t.m[i][3] = origin[i];
+    }
+    return t;
+}
+
+inline affine_transform affine_transform::operator*(const affine_transform& inner) const {
+    affine_transform t;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            t.m[i][j] = m[i][0] * inner.m[0][j] + m[i][1] * inner.m[1][j] + m[i][2] * inner.m[2][j];
+        }
+        t.m[i][3] += m[i][3];
+    }
+    return t;
+}
+
+inline affine_transform affine_transform::inverse() const {
+    // Inversa da parte linear pela adjunta; a translação passa a ser -A^-1 b
+    const double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    const double c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    const double c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    const double inv_det = 1 / (m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02);
+
+    affine_transform t;
+    t.m[0][0] = c00 * inv_det;
+    t.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv_det;
+    t.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv_det;
+    t.m[1][0] = c01 * inv_det;
+    t.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv_det;
+    t.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv_det;
+    t.m[2][0] = c02 * inv_det;
+    t.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv_det;
+    t.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv_det;
+    for (int i = 0; i < 3; ++i)
+        t.m[i][3] = -(t.m[i][0] * m[0][3] + t.m[i][1] * m[1][3] + t.m[i][2] * m[2][3]);
+    return t;
+}
+
+inline aabb affine_transform::apply_box(const aabb& box) const {
+    point3 lo, hi;
+    for (int i = 0; i < 3; ++i) {
+        double low = m[i][3], high = m[i][3];
+        for (int j = 0; j < 3; ++j) {
+            const double a = m[i][j] * box.minimum[j];
+            const double b = m[i][j] * box.maximum[j];
+            low += std::min(a, b);
+            high += std::max(a, b);
+        }
+        // Em float o arredondamento não pode encolher a caixa
+        lo[i] = static_cast<real>(low);
+        hi[i] = static_cast<real>(high);
+        if (lo[i] > low) lo[i] = std::nextafter(lo[i], static_cast<real>(-infinity));
+        if (hi[i] < high) hi[i] = std::nextafter(hi[i], static_cast<real>(infinity));
+    }
+    return aabb(lo, hi);
+}
+
+#endif
@@ -0,0 +1,725 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include "rtweekend.h"
+
+#include "aabb.h"
+#include "bvh.h"
+#include "hittable.h"
+#include "simd.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Geometria de uma malha de triângulos em dois buffers compartilhados: as coordenadas
+// dos vértices e três índices de vértice por triângulo. É o que os leitores de
+// mesh_io.h produzem.
+struct mesh_data {
+    std::vector<real> positions;          // x, y, z de cada vértice
+    std::vector<std::uint32_t> indices;   // Vértices de cada triângulo, três a três
+
+    size_t vertex_count() const { return positions.size() / 3; }
+    size_t triangle_count() const { return indices.size() / 3; }
+};
+
+// Raio preparado para o teste estanque (watertight) de Woop, Benthin e Wald (2013). O
+// eixo de maior componente da direção vira z e um cisalhamento leva a direção para
+// (0, 0, 1); os vértices, já transladados para a origem do raio, são cisalhados da mesma
+// forma, e o raio atinge o triângulo se a origem do plano xy está dentro da projeção,
+// o que é decidido pelo sinal das três funções de aresta. Uma aresta compartilhada por
+// dois triângulos dá a mesma função com o sinal trocado, então nenhum raio passa entre
+// eles nem atinge os dois.
+struct watertight_ray {
+    explicit watertight_ray(const ray& r);
+
+    int kx, ky, kz;      // Eixos na ordem do cisalhamento; kz é o dominante
+    real sx, sy, sz;     // Coeficientes do cisalhamento
+    real ox, oy, oz;     // Origem do raio nos eixos kx, ky, kz
+};
+
+inline watertight_ray::watertight_ray(const ray& r) {
+    const vec3 d = r.direction();
+    const real ax = fabs(d.x()), ay = fabs(d.y()), az = fabs(d.z());
+    kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+    kx = kz == 2 ? 0 : kz + 1;
+    ky = kx == 2 ? 0 : kx + 1;
+    if (d[kz] < 0) std::swap(kx, ky);  // Mantém a orientação dos triângulos
+    sx = d[kx] / d[kz];
+    sy = d[ky] / d[kz];
+    sz = real(1) / d[kz];
+    const point3 o = r.origin();
+    ox = o[kx];
+    oy = o[ky];
+    oz = o[kz];
+}
+
+// Teste de um triângulo de vértices a, b e c. Em float, quando alguma função de aresta
+// dá exatamente zero ela é recalculada em double, como no artigo, para que raios que
+// passam rente a uma aresta não sejam decididos por um arredondamento. As versões
+// vetoriais de triangle_mesh fazem as mesmas operações na mesma ordem.
+__attribute__((optimize("fp-contract=off")))
+inline bool watertight_hit(const watertight_ray& w, const real* a, const real* b, const real* c,
+                           real t_min, real t_max, real& t) {
+    const real az = a[w.kz] - w.oz, bz = b[w.kz] - w.oz, cz = c[w.kz] - w.oz;
+    const real ax = (a[w.kx] - w.ox) - w.sx * az, ay = (a[w.ky] - w.oy) - w.sy * az;
+    const real bx = (b[w.kx] - w.ox) - w.sx * bz, by = (b[w.ky] - w.oy) - w.sy * bz;
+    const real cx = (c[w.kx] - w.ox) - w.sx * cz, cy = (c[w.ky] - w.oy) - w.sy * cz;
+
+    real u = cx * by - cy * bx;
+    real v = ax * cy - ay * cx;
+    real e = bx * ay - by * ax;
+    if constexpr (std::is_same<real, float>::value) {
+        if (u == 0 || v == 0 || e == 0) {
+            u = static_cast<real>(double(cx) * double(by) - double(cy) * double(bx));
+            v = static_cast<real>(double(ax) * double(cy) - double(ay) * double(cx));
+            e = static_cast<real>(double(bx) * double(ay) - double(by) * double(ax));
+        }
+    }
+    if ((u < 0 || v < 0 || e < 0) && (u > 0 || v > 0 || e > 0)) return false;
+    const real det = u + v + e;
+    if (det == 0) return false;
+
+    t = (u * (w.sz * az) + v * (w.sz * bz) + e * (w.sz * cz)) / det;
+    return t >= t_min && t <= t_max;
+}
+
+// Malha de triângulos com um único material. Os vértices ficam no mesh_data
+// compartilhado e os triângulos não viram objetos: a malha guarda só os índices, na
+// ordem das folhas de uma BVH própria, e entra na cena como um hittable qualquer. As
+// folhas são testadas 4 ou 8 triângulos de cada vez (AVX2, AVX-512; o dobro em float),
+// buscando as coordenadas nos buffers com instruções gather; o resultado é o mesmo
+// em todos os conjuntos de instruções.
+class triangle_mesh final : public hittable {
+public:
+    // Os índices da geometria precisam ser menores que o número de vértices (os leitores
+    // de mesh_io.h garantem isso)
+    triangle_mesh(shared_ptr<const mesh_data> geometry, std::uint32_t mat_id);
+
+    virtual bool hit(const ray& r, real t_min, real t_max, hit_record& rec) const override;
+    virtual bool occluded(const ray& r, real t_min, real t_max) const override;
+    virtual bool bounding_box(double time0, double time1, aabb& output_box) const override;
+
+    int triangle_count() const { return triangles; }
+    int node_count() const { return static_cast<int>(nodes.size()); }
+
+    // Força um conjunto de instruções (para comparações); por padrão usa o melhor disponível.
+    // As folhas são dimensionadas para o conjunto ativo na construção.
+    static simd_level& kernel() {
+        static simd_level level = detect_simd_level();
+        return level;
+    }
+
+    // Triângulos testados de uma vez por cada conjunto de instruções
+    static int lane_width(simd_level level) {
+        switch (level) {
+            case simd_level::avx512: return 64 / sizeof(real);
+            case simd_level::avx2:   return 32 / sizeof(real);
+            default:                 return 1;
+        }
+    }
+
+public:
+    // Triângulos degenerados no fim do buffer de índices, para que a última folha
+    // possa ser lida em grupos inteiros pelo maior vetor (8 doubles ou 16 floats)
+    static constexpr int lane_padding = 64 / sizeof(real);
+
+private:
+    // Procura, entre os triângulos [first, first + count) na ordem das folhas, o mais
+    // próximo com t em [t_min, t_max]; devolve a sua posição (ou -1) e o t em t_hit.
+    // Com any_hit devolve o primeiro encontrado. Em empates vence a maior posição.
+    int intersect(const watertight_ray& w, int first, int count, real t_min, real t_max,
+                  bool any_hit, real& t_hit) const;
+    int intersect_scalar(const watertight_ray& w, int first, int count, real t_min, real t_max,
+                         bool any_hit, real& t_hit) const;
+#ifdef RT_SIMD_X86
+    int intersect_avx2(const watertight_ray& w, int first, int count, real t_min, real t_max,
+                       bool any_hit, real& t_hit) const;
+    int intersect_avx512(const watertight_ray& w, int first, int count, real t_min, real t_max,
+                         bool any_hit, real& t_hit) const;
+#endif
+
+    // Escolhe, entre o candidato das lanes e o de um grupo refeito no teste escalar, o
+    // de menor t (em empate, a maior posição)
+    static void merge_candidate(int index, real t, int& best, real& best_t) {
+        if (index < 0) return;
+        if (best < 0 || t < best_t || (t == best_t && index > best)) {
+            best = index;
+            best_t = t;
+        }
+    }
+
+private:
+    shared_ptr<const mesh_data> geometry;
+    std::vector<std::uint32_t> indices;  // Três por triângulo, na ordem das folhas, mais o preenchimento
+    std::vector<bvh_node> nodes;         // Árvore achatada; nas folhas, offset e count contam triângulos
+    aabb box;
+    std::uint32_t mat_id;
+    int triangles = 0;
+};
+
+
+inline triangle_mesh::triangle_mesh(shared_ptr<const mesh_data> geometry, std::uint32_t mat_id)
+    : geometry(std::move(geometry)), mat_id(mat_id)
+{
+    const mesh_data& g = *this->geometry;
+    const real* P = g.positions.data();
+    triangles = static_cast<int>(g.triangle_count());
+    if (triangles == 0) return;
+
+    std::vector<bvh_build_prim> prims(triangles);
+    for (int k = 0; k < triangles; ++k) {
+        aabb tri_box;
+        for (int j = 0; j < 3; ++j) {
+            const real* v = P + 3 * static_cast<size_t>(g.indices[3 * k + j]);
+            const point3 p(v[0], v[1], v[2]);
+            tri_box = surrounding_box(tri_box, aabb(p, p));
+        }
+        prims[k] = {tri_box, tri_box.centroid(), k};
+        box = surrounding_box(box, tri_box);
+    }
+
+    // As folhas têm até uma largura de vetor de triângulos, e a SAH conta o custo de uma
+    // folha por grupos testados juntos
+    bvh_build_settings settings;
+    settings.leaf_group = lane_width(kernel());
+    settings.max_leaf_size = std::max(settings.max_leaf_size, settings.leaf_group);
+    bvh_builder(settings).build(prims, nodes);
+
+    indices.assign(3 * (static_cast<size_t>(triangles) + lane_padding), 0);
+    for (int k = 0; k < triangles; ++k)
+        for (int j = 0; j < 3; ++j)
+            indices[3 * k + j] = g.indices[3 * static_cast<size_t>(prims[k].index) + j];
+}
+
+inline int triangle_mesh::intersect(const watertight_ray& w, int first, int count, real t_min, real t_max,
+                                    bool any_hit, real& t_hit) const {
+    RT_STAT(primitive_tests += count);
+    switch (kernel()) {
+#ifdef RT_SIMD_X86
+        case simd_level::avx512: return intersect_avx512(w, first, count, t_min, t_max, any_hit, t_hit);
+        case simd_level::avx2:   return intersect_avx2(w, first, count, t_min, t_max, any_hit, t_hit);
+#endif
+        default:                 return intersect_scalar(w, first, count, t_min, t_max, any_hit, t_hit);
+    }
+}
+
+inline int triangle_mesh::intersect_scalar(const watertight_ray& w, int first, int count, real t_min,
+                                           real t_max, bool any_hit, real& t_hit) const {
+    const real* P = geometry->positions.data();
+    int best = -1;
+    for (int i = first; i < first + count; ++i) {
+        const std::uint32_t* tri = &indices[3 * static_cast<size_t>(i)];
+        real t;
+        if (!watertight_hit(w, P + 3 * static_cast<size_t>(tri[0]), P + 3 * static_cast<size_t>(tri[1]),
+                            P + 3 * static_cast<size_t>(tri[2]), t_min, t_max, t))
+            continue;
+        t_max = t;
+        best = i;
+        if (any_hit) break;
+    }
+    t_hit = t_max;
+    return best;
+}
+
+inline bool triangle_mesh::hit(const ray& r, real t_min, real t_max, hit_record& rec) const {
+    if (nodes.empty()) return false;
+
+    const watertight_ray w(r);
+    const point3 origin = r.origin();
+    const vec3 dir = r.direction();
+    const vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+    const bool dir_is_neg[3] = { inv_dir.x() < 0, inv_dir.y() < 0, inv_dir.z() < 0 };
+
+    int best = -1;
+    real closest_so_far = t_max;
+    int stack[64];
+    int stack_size = 0;
+    int current = 0;
+
+    for (;;) {
+        const bvh_node& node = nodes[current];
+        real t_entry;
+        RT_STAT(box_tests++);
+
+        if (node.box.robust_hit(origin, inv_dir, t_min, closest_so_far, t_entry)) {
+            if (node.count > 0) {
+                real t;
+                const int k = intersect(w, node.offset, node.count, t_min, closest_so_far, false, t);
+                if (k >= 0) {
+                    best = k;
+                    closest_so_far = t;
+                }
+            } else {
+                if (dir_is_neg[node.axis]) {
+                    stack[stack_size++] = current + 1;
+                    current = node.offset;
+                } else {
+                    stack[stack_size++] = node.offset;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stack_size == 0) break;
+        current = stack[--stack_size];
+    }
+
+    if (best < 0) return false;
+
+    // Normal geométrica, do lado em que a ordem dos vértices é anti-horária
+    const real* P = geometry->positions.data();
+    const std::uint32_t* tri = &indices[3 * static_cast<size_t>(best)];
+    const real* a = P + 3 * static_cast<size_t>(tri[0]);
+    const real* b = P + 3 * static_cast<size_t>(tri[1]);
+    const real* c = P + 3 * static_cast<size_t>(tri[2]);
+    const vec3 e1(b[0] - a[0], b[1] - a[1], b[2] - a[2]);
+    const vec3 e2(c[0] - a[0], c[1] - a[1], c[2] - a[2]);
+    rec.t = closest_so_far;
+    rec.p = r.at(rec.t);
+    rec.set_face_normal(r, unit_vector(cross(e1, e2)));
+    rec.mat_id = mat_id;
+    rec.local_normal = vec3(0, 0, 0);  // Os arquivos de malha lidos não trazem coordenadas de textura
+    rec.uv_length = 0;
+    return true;
+}
+
+// Mesma travessia de hit, parando no primeiro triângulo encontrado
+inline bool triangle_mesh::occluded(const ray& r, real t_min, real t_max) const {
+    if (nodes.empty()) return false;
+
+    const watertight_ray w(r);
+    const point3 origin = r.origin();
+    const vec3 dir = r.direction();
+    const vec3 inv_dir(1.0 / dir.x(), 1.0 / dir.y(), 1.0 / dir.z());
+    const bool dir_is_neg[3] = { inv_dir.x() < 0, inv_dir.y() < 0, inv_dir.z() < 0 };
+
+    int stack[64];
+    int stack_size = 0;
+    int current = 0;
+
+    for (;;) {
+        const bvh_node& node = nodes[current];
+        real t_entry;
+        RT_STAT(box_tests++);
+
+        if (node.box.robust_hit(origin, inv_dir, t_min, t_max, t_entry)) {
+            if (node.count > 0) {
+                real t;
+                if (intersect(w, node.offset, node.count, t_min, t_max, true, t) >= 0) return true;
+            } else {
+                if (dir_is_neg[node.axis]) {
+                    stack[stack_size++] = current + 1;
+                    current = node.offset;
+                } else {
+                    stack[stack_size++] = node.offset;
+                    current = current + 1;
+                }
+                continue;
+            }
+        }
+
+        if (stack_size == 0) break;
+        current = stack[--stack_size];
+    }
+
+    return false;
+}
+
+inline bool triangle_mesh::bounding_box(double time0, double time1, aabb& output_box) const {
+    if (triangles == 0) return false;
+    output_box = box;
+    return true;
+}
+
+#ifdef RT_SIMD_X86
+
+// Cada lane testa um triângulo: os três índices de vértice vêm de um gather no buffer de
+// índices e cada coordenada de um gather no buffer de vértices. As lanes além do fim da
+// folha leem os triângulos seguintes (ou o preenchimento) e são descartadas pela máscara.
+// Como em sphere_set, cada lane guarda o melhor t e a posição (relativa ao início da
+// folha) do melhor triângulo, e a contração em FMA fica desligada.
+#ifndef RT_FLOAT
+
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+inline int triangle_mesh::intersect_avx2(const watertight_ray& w, int first, int count, real t_min,
+                                         real t_max, bool any_hit, real& t_hit) const {
+    const double* P = geometry->positions.data();
+    const int* I = reinterpret_cast<const int*>(indices.data());
+
+    const __m256d ox = _mm256_set1_pd(w.ox), oy = _mm256_set1_pd(w.oy), oz = _mm256_set1_pd(w.oz);
+    const __m256d sx = _mm256_set1_pd(w.sx), sy = _mm256_set1_pd(w.sy), sz = _mm256_set1_pd(w.sz);
+    const __m256d tmin = _mm256_set1_pd(t_min), tmax = _mm256_set1_pd(t_max);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));  // Máscara dos gathers
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d end = _mm256_set1_pd(count);
+    const __m128i stride = _mm_setr_epi32(0, 3, 6, 9);
+
+    __m256d best_t = tmax;
+    __m256d best_i = _mm256_set1_pd(-1.0);
+    __m256d idx = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+
+    for (int i = 0; i < count; i += 4, idx = _mm256_add_pd(idx, four)) {
+        const __m128i tri = _mm_add_epi32(_mm_set1_epi32(3 * (first + i)), stride);
+        __m128i va = _mm_i32gather_epi32(I, tri, 4);
+        __m128i vb = _mm_i32gather_epi32(I + 1, tri, 4);
+        __m128i vc = _mm_i32gather_epi32(I + 2, tri, 4);
+        va = _mm_add_epi32(va, _mm_add_epi32(va, va));
+        vb = _mm_add_epi32(vb, _mm_add_epi32(vb, vb));
+        vc = _mm_add_epi32(vc, _mm_add_epi32(vc, vc));
+
+        const __m256d az = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.kz, va, all, 8), oz);
+        const __m256d bz = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.kz, vb, all, 8), oz);
+        const __m256d cz = _mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.kz, vc, all, 8), oz);
+        const __m256d ax = _mm256_sub_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.kx, va, all, 8), ox), _mm256_mul_pd(sx, az));
+        const __m256d ay = _mm256_sub_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.ky, va, all, 8), oy), _mm256_mul_pd(sy, az));
+        const __m256d bx = _mm256_sub_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.kx, vb, all, 8), ox), _mm256_mul_pd(sx, bz));
+        const __m256d by = _mm256_sub_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.ky, vb, all, 8), oy), _mm256_mul_pd(sy, bz));
+        const __m256d cx = _mm256_sub_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.kx, vc, all, 8), ox), _mm256_mul_pd(sx, cz));
+        const __m256d cy = _mm256_sub_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, P + w.ky, vc, all, 8), oy), _mm256_mul_pd(sy, cz));
+
+        const __m256d u = _mm256_sub_pd(_mm256_mul_pd(cx, by), _mm256_mul_pd(cy, bx));
+        const __m256d v = _mm256_sub_pd(_mm256_mul_pd(ax, cy), _mm256_mul_pd(ay, cx));
+        const __m256d e = _mm256_sub_pd(_mm256_mul_pd(bx, ay), _mm256_mul_pd(by, ax));
+
+        const __m256d any_negative = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(u, zero, _CMP_LT_OQ),
+                                                               _mm256_cmp_pd(v, zero, _CMP_LT_OQ)),
+                                                  _mm256_cmp_pd(e, zero, _CMP_LT_OQ));
+        const __m256d any_positive = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(u, zero, _CMP_GT_OQ),
+                                                               _mm256_cmp_pd(v, zero, _CMP_GT_OQ)),
+                                                  _mm256_cmp_pd(e, zero, _CMP_GT_OQ));
+        const __m256d det = _mm256_add_pd(_mm256_add_pd(u, v), e);
+        const __m256d inside = _mm256_andnot_pd(_mm256_and_pd(any_negative, any_positive),
+                                                _mm256_and_pd(_mm256_cmp_pd(idx, end, _CMP_LT_OQ),
+                                                              _mm256_cmp_pd(det, zero, _CMP_NEQ_OQ)));
+        if (_mm256_movemask_pd(inside) == 0) continue;
+
+        const __m256d t = _mm256_div_pd(
+            _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(u, _mm256_mul_pd(sz, az)), _mm256_mul_pd(v, _mm256_mul_pd(sz, bz))),
+                          _mm256_mul_pd(e, _mm256_mul_pd(sz, cz))),
+            det);
+        const __m256d better = _mm256_and_pd(_mm256_and_pd(inside, _mm256_cmp_pd(t, tmin, _CMP_GE_OQ)),
+                                             _mm256_cmp_pd(t, best_t, _CMP_LE_OQ));
+        const int hits = _mm256_movemask_pd(better);
+        if (hits == 0) continue;
+        if (any_hit) {
+            alignas(32) double lane_t[4];
+            _mm256_store_pd(lane_t, t);
+            const int l = __builtin_ctz(hits);
+            t_hit = lane_t[l];
+            return first + i + l;
+        }
+
+        best_t = _mm256_blendv_pd(best_t, t, better);
+        best_i = _mm256_blendv_pd(best_i, idx, better);
+    }
+
+    alignas(32) double lane_t[4], lane_i[4];
+    _mm256_store_pd(lane_t, best_t);
+    _mm256_store_pd(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 4; ++l)
+        if (lane_i[l] >= 0) merge_candidate(first + static_cast<int>(lane_i[l]), lane_t[l], best, t_hit);
+    return best;
+}
+
+__attribute__((target("avx512f,avx512dq"), optimize("fp-contract=off")))
+inline int triangle_mesh::intersect_avx512(const watertight_ray& w, int first, int count, real t_min,
+                                           real t_max, bool any_hit, real& t_hit) const {
+    const double* P = geometry->positions.data();
+    const int* I = reinterpret_cast<const int*>(indices.data());
+
+    const __m512d ox = _mm512_set1_pd(w.ox), oy = _mm512_set1_pd(w.oy), oz = _mm512_set1_pd(w.oz);
+    const __m512d sx = _mm512_set1_pd(w.sx), sy = _mm512_set1_pd(w.sy), sz = _mm512_set1_pd(w.sz);
+    const __m512d tmin = _mm512_set1_pd(t_min), tmax = _mm512_set1_pd(t_max);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d eight = _mm512_set1_pd(8.0);
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+    __m512d best_t = tmax;
+    __m512d best_i = _mm512_set1_pd(-1.0);
+    __m512d idx = _mm512_set_pd(7.0, 6.0, 5.0, 4.0, 3.0, 2.0, 1.0, 0.0);
+
+    for (int i = 0; i < count; i += 8, idx = _mm512_add_pd(idx, eight)) {
+        const __m256i tri = _mm256_add_epi32(_mm256_set1_epi32(3 * (first + i)), stride);
+        __m256i va = _mm256_i32gather_epi32(I, tri, 4);
+        __m256i vb = _mm256_i32gather_epi32(I + 1, tri, 4);
+        __m256i vc = _mm256_i32gather_epi32(I + 2, tri, 4);
+        va = _mm256_add_epi32(va, _mm256_add_epi32(va, va));
+        vb = _mm256_add_epi32(vb, _mm256_add_epi32(vb, vb));
+        vc = _mm256_add_epi32(vc, _mm256_add_epi32(vc, vc));
+
+        const __m512d az = _mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, va, P + w.kz, 8), oz);
+        const __m512d bz = _mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, vb, P + w.kz, 8), oz);
+        const __m512d cz = _mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, vc, P + w.kz, 8), oz);
+        const __m512d ax = _mm512_sub_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, va, P + w.kx, 8), ox), _mm512_mul_pd(sx, az));
+        const __m512d ay = _mm512_sub_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, va, P + w.ky, 8), oy), _mm512_mul_pd(sy, az));
+        const __m512d bx = _mm512_sub_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, vb, P + w.kx, 8), ox), _mm512_mul_pd(sx, bz));
+        const __m512d by = _mm512_sub_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, vb, P + w.ky, 8), oy), _mm512_mul_pd(sy, bz));
+        const __m512d cx = _mm512_sub_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, vc, P + w.kx, 8), ox), _mm512_mul_pd(sx, cz));
+        const __m512d cy = _mm512_sub_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, 0xff, vc, P + w.ky, 8), oy), _mm512_mul_pd(sy, cz));
+
+        const __m512d u = _mm512_sub_pd(_mm512_mul_pd(cx, by), _mm512_mul_pd(cy, bx));
+        const __m512d v = _mm512_sub_pd(_mm512_mul_pd(ax, cy), _mm512_mul_pd(ay, cx));
+        const __m512d e = _mm512_sub_pd(_mm512_mul_pd(bx, ay), _mm512_mul_pd(by, ax));
+
+        const __mmask8 any_negative = _mm512_cmp_pd_mask(u, zero, _CMP_LT_OQ)
+                                    | _mm512_cmp_pd_mask(v, zero, _CMP_LT_OQ)
+                                    | _mm512_cmp_pd_mask(e, zero, _CMP_LT_OQ);
+        const __mmask8 any_positive = _mm512_cmp_pd_mask(u, zero, _CMP_GT_OQ)
+                                    | _mm512_cmp_pd_mask(v, zero, _CMP_GT_OQ)
+                                    | _mm512_cmp_pd_mask(e, zero, _CMP_GT_OQ);
+        const __m512d det = _mm512_add_pd(_mm512_add_pd(u, v), e);
+        const __mmask8 in_leaf = static_cast<__mmask8>(count - i >= 8 ? 0xff : (1u << (count - i)) - 1);
+        const __mmask8 inside = in_leaf & ~(any_negative & any_positive)
+                              & _mm512_cmp_pd_mask(det, zero, _CMP_NEQ_OQ);
+        if (inside == 0) continue;
+
+        const __m512d t = _mm512_div_pd(
+            _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(u, _mm512_mul_pd(sz, az)), _mm512_mul_pd(v, _mm512_mul_pd(sz, bz))),
+                          _mm512_mul_pd(e, _mm512_mul_pd(sz, cz))),
+            det);
+        const __mmask8 better = inside & _mm512_cmp_pd_mask(t, tmin, _CMP_GE_OQ)
+                              & _mm512_cmp_pd_mask(t, best_t, _CMP_LE_OQ);
+        if (better == 0) continue;
+        if (any_hit) {
+            alignas(64) double lane_t[8];
+            _mm512_store_pd(lane_t, t);
+            const int l = __builtin_ctz(better);
+            t_hit = lane_t[l];
+            return first + i + l;
+        }
+
+        best_t = _mm512_mask_blend_pd(better, best_t, t);
+        best_i = _mm512_mask_blend_pd(better, best_i, idx);
+    }
+
+    alignas(64) double lane_t[8], lane_i[8];
+    _mm512_store_pd(lane_t, best_t);
+    _mm512_store_pd(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 8; ++l)
+        if (lane_i[l] >= 0) merge_candidate(first + static_cast<int>(lane_i[l]), lane_t[l], best, t_hit);
+    return best;
+}
+
+#else // RT_FLOAT
+
+// Versões em float: o dobro de lanes. Um grupo em que alguma função de aresta deu zero
+// é refeito por intersect_scalar, que a recalcula em double.
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+inline int triangle_mesh::intersect_avx2(const watertight_ray& w, int first, int count, real t_min,
+                                         real t_max, bool any_hit, real& t_hit) const {
+    const float* P = geometry->positions.data();
+    const int* I = reinterpret_cast<const int*>(indices.data());
+
+    const __m256 ox = _mm256_set1_ps(w.ox), oy = _mm256_set1_ps(w.oy), oz = _mm256_set1_ps(w.oz);
+    const __m256 sx = _mm256_set1_ps(w.sx), sy = _mm256_set1_ps(w.sy), sz = _mm256_set1_ps(w.sz);
+    const __m256 tmin = _mm256_set1_ps(t_min), tmax = _mm256_set1_ps(t_max);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));  // Máscara dos gathers
+    const __m256 eight = _mm256_set1_ps(8.0f);
+    const __m256 end = _mm256_set1_ps(static_cast<float>(count));
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+    __m256 best_t = tmax;
+    __m256 best_i = _mm256_set1_ps(-1.0f);
+    __m256 idx = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    int fallback = -1;
+    real fallback_t = t_max;
+
+    for (int i = 0; i < count; i += 8, idx = _mm256_add_ps(idx, eight)) {
+        const __m256i tri = _mm256_add_epi32(_mm256_set1_epi32(3 * (first + i)), stride);
+        __m256i va = _mm256_i32gather_epi32(I, tri, 4);
+        __m256i vb = _mm256_i32gather_epi32(I + 1, tri, 4);
+        __m256i vc = _mm256_i32gather_epi32(I + 2, tri, 4);
+        va = _mm256_add_epi32(va, _mm256_add_epi32(va, va));
+        vb = _mm256_add_epi32(vb, _mm256_add_epi32(vb, vb));
+        vc = _mm256_add_epi32(vc, _mm256_add_epi32(vc, vc));
+
+        const __m256 az = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.kz, va, all, 4), oz);
+        const __m256 bz = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.kz, vb, all, 4), oz);
+        const __m256 cz = _mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.kz, vc, all, 4), oz);
+        const __m256 ax = _mm256_sub_ps(_mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.kx, va, all, 4), ox), _mm256_mul_ps(sx, az));
+        const __m256 ay = _mm256_sub_ps(_mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.ky, va, all, 4), oy), _mm256_mul_ps(sy, az));
+        const __m256 bx = _mm256_sub_ps(_mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.kx, vb, all, 4), ox), _mm256_mul_ps(sx, bz));
+        const __m256 by = _mm256_sub_ps(_mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.ky, vb, all, 4), oy), _mm256_mul_ps(sy, bz));
+        const __m256 cx = _mm256_sub_ps(_mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.kx, vc, all, 4), ox), _mm256_mul_ps(sx, cz));
+        const __m256 cy = _mm256_sub_ps(_mm256_sub_ps(_mm256_mask_i32gather_ps(zero, P + w.ky, vc, all, 4), oy), _mm256_mul_ps(sy, cz));
+
+        const __m256 u = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+        const __m256 v = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+        const __m256 e = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+
+        const __m256 in_leaf = _mm256_cmp_ps(idx, end, _CMP_LT_OQ);
+        const __m256 zero_edge = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_EQ_OQ),
+                                                           _mm256_cmp_ps(v, zero, _CMP_EQ_OQ)),
+                                              _mm256_cmp_ps(e, zero, _CMP_EQ_OQ));
+        if (_mm256_movemask_ps(_mm256_and_ps(in_leaf, zero_edge)) != 0) {
+            real t;
+            const int k = intersect_scalar(w, first + i, std::min(8, count - i), t_min, t_max, any_hit, t);
+            if (k >= 0 && any_hit) {
+                t_hit = t;
+                return k;
+            }
+            merge_candidate(k, t, fallback, fallback_t);
+            continue;
+        }
+
+        const __m256 any_negative = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ),
+                                                              _mm256_cmp_ps(v, zero, _CMP_LT_OQ)),
+                                                 _mm256_cmp_ps(e, zero, _CMP_LT_OQ));
+        const __m256 any_positive = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_GT_OQ),
+                                                              _mm256_cmp_ps(v, zero, _CMP_GT_OQ)),
+                                                 _mm256_cmp_ps(e, zero, _CMP_GT_OQ));
+        const __m256 det = _mm256_add_ps(_mm256_add_ps(u, v), e);
+        const __m256 inside = _mm256_andnot_ps(_mm256_and_ps(any_negative, any_positive),
+                                               _mm256_and_ps(in_leaf, _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ)));
+        if (_mm256_movemask_ps(inside) == 0) continue;
+
+        const __m256 t = _mm256_div_ps(
+            _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(u, _mm256_mul_ps(sz, az)), _mm256_mul_ps(v, _mm256_mul_ps(sz, bz))),
+                          _mm256_mul_ps(e, _mm256_mul_ps(sz, cz))),
+            det);
+        const __m256 better = _mm256_and_ps(_mm256_and_ps(inside, _mm256_cmp_ps(t, tmin, _CMP_GE_OQ)),
+                                            _mm256_cmp_ps(t, best_t, _CMP_LE_OQ));
+        const int hits = _mm256_movemask_ps(better);
+        if (hits == 0) continue;
+        if (any_hit) {
+            alignas(32) float lane_t[8];
+            _mm256_store_ps(lane_t, t);
+            const int l = __builtin_ctz(hits);
+            t_hit = lane_t[l];
+            return first + i + l;
+        }
+
+        best_t = _mm256_blendv_ps(best_t, t, better);
+        best_i = _mm256_blendv_ps(best_i, idx, better);
+    }
+
+    alignas(32) float lane_t[8], lane_i[8];
+    _mm256_store_ps(lane_t, best_t);
+    _mm256_store_ps(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 8; ++l)
+        if (lane_i[l] >= 0) merge_candidate(first + static_cast<int>(lane_i[l]), lane_t[l], best, t_hit);
+    merge_candidate(fallback, fallback_t, best, t_hit);
+    return best;
+}
+
+__attribute__((target("avx512f,avx512dq"), optimize("fp-contract=off")))
+inline int triangle_mesh::intersect_avx512(const watertight_ray& w, int first, int count, real t_min,
+                                           real t_max, bool any_hit, real& t_hit) const {
+    const float* P = geometry->positions.data();
+    const int* I = reinterpret_cast<const int*>(indices.data());
+
+    const __m512 ox = _mm512_set1_ps(w.ox), oy = _mm512_set1_ps(w.oy), oz = _mm512_set1_ps(w.oz);
+    const __m512 sx = _mm512_set1_ps(w.sx), sy = _mm512_set1_ps(w.sy), sz = _mm512_set1_ps(w.sz);
+    const __m512 tmin = _mm512_set1_ps(t_min), tmax = _mm512_set1_ps(t_max);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 sixteen = _mm512_set1_ps(16.0f);
+    const __m512i stride = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 33, 36, 39, 42, 45);
+
+    __m512 best_t = tmax;
+    __m512 best_i = _mm512_set1_ps(-1.0f);
+    __m512 idx = _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f,
+                               7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    int fallback = -1;
+    real fallback_t = t_max;
+
+    for (int i = 0; i < count; i += 16, idx = _mm512_add_ps(idx, sixteen)) {
+        const __m512i tri = _mm512_add_epi32(_mm512_set1_epi32(3 * (first + i)), stride);
+        __m512i va = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, tri, I, 4);
+        __m512i vb = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, tri, I + 1, 4);
+        __m512i vc = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, tri, I + 2, 4);
+        va = _mm512_add_epi32(va, _mm512_add_epi32(va, va));
+        vb = _mm512_add_epi32(vb, _mm512_add_epi32(vb, vb));
+        vc = _mm512_add_epi32(vc, _mm512_add_epi32(vc, vc));
+
+        const __m512 az = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, va, P + w.kz, 4), oz);
+        const __m512 bz = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, vb, P + w.kz, 4), oz);
+        const __m512 cz = _mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, vc, P + w.kz, 4), oz);
+        const __m512 ax = _mm512_sub_ps(_mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, va, P + w.kx, 4), ox), _mm512_mul_ps(sx, az));
+        const __m512 ay = _mm512_sub_ps(_mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, va, P + w.ky, 4), oy), _mm512_mul_ps(sy, az));
+        const __m512 bx = _mm512_sub_ps(_mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, vb, P + w.kx, 4), ox), _mm512_mul_ps(sx, bz));
+        const __m512 by = _mm512_sub_ps(_mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, vb, P + w.ky, 4), oy), _mm512_mul_ps(sy, bz));
+        const __m512 cx = _mm512_sub_ps(_mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, vc, P + w.kx, 4), ox), _mm512_mul_ps(sx, cz));
+        const __m512 cy = _mm512_sub_ps(_mm512_sub_ps(_mm512_mask_i32gather_ps(zero, 0xffff, vc, P + w.ky, 4), oy), _mm512_mul_ps(sy, cz));
+
+        const __m512 u = _mm512_sub_ps(_mm512_mul_ps(cx, by), _mm512_mul_ps(cy, bx));
+        const __m512 v = _mm512_sub_ps(_mm512_mul_ps(ax, cy), _mm512_mul_ps(ay, cx));
+        const __m512 e = _mm512_sub_ps(_mm512_mul_ps(bx, ay), _mm512_mul_ps(by, ax));
+
+        const __mmask16 in_leaf = static_cast<__mmask16>(count - i >= 16 ? 0xffff : (1u << (count - i)) - 1);
+        const __mmask16 zero_edge = _mm512_cmp_ps_mask(u, zero, _CMP_EQ_OQ)
+                                  | _mm512_cmp_ps_mask(v, zero, _CMP_EQ_OQ)
+                                  | _mm512_cmp_ps_mask(e, zero, _CMP_EQ_OQ);
+        if (in_leaf & zero_edge) {
+            real t;
+            const int k = intersect_scalar(w, first + i, std::min(16, count - i), t_min, t_max, any_hit, t);
+            if (k >= 0 && any_hit) {
+                t_hit = t;
+                return k;
+            }
+            merge_candidate(k, t, fallback, fallback_t);
+            continue;
+        }
+
+        const __mmask16 any_negative = _mm512_cmp_ps_mask(u, zero, _CMP_LT_OQ)
+                                     | _mm512_cmp_ps_mask(v, zero, _CMP_LT_OQ)
+                                     | _mm512_cmp_ps_mask(e, zero, _CMP_LT_OQ);
+        const __mmask16 any_positive = _mm512_cmp_ps_mask(u, zero, _CMP_GT_OQ)
+                                     | _mm512_cmp_ps_mask(v, zero, _CMP_GT_OQ)
+                                     | _mm512_cmp_ps_mask(e, zero, _CMP_GT_OQ);
+        const __m512 det = _mm512_add_ps(_mm512_add_ps(u, v), e);
+        const __mmask16 inside = in_leaf & ~(any_negative & any_positive)
+                               & _mm512_cmp_ps_mask(det, zero, _CMP_NEQ_OQ);
+        if (inside == 0) continue;
+
+        const __m512 t = _mm512_div_ps(
+            _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(u, _mm512_mul_ps(sz, az)), _mm512_mul_ps(v, _mm512_mul_ps(sz, bz))),
+                          _mm512_mul_ps(e, _mm512_mul_ps(sz, cz))),
+            det);
+        const __mmask16 better = inside & _mm512_cmp_ps_mask(t, tmin, _CMP_GE_OQ)
+                               & _mm512_cmp_ps_mask(t, best_t, _CMP_LE_OQ);
+        if (better == 0) continue;
+        if (any_hit) {
+            alignas(64) float lane_t[16];
+            _mm512_store_ps(lane_t, t);
+            const int l = __builtin_ctz(better);
+            t_hit = lane_t[l];
+            return first + i + l;
+        }
+
+        best_t = _mm512_mask_blend_ps(better, best_t, t);
+        best_i = _mm512_mask_blend_ps(better, best_i, idx);
+    }
+
+    alignas(64) float lane_t[16], lane_i[16];
+    _mm512_store_ps(lane_t, best_t);
+    _mm512_store_ps(lane_i, best_i);
+
+    int best = -1;
+    t_hit = t_max;
+    for (int l = 0; l < 16; ++l)
+        if (lane_i[l] >= 0) merge_candidate(first + static_cast<int>(lane_i[l]), lane_t[l], best, t_hit);
+    merge_candidate(fallback, fallback_t, best, t_hit);
+    return best;
+}
+
+#endif // RT_FLOAT
+
+#endif
+
+#endif
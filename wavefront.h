@@ -0,0 +1,182 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "rtweekend.h"
+
+#include "camera.h"
+#include "feature_buffer.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "integrator.h"
+#include "lights.h"
+#include "material.h"
+#include "stats.h"
+#include "tile.h"
+
+#include <cstdint>
+#include <vector>
+
+// Integrador em frentes de onda (wavefront): em vez de seguir um caminho por vez até
+// o fim, gera de uma vez todos os raios de câmera de um tile, intersecta o lote
+// inteiro, descarta os caminhos que terminaram e agrupa os sobreviventes pela classe
+// do material antes de chamar scatter. Assim cada etapa roda o mesmo trecho de código
+// sobre uma fila coerente de raios.
+//
+// Cada caminho guarda o seu próprio estado de amostragem (o fluxo de begin_sample e a
+// posição nas sequências), que é trocado com o da thread antes de cada sorteio. A
+// sequência de números de cada amostra é a mesma de ray_color; só muda a ordem das
+// multiplicações. No fim do tile as amostras de cada pixel são somadas na ordem dos
+// índices, como em render, então a imagem é a mesma, byte a byte, das duas formas.
+class wavefront_integrator {
+public:
+    // Renderiza samples_per_pixel amostras de cada pixel do tile e grava a soma delas no
+    // framebuffer (e soma os atributos do primeiro ponto em 'features', se não for nulo).
+    void render_tile(const hittable& world, const material_arena& materials, const camera& cam,
+                     const tile& tl, int image_width, int image_height, int samples_per_pixel,
+                     int max_depth, const russian_roulette& rr, sampler_mode sampler, std::uint64_t frame,
+                     const light_list* lights, framebuffer& fb, feature_buffer* features = nullptr);
+
+public:
+    std::uint64_t rays_traced = 0;  // Total de raios intersectados
+
+private:
+    // Estado dos caminhos, em arrays paralelos indexados pelo número do caminho
+    std::vector<ray> rays;
+    std::vector<color> throughput;
+    std::vector<color> radiance;                    // Luz já coletada pelo caminho
+    std::vector<double> bsdf_pdf;                   // Como em ray_color
+    std::vector<sample_state> samples;
+    std::vector<std::uint32_t> pixel;
+    std::vector<hit_record> hits;
+    std::vector<path_features> first_hits;          // Só com feature_buffer
+
+    std::vector<int> active;                        // Caminhos vivos na próxima interseção
+    std::vector<int> queues[material_kind_count];   // Caminhos que acertaram algo, por material
+};
+
+
+inline void wavefront_integrator::render_tile(const hittable& world, const material_arena& materials,
+                                              const camera& cam, const tile& tl,
+                                              int image_width, int image_height, int samples_per_pixel,
+                                              int max_depth, const russian_roulette& rr, sampler_mode sampler,
+                                              std::uint64_t frame, const light_list* lights, framebuffer& fb,
+                                              feature_buffer* features) {
+    const int path_count = tl.pixel_count() * samples_per_pixel;
+    rays.resize(path_count);
+    throughput.resize(path_count);
+    radiance.resize(path_count);
+    bsdf_pdf.resize(path_count);
+    samples.resize(path_count);
+    pixel.resize(path_count);
+    hits.resize(path_count);
+    if (features) first_hits.resize(path_count);
+    active.clear();
+
+    // Geração dos raios de câmera
+    int p = 0;
+    for (int j = tl.y0; j < tl.y1; ++j) {
+        for (int i = tl.x0; i < tl.x1; ++i) {
+            const auto pixel_index = static_cast<std::uint64_t>(j) * image_width + i;
+            for (int s = 0; s < samples_per_pixel; ++s, ++p) {
+                begin_sample(sampler, i, j, image_width, s, frame);
+                double du, dv;
+                sample_2d(du, dv);
+                auto u = (i + du) / (image_width-1);
+                auto v = (j + dv) / (image_height-1);
+                rays[p] = cam.get_ray(u, v);
+                throughput[p] = color(1,1,1);
+                radiance[p] = color(0,0,0);
+                bsdf_pdf[p] = 0;
+                samples[p] = thread_sample();
+                pixel[p] = static_cast<std::uint32_t>(pixel_index);
+                active.push_back(p);
+            }
+        }
+    }
+
+    const sample_state saved_sample = thread_sample();
+
+    for (int bounce = 0; bounce < max_depth && !active.empty(); ++bounce) {
+        // Interseção do lote inteiro; quem escapa recebe a cor do fundo
+        for (auto& q : queues) q.clear();
+        rays_traced += active.size();
+        RT_STAT(primary_rays += (bounce == 0 ? active.size() : 0));
+        RT_STAT(secondary_rays += (bounce != 0 ? active.size() : 0));
+
+        for (int path : active) {
+            if (world.hit(rays[path], 0.001, infinity, hits[path])) {
+                queues[static_cast<int>(materials.kind(hits[path].mat_id))].push_back(path);
+            } else {
+                radiance[path] = radiance[path] + throughput[path] * background(rays[path]);
+                if (features && bounce == 0) {
+                    first_hits[path] = path_features();
+                    first_hits[path].albedo = background(rays[path]);
+                }
+                RT_STAT(end_path(path_end::escaped, bounce + 1));
+            }
+        }
+
+        // Dispersão, uma classe de material por vez; os sobreviventes formam o novo lote
+        active.clear();
+        for (const auto& queue : queues) {
+            for (int path : queue) {
+                const hit_record& rec = hits[path];
+                const material_kind kind = materials.kind(rec.mat_id);
+                if (kind == material_kind::diffuse_light) {
+                    const double weight = lights && bsdf_pdf[path] > 0
+                                        ? lights->hit_weight(rays[path], rec, bsdf_pdf[path]) : 1.0;
+                    radiance[path] += weight * throughput[path] * materials.emitted(rec.mat_id, rec);
+                }
+
+                ray scattered;
+                color attenuation;
+                thread_sample() = samples[path];
+                set_sample_dimension(bounce_dimension(bounce));
+                const bool scatters = materials.scatter(rec.mat_id, rays[path], rec, attenuation, scattered);
+                RT_STAT(record_scatter(kind, scatters));
+                if (features && bounce == 0)
+                    first_hits[path] = {attenuation, rec.normal, rec.t * rays[path].direction().length()};
+                if (scatters) {
+                    bsdf_pdf[path] = 0;
+                    if (lights && kind == material_kind::lambertian) {
+                        set_sample_dimension(bounce_dimension(bounce) + 4);
+                        radiance[path] += throughput[path] * attenuation
+                                        * lights->sample_direct(world, materials, rec, rays[path].time());
+                        bsdf_pdf[path] = lambertian_pdf(rec.normal, scattered.direction());
+                    }
+                    throughput[path] = throughput[path] * attenuation;
+                    rays[path] = scattered;
+                    set_sample_dimension(bounce_dimension(bounce) + 3);
+                    if (rr.survive(bounce, throughput[path])) {
+                        active.push_back(path);
+                    } else {
+                        RT_STAT(end_path(path_end::roulette, bounce + 1));
+                    }
+                } else {
+                    RT_STAT(end_path(path_end::absorbed, bounce + 1));
+                }
+                samples[path] = thread_sample();
+            }
+        }
+    }
+
+    // Caminhos que atingiram max_depth não coletam mais nada, como em ray_color
+    RT_STAT(end_path(path_end::max_depth, max_depth, active.size()));
+
+    // Os caminhos de um pixel são consecutivos; as somas seguem a ordem das amostras, não
+    // a ordem em que os caminhos terminaram
+    for (int first = 0; first < path_count; first += samples_per_pixel) {
+        color sum(0,0,0);
+        for (int path = first; path < first + samples_per_pixel; ++path) {
+            sum += radiance[path];
+            if (features) {
+                features->add(pixel[path], first_hits[path]);
+                features->add_radiance(pixel[path], radiance[path]);
+            }
+        }
+        fb.set(pixel[first], sum);
+    }
+    thread_sample() = saved_sample;
+}
+
+#endif